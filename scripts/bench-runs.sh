@@ -0,0 +1,75 @@
+#!/usr/bin/env bash
+
+set -e -o pipefail
+
+runs=500
+time_limit=0.1
+repeat=3
+extra_args=()
+binaries=()
+
+#--------------------------------------------------------------------------#
+
+die () {
+  echo "*** `basename "$0"`: $*" 1>&2
+  exit 1
+}
+
+usage () {
+cat <<EOF
+usage: $0 [<option> ...] <murxla> [<murxla> ...] [-- <murxla option> ...]
+
+Measure the throughput (test runs per second) of continuous mode for each of
+the given murxla binaries, e.g., to compare a build before and after a change.
+
+where <option> is one of the following:
+
+  -h, --help            print this message and exit
+  -m, --max-runs <int>  number of test runs per measurement [$runs]
+  -t, --time <double>   time limit per test run [$time_limit]
+  -r, --repeat <int>    number of measurements per binary [$repeat]
+
+All options after '--' are passed to murxla.
+EOF
+  exit 0
+}
+
+#--------------------------------------------------------------------------#
+
+while [ $# -gt 0 ]
+do
+  opt=$1
+  case $opt in
+    -h|--help) usage;;
+    -m|--max-runs) shift; runs=$1;;
+    -t|--time) shift; time_limit=$1;;
+    -r|--repeat) shift; repeat=$1;;
+    --) shift; extra_args=("$@"); break;;
+    -*) die "invalid option '$opt' (try '-h')";;
+    *) binaries+=("$opt");;
+  esac
+  shift
+done
+
+[ ${#binaries[@]} -eq 0 ] && die "no murxla binary given (try '-h')"
+
+work_dir=$(mktemp -d)
+trap 'rm -rf "$work_dir"' EXIT
+
+for bin in "${binaries[@]}"
+do
+  [ -x "$bin" ] || die "'$bin' is not executable"
+  bin=$(realpath "$bin")
+  for i in $(seq 1 "$repeat")
+  do
+    rm -rf "${work_dir:?}"/*
+    start=$(date +%s.%N)
+    (cd "$work_dir" && \
+      "$bin" -m "$runs" -t "$time_limit" "${extra_args[@]}" > /dev/null 2>&1) \
+      || true
+    end=$(date +%s.%N)
+    echo "$bin $runs $start $end" | \
+      awk '{ printf "%s: %d runs in %.2fs, %.2f runs/s\n", \
+                    $1, $2, $4 - $3, $2 / ($4 - $3) }'
+  done
+done
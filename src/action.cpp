@@ -527,7 +527,7 @@ ActionMkSort::generate()
   SortKind kind = d_smgr.pick_sort_kind_data().d_kind;
   RNGenerator::Choice pick;
 
-  ++d_smgr.d_mbt_stats->d_sorts[kind];
+  ++d_smgr.d_mbt_stats->shard().d_sorts[kind];
 
   switch (kind)
   {
@@ -790,7 +790,7 @@ ActionMkSort::generate()
     default: assert(false);
   }
 
-  ++d_smgr.d_mbt_stats->d_sorts_ok[kind];
+  ++d_smgr.d_mbt_stats->shard().d_sorts_ok[kind];
 
   return true;
 }
@@ -1301,7 +1301,7 @@ ActionMkTerm::generate(Op::Kind kind)
     sort_kind = *sort_kinds.begin();
   }
 
-  ++d_smgr.d_mbt_stats->d_ops[op.d_id];
+  ++d_smgr.d_mbt_stats->shard().d_ops[op.d_id];
 
   if (kind == Op::DT_APPLY_CONS)
   {
@@ -1867,7 +1867,7 @@ ActionMkTerm::generate(Op::Kind kind)
     run(kind, sort_kind, args, indices);
   }
 
-  ++d_smgr.d_mbt_stats->d_ops_ok[op.d_id];
+  ++d_smgr.d_mbt_stats->shard().d_ops_ok[op.d_id];
 
   return true;
 }
@@ -2026,7 +2026,7 @@ ActionMkTerm::generate()
     assert(sort_kind != SORT_ANY);
     run(kind, sort_kind, args, {});
 
-    ++d_smgr.d_mbt_stats->d_ops[op.d_id];
+    ++d_smgr.d_mbt_stats->shard().d_ops[op.d_id];
     return true;
   }
   return generate(kind);
@@ -2148,7 +2148,12 @@ ActionMkTerm::run(Op::Kind kind,
     }
   }
 
-  Term res = d_solver.mk_term(kind, args, indices);
+  Term res;
+  {
+    statistics::Timer timer(
+        d_smgr.d_mbt_stats->shard().d_op_times[d_smgr.get_op(kind).d_id]);
+    res = d_solver.mk_term(kind, args, indices);
+  }
   // MURXLA_TEST(res->get_sort() == nullptr
   //             || d_solver.get_sort(res, sort_kind)->equals(res->get_sort()));
 
@@ -2198,7 +2203,12 @@ ActionMkTerm::run(Op::Kind kind,
   MURXLA_TRACE << get_kind() << trace_str.str();
   reset_sat();
 
-  Term res = d_solver.mk_term(kind, str_args, args);
+  Term res;
+  {
+    statistics::Timer timer(
+        d_smgr.d_mbt_stats->shard().d_op_times[d_smgr.get_op(kind).d_id]);
+    res = d_solver.mk_term(kind, str_args, args);
+  }
   d_smgr.add_term(res, sort_kind, args);
   Sort res_sort = res->get_sort();
 
@@ -2235,7 +2245,12 @@ ActionMkTerm::run(Op::Kind kind,
     }
   }
 
-  Term res = d_solver.mk_term(kind, sort, str_args, args);
+  Term res;
+  {
+    statistics::Timer timer(
+        d_smgr.d_mbt_stats->shard().d_op_times[d_smgr.get_op(kind).d_id]);
+    res = d_solver.mk_term(kind, sort, str_args, args);
+  }
   /* We do not add match case terms since they are specifically created for
    * creating a match term and should not be used in any other terms. */
   d_smgr.add_term(res, sort_kind, args);
@@ -3243,7 +3258,13 @@ ActionCheckSat::run()
 {
   MURXLA_TRACE << get_kind();
   reset_sat();
-  d_smgr.report_result(d_solver.check_sat());
+  d_smgr.flush_trace();
+  Solver::Result res;
+  {
+    statistics::Timer timer(d_smgr.d_mbt_stats->shard().d_check_sat_times);
+    res = d_solver.check_sat();
+  }
+  d_smgr.report_result(res);
 }
 
 /* -------------------------------------------------------------------------- */
@@ -3297,7 +3318,13 @@ ActionCheckSatAssuming::run(const std::vector<Term>& assumptions)
   {
     d_smgr.add_assumption(t);
   }
-  d_smgr.report_result(d_solver.check_sat_assuming(assumptions));
+  d_smgr.flush_trace();
+  Solver::Result res;
+  {
+    statistics::Timer timer(d_smgr.d_mbt_stats->shard().d_check_sat_times);
+    res = d_solver.check_sat_assuming(assumptions);
+  }
+  d_smgr.report_result(res);
 }
 
 /* -------------------------------------------------------------------------- */
@@ -100,7 +100,7 @@ class Action
    * We further use strings here to make FSM::d_actions easily extensible
    * with solver-specific actions.
    */
-  using Kind = std::string;
+  using Kind = InternedKind;
 
   /** The undefined action. */
   inline static const Kind UNDEFINED = "undefined";
@@ -293,7 +293,7 @@ class Action
 
  private:
   /* The kind of this action. */
-  const Kind& d_kind = UNDEFINED;
+  const Kind d_kind = UNDEFINED;
   /* The id of this action, assigned in the order they have been created. */
   uint64_t d_id = 0u;
 };
@@ -0,0 +1,583 @@
+/***
+ * Murxla: A Model-Based API Fuzzer for SMT solvers.
+ *
+ * This file is part of Murxla.
+ *
+ * Copyright (C) 2019-2022 by the authors listed in the AUTHORS file.
+ *
+ * See LICENSE for more information on using this software.
+ */
+#include "binary_trace.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cassert>
+#include <charconv>
+#include <cstring>
+#include <tuple>
+
+#include "except.hpp"
+#include "util.hpp"
+
+namespace murxla {
+
+/* -------------------------------------------------------------------------- */
+
+namespace {
+
+/** The maximum number of digits of unsigned integers encoded as varint. */
+constexpr size_t MAX_UINT_DIGITS = 19;
+
+/**
+ * Render a statement into its text representation, as written by
+ * MURXLA_TRACE and MURXLA_TRACE_RETURN.
+ */
+void
+render_line(uint32_t seed,
+            const std::string& id,
+            const std::vector<std::string>& tokens,
+            std::string& line)
+{
+  line.clear();
+  if (id == "return")
+  {
+    line.append(6, ' ');
+  }
+  else
+  {
+    std::string s = std::to_string(seed);
+    if (s.size() < 5) line.append(5 - s.size(), ' ');
+    line += s;
+    line += ' ';
+  }
+  line += id;
+  for (const auto& t : tokens)
+  {
+    line += ' ';
+    line += t;
+  }
+}
+
+/**
+ * Parse given string as unsigned integer if it is in canonical form (i.e.,
+ * can be rendered back from the integer value).
+ */
+bool
+parse_uint(const char* s, size_t size, uint64_t& value)
+{
+  if (size == 0 || size > MAX_UINT_DIGITS || (size > 1 && s[0] == '0'))
+  {
+    return false;
+  }
+  auto [ptr, ec] = std::from_chars(s, s + size, value);
+  return ec == std::errc() && ptr == s + size;
+}
+
+void
+encode_uint(std::string& out, uint64_t value)
+{
+  while (value >= 0x80)
+  {
+    out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+    value >>= 7;
+  }
+  out.push_back(static_cast<char>(value));
+}
+
+void
+encode_str(std::string& out, const std::string& s)
+{
+  encode_uint(out, s.size());
+  out += s;
+}
+
+}  // namespace
+
+/* -------------------------------------------------------------------------- */
+
+bool
+BinaryTrace::is_binary_trace(const std::string& file_name)
+{
+  std::ifstream file(file_name, std::ifstream::binary);
+  std::string header(MAGIC.size(), '\0');
+  return file.read(header.data(), header.size()) && header == MAGIC;
+}
+
+void
+BinaryTrace::convert(const std::string& in_file_name,
+                     const std::string& out_file_name)
+{
+  TraceReader reader(in_file_name);
+  MURXLA_CHECK_CONFIG(reader.is_open())
+      << "unable to open trace file '" << in_file_name << "'";
+
+  std::ofstream out(out_file_name,
+                    std::ofstream::out | std::ofstream::binary
+                        | std::ofstream::trunc);
+  MURXLA_CHECK_CONFIG(out.is_open())
+      << "unable to open output file '" << out_file_name << "'";
+
+  std::string line;
+  bool eol;
+  if (reader.is_binary())
+  {
+    while (reader.next_line(line, eol))
+    {
+      out << line;
+      if (eol) out << '\n';
+    }
+  }
+  else
+  {
+    BinaryTraceWriter writer(out.rdbuf());
+    std::ostream bout(&writer);
+    while (reader.next_line(line, eol))
+    {
+      bout << line;
+      if (eol) bout << '\n';
+    }
+  }
+}
+
+/* -------------------------------------------------------------------------- */
+
+BinaryTraceWriter::BinaryTraceWriter(std::streambuf* out) : d_out(out)
+{
+  d_records = BinaryTrace::MAGIC;
+  d_records.push_back(BinaryTrace::VERSION);
+  write_records();
+}
+
+BinaryTraceWriter::~BinaryTraceWriter()
+{
+  if (!d_line.empty())
+  {
+    encode_line(false);
+  }
+  sync();
+}
+
+BinaryTraceWriter::int_type
+BinaryTraceWriter::overflow(int_type c)
+{
+  if (!traits_type::eq_int_type(c, traits_type::eof()))
+  {
+    char ch = traits_type::to_char_type(c);
+    xsputn(&ch, 1);
+  }
+  return traits_type::not_eof(c);
+}
+
+std::streamsize
+BinaryTraceWriter::xsputn(const char* s, std::streamsize n)
+{
+  const char* end = s + n;
+  while (s < end)
+  {
+    const char* nl = static_cast<const char*>(std::memchr(s, '\n', end - s));
+    if (nl == nullptr)
+    {
+      d_line.append(s, end - s);
+      break;
+    }
+    d_line.append(s, nl - s);
+    encode_line(true);
+    s = nl + 1;
+  }
+  return n;
+}
+
+int
+BinaryTraceWriter::sync()
+{
+  return write_records() && d_out->pubsync() != -1 ? 0 : -1;
+}
+
+void
+BinaryTraceWriter::encode_line(bool eol)
+{
+  if (!eol || !encode_statement())
+  {
+    d_records.push_back(eol ? BinaryTrace::RAW : BinaryTrace::RAW_NO_EOL);
+    encode_str(d_records, d_line);
+  }
+  d_line.clear();
+  write_records();
+}
+
+bool
+BinaryTraceWriter::encode_statement()
+{
+  if (d_line.empty() || d_line[0] == '#'
+      || d_line.rfind("set-murxla-options", 0) == 0)
+  {
+    return false;
+  }
+
+  uint32_t seed;
+  std::string id;
+  std::vector<std::string> tokens;
+  try
+  {
+    std::tie(seed, id, tokens) = tokenize(d_line);
+  }
+  catch (std::exception& e)
+  {
+    return false;
+  }
+  if (id.empty()) return false;
+
+  /* Only encode lines that are rendered back byte by byte. */
+  std::string rendered;
+  render_line(seed, id, tokens, rendered);
+  if (rendered != d_line) return false;
+
+  if (id == "return")
+  {
+    d_records.push_back(BinaryTrace::RETURN);
+  }
+  else
+  {
+    auto [it, inserted] = d_kinds.emplace(id, d_kinds.size());
+    d_records.push_back(inserted ? BinaryTrace::ACTION_NEW_KIND
+                                 : BinaryTrace::ACTION);
+    encode_uint(d_records, seed);
+    if (inserted)
+    {
+      encode_str(d_records, id);
+    }
+    else
+    {
+      encode_uint(d_records, it->second);
+    }
+  }
+  encode_uint(d_records, tokens.size());
+  for (const auto& t : tokens)
+  {
+    encode_token(t);
+  }
+  return true;
+}
+
+void
+BinaryTraceWriter::encode_token(const std::string& token)
+{
+  uint64_t value;
+  if (token.size() > 1 && (token[0] == 's' || token[0] == 't')
+      && parse_uint(token.data() + 1, token.size() - 1, value))
+  {
+    d_records.push_back(token[0] == 's' ? BinaryTrace::SORT_ID
+                                        : BinaryTrace::TERM_ID);
+    encode_uint(d_records, value);
+  }
+  else if (parse_uint(token.data(), token.size(), value))
+  {
+    d_records.push_back(BinaryTrace::UINT);
+    encode_uint(d_records, value);
+  }
+  else if (token[0] >= 'A' && token[0] <= 'Z')
+  {
+    auto [it, inserted] = d_symbols.emplace(token, d_symbols.size());
+    if (inserted)
+    {
+      d_records.push_back(BinaryTrace::SYMBOL_NEW);
+      encode_str(d_records, token);
+    }
+    else
+    {
+      d_records.push_back(BinaryTrace::SYMBOL);
+      encode_uint(d_records, it->second);
+    }
+  }
+  else
+  {
+    d_records.push_back(BinaryTrace::STRING);
+    encode_str(d_records, token);
+  }
+}
+
+bool
+BinaryTraceWriter::write_records()
+{
+  bool res = true;
+  if (!d_records.empty())
+  {
+    std::streamsize size = d_records.size();
+    res                  = d_out->sputn(d_records.data(), size) == size;
+    d_records.clear();
+  }
+  return res;
+}
+
+/* -------------------------------------------------------------------------- */
+
+TraceReader::TraceReader(const std::string& file_name)
+    : d_file_name(file_name)
+{
+  if (!BinaryTrace::is_binary_trace(file_name))
+  {
+    d_text.open(file_name);
+    return;
+  }
+
+  int fd = open(file_name.c_str(), O_RDONLY);
+  if (fd < 0) return;
+  struct stat st;
+  if (fstat(fd, &st) == 0)
+  {
+    void* data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data != MAP_FAILED)
+    {
+      madvise(data, st.st_size, MADV_SEQUENTIAL);
+      d_data = static_cast<const char*>(data);
+      d_size = st.st_size;
+      d_pos  = d_data + BinaryTrace::MAGIC.size();
+      d_end  = d_data + d_size;
+    }
+  }
+  close(fd);
+
+  if (d_data)
+  {
+    uint8_t version = d_pos < d_end ? *d_pos++ : 0;
+    MURXLA_CHECK_CONFIG(version == BinaryTrace::VERSION)
+        << "untrace: unsupported binary trace version "
+        << static_cast<uint32_t>(version) << " in '" << file_name << "'";
+  }
+}
+
+TraceReader::~TraceReader()
+{
+  if (d_data)
+  {
+    munmap(const_cast<char*>(d_data), d_size);
+  }
+}
+
+bool
+TraceReader::is_open() const
+{
+  return d_data != nullptr || d_text.is_open();
+}
+
+bool
+TraceReader::next_line(std::string& line, bool& eol)
+{
+  if (is_binary())
+  {
+    if (d_pos == d_end) return false;
+    d_line_number += 1;
+
+    uint32_t seed;
+    std::string id;
+    std::vector<std::string> tokens;
+    BinaryTrace::Record record = decode(seed, id, tokens);
+    if (record == BinaryTrace::RAW || record == BinaryTrace::RAW_NO_EOL)
+    {
+      line = d_line;
+      eol  = record == BinaryTrace::RAW;
+    }
+    else
+    {
+      render_line(seed, id, tokens, line);
+      eol = true;
+    }
+    return true;
+  }
+
+  if (!std::getline(d_text, line)) return false;
+  d_line_number += 1;
+  eol = !d_text.eof();
+  return true;
+}
+
+bool
+TraceReader::next(uint32_t& seed,
+                  std::string& id,
+                  std::vector<std::string>& tokens)
+{
+  while (true)
+  {
+    if (is_binary())
+    {
+      if (d_pos == d_end) return false;
+      d_line_number += 1;
+      BinaryTrace::Record record = decode(seed, id, tokens);
+      if (record != BinaryTrace::RAW && record != BinaryTrace::RAW_NO_EOL)
+      {
+        return true;
+      }
+    }
+    else
+    {
+      if (!std::getline(d_text, d_line)) return false;
+      d_line_number += 1;
+    }
+
+    if (d_line.empty()) continue;
+    if (d_line[0] == '#') continue;
+    if (d_line.rfind("set-murxla-options", 0) == 0) continue;
+
+    std::tie(seed, id, tokens) = tokenize(d_line);
+    return true;
+  }
+}
+
+BinaryTrace::Record
+TraceReader::decode(uint32_t& seed,
+                    std::string& id,
+                    std::vector<std::string>& tokens)
+{
+  assert(d_pos < d_end);
+  uint8_t record = *d_pos++;
+  switch (record)
+  {
+    case BinaryTrace::RAW:
+    case BinaryTrace::RAW_NO_EOL:
+    {
+      std::string_view line = decode_str();
+      d_line.assign(line.data(), line.size());
+    }
+    break;
+
+    case BinaryTrace::ACTION:
+    case BinaryTrace::ACTION_NEW_KIND:
+    {
+      seed = static_cast<uint32_t>(decode_uint());
+      if (record == BinaryTrace::ACTION_NEW_KIND)
+      {
+        d_kinds.push_back(decode_str());
+        id.assign(d_kinds.back().data(), d_kinds.back().size());
+      }
+      else
+      {
+        uint64_t kind = decode_uint();
+        if (kind >= d_kinds.size())
+        {
+          throw MurxlaUntraceException(
+              d_file_name, d_line_number, "invalid action kind index");
+        }
+        id.assign(d_kinds[kind].data(), d_kinds[kind].size());
+      }
+      decode_tokens(tokens);
+    }
+    break;
+
+    case BinaryTrace::RETURN:
+      seed = 0;
+      id   = "return";
+      decode_tokens(tokens);
+      break;
+
+    default:
+      throw MurxlaUntraceException(
+          d_file_name, d_line_number, "invalid binary trace record");
+  }
+  return static_cast<BinaryTrace::Record>(record);
+}
+
+uint64_t
+TraceReader::decode_uint()
+{
+  uint64_t res = 0;
+  for (uint32_t shift = 0; shift < 64; shift += 7)
+  {
+    if (d_pos == d_end) break;
+    uint8_t byte = *d_pos++;
+    res |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if (!(byte & 0x80)) return res;
+  }
+  throw MurxlaUntraceException(
+      d_file_name, d_line_number, "truncated binary trace record");
+}
+
+std::string_view
+TraceReader::decode_str()
+{
+  uint64_t size = decode_uint();
+  if (size > static_cast<uint64_t>(d_end - d_pos))
+  {
+    throw MurxlaUntraceException(
+        d_file_name, d_line_number, "truncated binary trace record");
+  }
+  std::string_view res(d_pos, size);
+  d_pos += size;
+  return res;
+}
+
+void
+TraceReader::decode_tokens(std::vector<std::string>& tokens)
+{
+  uint64_t size = decode_uint();
+  /* Every token takes at least two bytes. */
+  if (size > static_cast<uint64_t>(d_end - d_pos))
+  {
+    throw MurxlaUntraceException(
+        d_file_name, d_line_number, "truncated binary trace record");
+  }
+  tokens.resize(size);
+
+  char buf[MAX_UINT_DIGITS + 2];
+  for (auto& t : tokens)
+  {
+    if (d_pos == d_end)
+    {
+      throw MurxlaUntraceException(
+          d_file_name, d_line_number, "truncated binary trace record");
+    }
+    uint8_t kind = *d_pos++;
+    switch (kind)
+    {
+      case BinaryTrace::SORT_ID:
+      case BinaryTrace::TERM_ID:
+      case BinaryTrace::UINT:
+      {
+        char* begin = buf;
+        if (kind != BinaryTrace::UINT)
+        {
+          *begin++ = kind == BinaryTrace::SORT_ID ? 's' : 't';
+        }
+        auto [end, ec] =
+            std::to_chars(begin, buf + sizeof(buf), decode_uint());
+        assert(ec == std::errc());
+        t.assign(buf, end);
+      }
+      break;
+
+      case BinaryTrace::STRING:
+      {
+        std::string_view s = decode_str();
+        t.assign(s.data(), s.size());
+      }
+      break;
+
+      case BinaryTrace::SYMBOL_NEW:
+        d_symbols.push_back(decode_str());
+        t.assign(d_symbols.back().data(), d_symbols.back().size());
+        break;
+
+      case BinaryTrace::SYMBOL:
+      {
+        uint64_t symbol = decode_uint();
+        if (symbol >= d_symbols.size())
+        {
+          throw MurxlaUntraceException(
+              d_file_name, d_line_number, "invalid symbol index");
+        }
+        t.assign(d_symbols[symbol].data(), d_symbols[symbol].size());
+      }
+      break;
+
+      default:
+        throw MurxlaUntraceException(
+            d_file_name, d_line_number, "invalid binary trace token");
+    }
+  }
+}
+
+/* -------------------------------------------------------------------------- */
+
+}  // namespace murxla
@@ -0,0 +1,249 @@
+/***
+ * Murxla: A Model-Based API Fuzzer for SMT solvers.
+ *
+ * This file is part of Murxla.
+ *
+ * Copyright (C) 2019-2022 by the authors listed in the AUTHORS file.
+ *
+ * See LICENSE for more information on using this software.
+ */
+#ifndef __MURXLA__BINARY_TRACE_H
+#define __MURXLA__BINARY_TRACE_H
+
+#include <cstdint>
+#include <fstream>
+#include <streambuf>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace murxla {
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * The compact binary API trace format.
+ *
+ * A binary trace starts with MAGIC followed by a VERSION byte, and then
+ * contains exactly one record per line of the corresponding text trace.
+ * Statement lines are stored as an ACTION record (the seed, the index of the
+ * action kind and the tokens), return lines as a RETURN record (the tokens).
+ * Action kinds are interned: the first occurrence of a kind is stored as an
+ * ACTION_NEW_KIND record, which carries the kind name and implicitly assigns
+ * it the next free index. Symbolic tokens (kinds of sorts and operators,
+ * logics, ..., i.e., tokens starting with an upper case letter) are interned
+ * the same way. Sort and term ids and unsigned integers are stored as varints
+ * (LEB128), all other tokens as length-prefixed strings.
+ *
+ * All other lines (comments, options, and lines that would not be rendered
+ * back byte by byte from their tokens) are stored verbatim as a RAW record,
+ * which makes the conversion between both formats lossless.
+ */
+class BinaryTrace
+{
+ public:
+  /** The magic bytes at the beginning of a binary trace. */
+  inline static const std::string MAGIC = "\x7f" "MURXLA";
+  /** The version of the binary trace format. */
+  static constexpr uint8_t VERSION = 1;
+
+  /** The kinds of records. */
+  enum Record : uint8_t
+  {
+    /** A verbatim line. */
+    RAW,
+    /** A verbatim line that is not terminated with a newline (end of file). */
+    RAW_NO_EOL,
+    /** A statement line with a previously interned action kind. */
+    ACTION,
+    /** A statement line that interns its action kind. */
+    ACTION_NEW_KIND,
+    /** A return line. */
+    RETURN,
+  };
+
+  /** The kinds of tokens of ACTION, ACTION_NEW_KIND and RETURN records. */
+  enum Token : uint8_t
+  {
+    SORT_ID,
+    TERM_ID,
+    UINT,
+    STRING,
+    /** A previously interned symbolic token. */
+    SYMBOL,
+    /** A symbolic token that is interned. */
+    SYMBOL_NEW,
+  };
+
+  /**
+   * Determine if the given file is a binary trace.
+   * @param file_name The name of the file.
+   * @return True if the file starts with the binary trace header.
+   */
+  static bool is_binary_trace(const std::string& file_name);
+
+  /**
+   * Convert a trace from text to binary format or vice versa, depending on
+   * the format of the input trace.
+   * @param in_file_name  The name of the trace to convert.
+   * @param out_file_name The name of the converted trace.
+   */
+  static void convert(const std::string& in_file_name,
+                      const std::string& out_file_name);
+};
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Stream buffer that encodes the text trace lines written to it into the
+ * binary trace format, and writes the encoded records to the given stream
+ * buffer.
+ *
+ * Lines are encoded and written to the underlying stream buffer when they are
+ * terminated. Flushing the stream flushes the underlying stream buffer.
+ */
+class BinaryTraceWriter : public std::streambuf
+{
+ public:
+  /**
+   * Constructor.
+   * @param out The stream buffer to write the binary trace to.
+   */
+  BinaryTraceWriter(std::streambuf* out);
+  /** Destructor. Encodes unterminated lines and flushes all records. */
+  ~BinaryTraceWriter();
+
+ protected:
+  int_type overflow(int_type c) override;
+  std::streamsize xsputn(const char* s, std::streamsize n) override;
+  int sync() override;
+
+ private:
+  /**
+   * Encode the current line into a record.
+   * @param eol True if the line is terminated by a newline.
+   */
+  void encode_line(bool eol);
+  /**
+   * Try to encode the current line as ACTION, ACTION_NEW_KIND or RETURN
+   * record.
+   * @return False if the line can not be rendered back from its tokens.
+   */
+  bool encode_statement();
+  /**
+   * Encode a token of an ACTION, ACTION_NEW_KIND or RETURN record.
+   * @param token The token.
+   */
+  void encode_token(const std::string& token);
+  /** Write the buffered records to the underlying stream buffer. */
+  bool write_records();
+
+  /** The underlying stream buffer. */
+  std::streambuf* d_out;
+  /** The current (unterminated) line. */
+  std::string d_line;
+  /** The encoded records that have not been written yet. */
+  std::string d_records;
+  /** Map interned action kinds to their index. */
+  std::unordered_map<std::string, uint64_t> d_kinds;
+  /** Map interned symbolic tokens to their index. */
+  std::unordered_map<std::string, uint64_t> d_symbols;
+};
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Streaming reader for API traces in text and binary format.
+ *
+ * Binary traces are memory-mapped and decoded in place, without an
+ * intermediate text representation. Text traces are read line by line and
+ * tokenized with tokenize().
+ */
+class TraceReader
+{
+ public:
+  /**
+   * Constructor.
+   * @param file_name The name of the trace file.
+   */
+  TraceReader(const std::string& file_name);
+  /** Destructor. */
+  ~TraceReader();
+
+  /** @return True if the trace file was successfully opened. */
+  bool is_open() const;
+  /** @return True if the trace is in binary format. */
+  bool is_binary() const { return d_data != nullptr; }
+
+  /**
+   * Read the next line of the trace in its text representation.
+   * @param line The resulting line (without newline).
+   * @param eol  Set to true if the line is terminated with a newline.
+   * @return False if the end of the trace is reached.
+   */
+  bool next_line(std::string& line, bool& eol);
+  /**
+   * Read the next statement of the trace. Skips empty lines, comments and
+   * the options line.
+   * @param seed   The resulting solver seed of the statement.
+   * @param id     The resulting action kind, or "return".
+   * @param tokens The resulting tokens. Existing strings are reused.
+   * @return False if the end of the trace is reached.
+   */
+  bool next(uint32_t& seed, std::string& id, std::vector<std::string>& tokens);
+
+  /**
+   * Get the line number of the line that was read last.
+   * @return The line number.
+   */
+  uint32_t get_line_number() const { return d_line_number; }
+
+ private:
+  /**
+   * Decode a record of a binary trace.
+   * @param seed   The resulting solver seed of the statement.
+   * @param id     The resulting action kind, or "return".
+   * @param tokens The resulting tokens.
+   * @return The record kind. For RAW and RAW_NO_EOL records, the verbatim
+   *         line is stored in d_line instead.
+   */
+  BinaryTrace::Record decode(uint32_t& seed,
+                             std::string& id,
+                             std::vector<std::string>& tokens);
+  /** Decode a varint. */
+  uint64_t decode_uint();
+  /** Decode a length-prefixed string. */
+  std::string_view decode_str();
+  /** Decode the tokens of a statement. */
+  void decode_tokens(std::vector<std::string>& tokens);
+
+  /** The name of the trace file. */
+  std::string d_file_name;
+  /** The line number of the line that was read last. */
+  uint32_t d_line_number = 0;
+
+  /** The input file stream for text traces. */
+  std::ifstream d_text;
+  /** The current line (text traces and RAW records). */
+  std::string d_line;
+
+  /** The memory-mapped data of binary traces. */
+  const char* d_data = nullptr;
+  /** The size of the memory-mapped data of binary traces. */
+  size_t d_size = 0;
+  /** The current position within the memory-mapped data. */
+  const char* d_pos = nullptr;
+  /** The end of the memory-mapped data. */
+  const char* d_end = nullptr;
+  /** The interned action kinds, for binary traces. */
+  std::vector<std::string_view> d_kinds;
+  /** The interned symbolic tokens, for binary traces. */
+  std::vector<std::string_view> d_symbols;
+};
+
+/* -------------------------------------------------------------------------- */
+
+}  // namespace murxla
+
+#endif
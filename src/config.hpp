@@ -46,6 +46,32 @@
  * of a kind has been exceeded, increase this value.
  */
 #define MURXLA_MAX_KIND_LEN 100
+/**
+ * Number of buckets of latency histograms in statistics. Bucket i counts
+ * latencies in [2^i, 2^(i+1)) timer ticks.
+ */
+#define MURXLA_STATS_N_BUCKETS 40
+
+/**
+ * Maximum size in bytes of the stdout and stderr output of a forked test run
+ * that is captured by the main process, respectively. Output beyond this limit
+ * is discarded.
+ */
+#define MURXLA_MAX_CAPTURED_OUTPUT (16 * 1024 * 1024)
+
+/**
+ * Maximum number of snapshots of replayed trace prefixes that are kept alive
+ * at the same time when delta debugging with --dd-share-prefix.
+ */
+#define MURXLA_DD_MAX_SNAPSHOTS 32
+
+/** The size in bytes of the buffer for buffered trace output. */
+#define MURXLA_TRACE_BUFFER_SIZE (1024 * 1024)
+/**
+ * The time in milliseconds a timed out solver process with buffered trace
+ * output gets to write its buffers on SIGTERM before it is killed.
+ */
+#define MURXLA_TERM_GRACE_PERIOD_MS 100
 
 /** Minimum bit-width for bit-vector terms. */
 #define MURXLA_BW_MIN 1
@@ -12,7 +12,10 @@
 #include <chrono>
 #include <filesystem>
 #include <fstream>
+#include <list>
+#include <memory>
 
+#include "config.hpp"
 #include "except.hpp"
 #include "murxla.hpp"
 #include "solver_manager.hpp"
@@ -71,6 +74,17 @@ split_superset(const std::vector<size_t> superset, size_t subset_size)
   assert(subsets.size() == (size_t) superset_size / subset_size);
   return subsets;
 }
+
+/**
+ * Return true if one of the lines of the given output contains string 's'
+ * (see find_in_file()).
+ */
+bool
+find_in_output(const std::string& output, const std::string& s)
+{
+  return s.find('\n') == std::string::npos
+         && output.find(s) != std::string::npos;
+}
 }  // namespace
 
 /* -------------------------------------------------------------------------- */
@@ -85,6 +99,8 @@ DD::DD(Murxla* murxla, uint64_t seed)
       get_tmp_file_path("tmp-dd-gold.err", d_murxla->d_tmp_dir);
   d_tmp_trace_file_name =
       get_tmp_file_path("tmp-api-dd.trace", d_murxla->d_tmp_dir);
+  d_snapshot_trace_file_name =
+      get_tmp_file_path("tmp-dd-snapshot.trace", d_murxla->d_tmp_dir);
 }
 
 void
@@ -126,12 +142,16 @@ DD::run(const std::string& input_trace_file_name,
     std::ifstream gold_out_file = open_input_file(d_gold_out_file_name, false);
     std::stringstream ss;
     ss << gold_out_file.rdbuf();
-    MURXLA_MESSAGE_DD << "golden stdout output: " << ss.str();
+    d_gold_out = ss.str();
+    MURXLA_MESSAGE_DD << "golden stdout output: " << d_gold_out;
     gold_out_file.close();
   }
   {
     std::ifstream gold_err_file = open_input_file(d_gold_err_file_name, false);
-    MURXLA_MESSAGE_DD << "golden stderr output: " << gold_err_file.rdbuf();
+    std::stringstream ss;
+    ss << gold_err_file.rdbuf();
+    d_gold_err = ss.str();
+    MURXLA_MESSAGE_DD << "golden stderr output: " << d_gold_err;
     gold_err_file.close();
   }
   if (d_murxla->d_options.dd_ignore_out)
@@ -157,6 +177,18 @@ DD::run(const std::string& input_trace_file_name,
                       << "' in stderr output";
   }
 
+  if (d_murxla->d_options.dd_share_prefix)
+  {
+    d_use_snapshots = d_murxla->supports_snapshots();
+    MURXLA_WARN(!d_use_snapshots)
+        << "sharing trace prefixes when delta debugging is not supported "
+           "for the configured solver";
+    if (d_use_snapshots)
+    {
+      MURXLA_MESSAGE_DD << "forking tests from snapshots of shared prefixes";
+    }
+  }
+
   /* Start delta debugging */
 
   /* Represent input trace as vector of lines.
@@ -228,6 +260,8 @@ DD::run(const std::string& input_trace_file_name,
     iterations += 1;
   } while (!fixed_point);
 
+  delete_snapshots();
+
   /* Write minimized trace file to path if given. */
   assert(!reduced_trace_file_name.empty());
   if (!d_murxla->d_options.out_dir.empty())
@@ -239,6 +273,19 @@ DD::run(const std::string& input_trace_file_name,
   MURXLA_MESSAGE_DD;
   MURXLA_MESSAGE_DD << d_ntests_success << " (of " << d_ntests
                     << ") tests reduced successfully";
+  MURXLA_MESSAGE_DD << d_ntests_cached << " (of " << d_ntests
+                    << ") tests answered from cache (" << std::fixed
+                    << std::setprecision(2)
+                    << (d_ntests == 0 ? 0
+                                      : static_cast<double>(d_ntests_cached)
+                                            / static_cast<double>(d_ntests)
+                                            * 100)
+                    << "% hit rate)";
+  if (d_use_snapshots)
+  {
+    MURXLA_MESSAGE_DD << d_ntests_snapshot << " (of " << d_ntests
+                      << ") tests forked from snapshots";
+  }
 
   if (std::filesystem::exists(d_tmp_trace_file_name))
   {
@@ -270,6 +317,35 @@ DD::minimize_lines(Result golden_exit,
   size_t n_lines_cur = n_lines;
   size_t subset_size = n_lines_cur / 2;
 
+  /* A candidate test run, identified by its iteration over the subsets. */
+  struct Candidate
+  {
+    size_t d_iteration;
+    std::vector<size_t> d_superset;
+    /* The digest of the serialized candidate trace. */
+    TraceDigest d_digest;
+    /* False if the candidate is answered from the test cache. */
+    bool d_started;
+    /* The serialized candidate trace, only kept while the candidate is in
+     * flight (for re-running it). */
+    std::string d_trace;
+    uint32_t d_worker;
+    Murxla::TestRun d_run;
+    /* True if other candidates were in flight at the same time. */
+    bool d_concurrent;
+  };
+
+  /* The workers that are currently not executing a candidate. */
+  uint32_t num_jobs = std::max<uint32_t>(d_murxla->d_options.num_jobs, 1);
+  std::vector<uint32_t> idle_workers;
+  for (uint32_t i = 0; i < num_jobs; ++i)
+  {
+    idle_workers.push_back(num_jobs - i - 1);
+  }
+  /* Each worker replays its candidate from a private trace file. */
+  std::string trace_file_name =
+      std::filesystem::path(input_trace_file_name).filename();
+
   while (subset_size > 0)
   {
     std::vector<std::vector<size_t>> subsets =
@@ -277,25 +353,128 @@ DD::minimize_lines(Result golden_exit,
 
     std::vector<size_t> superset_cur;
     std::unordered_set<size_t> excluded_sets;
+    /* The in-flight candidates, in the order of creation. */
+    std::list<Candidate> candidates;
+    /* The iteration of the next candidate to start. */
+    size_t i_next = 0;
+
+    /* Cancel all candidates after the current (first) one, they are
+     * restarted after the current candidate has been processed. */
+    auto cancel_candidates = [&]() {
+      for (auto it = std::next(candidates.begin()); it != candidates.end();
+           ++it)
+      {
+        if (!it->d_started) continue;
+        d_murxla->cancel_test_run(it->d_run);
+        idle_workers.push_back(it->d_worker);
+      }
+      candidates.erase(std::next(candidates.begin()), candidates.end());
+      i_next = candidates.front().d_iteration + 1;
+    };
+
+    /* The candidates of this level share the lines up to the subset they
+     * remove, create snapshots at the subset boundaries. */
+    if (d_use_snapshots)
+    {
+      std::vector<size_t> prefix_sizes;
+      for (size_t i = 0, size = 0, n = subsets.size() - 1; i < n; ++i)
+      {
+        if (size > 0) prefix_sizes.push_back(size);
+        size += subsets[i].size();
+      }
+      add_snapshots(lines, included_lines, prefix_sizes);
+    }
+
     /* we skip the first subset (will always fail since it contains 'new') */
     for (size_t i = 0, n = subsets.size() - 1; i < n; ++i)
     {
-      /* remove subsets from last to first */
-      size_t idx = n - i - 1;
+      /* Speculatively start the candidates of the next iterations, assuming
+       * that all candidates before them fail. */
+      for (; i_next < n && !idle_workers.empty(); ++i_next)
+      {
+        /* remove subsets from last to first */
+        size_t idx = n - i_next - 1;
+
+        std::unordered_set<size_t> ex(excluded_sets);
+        ex.insert(idx);
+
+        std::vector<size_t> superset = remove_subsets(subsets, ex);
+        std::string trace            = serialize_lines(lines, superset);
+        TraceDigest digest(trace);
+        bool start = d_test_cache.find(digest) == d_test_cache.end();
+
+        candidates.push_back(
+            {i_next, superset, digest, start, {}, 0, {}, false});
+        if (!start) continue;
+
+        Candidate& cand = candidates.back();
+        cand.d_trace    = std::move(trace);
+        cand.d_worker   = idle_workers.back();
+        idle_workers.pop_back();
+
+        std::string tmp_dir = get_worker_tmp_dir(cand.d_worker);
+        cand.d_run          = new_test(
+            cand.d_trace, get_tmp_file_path(trace_file_name, tmp_dir), tmp_dir);
+        start_test(cand.d_run, lines, superset);
+      }
+      if (candidates.size() > 1)
+      {
+        for (Candidate& c : candidates)
+        {
+          c.d_concurrent = true;
+        }
+      }
 
-      std::unordered_set<size_t> ex(excluded_sets);
-      ex.insert(idx);
+      Candidate& cand = candidates.front();
+      assert(cand.d_iteration == i);
 
-      std::vector<size_t> tmp_superset = test(golden_exit,
-                                              lines,
-                                              remove_subsets(subsets, ex),
-                                              input_trace_file_name);
-      if (!tmp_superset.empty())
+      bool success;
+      if (!cand.d_started)
+      {
+        bool cached = lookup_test(cand.d_digest, success);
+        assert(cached);
+        (void) cached;
+      }
+      else
       {
-        superset_cur = tmp_superset;
-        excluded_sets.insert(idx);
+        while (!cand.d_run.d_done)
+        {
+          d_murxla->wait_test_run();
+        }
+
+        /* The time limit for candidates is based on the runtime of the golden
+         * run, candidates that are executed concurrently may exceed it due to
+         * contention. Re-run such candidates on their own to get the same
+         * result as in the sequential case. */
+        if (cand.d_run.d_result == RESULT_TIMEOUT && cand.d_concurrent)
+        {
+          cancel_candidates();
+          cand.d_run = new_test(cand.d_trace,
+                                cand.d_run.d_untrace_file_name,
+                                cand.d_run.d_tmp_dir);
+          start_test(cand.d_run, lines, cand.d_superset);
+          while (!cand.d_run.d_done)
+          {
+            d_murxla->wait_test_run();
+          }
+        }
+        idle_workers.push_back(cand.d_worker);
+        success = finish_test(golden_exit, cand.d_run, cand.d_digest);
       }
+
+      if (success)
+      {
+        superset_cur = cand.d_superset;
+        excluded_sets.insert(n - i - 1);
+
+        /* All outstanding candidates were started assuming that this
+         * candidate fails, cancel them and restart with the updated set of
+         * excluded subsets. */
+        cancel_candidates();
+      }
+      candidates.pop_front();
     }
+    assert(candidates.empty());
     if (superset_cur.empty())
     {
       subset_size = subset_size / 2;
@@ -859,7 +1038,7 @@ DD::minimize_line(Result golden_exit,
   bool res = false;
 
   /* Create OpKindManager to query Op configuration. */
-  statistics::Statistics opmgr_stats;
+  auto opmgr_stats = statistics::Statistics::create();
   TheorySet opmgr_enabled_theories;
   for (int32_t t = 0; t < THEORY_ALL; ++t)
   {
@@ -871,7 +1050,7 @@ DD::minimize_line(Result golden_exit,
                       {},
                       {},
                       false,
-                      &opmgr_stats);
+                      opmgr_stats.get());
   {
     SolverSeedGenerator opmgr_sng(0);
     std::unique_ptr<Solver> opmgr_solver(d_murxla->create_solver(opmgr_sng));
@@ -978,67 +1157,261 @@ DD::test(Result golden_exit,
          const std::string& untrace_file_name)
 {
   std::vector<size_t> res_superset;
-  std::string tmp_out_file_name =
-      get_tmp_file_path("tmp-dd.out", d_murxla->d_tmp_dir);
-  std::string tmp_err_file_name =
-      get_tmp_file_path("tmp-dd.err", d_murxla->d_tmp_dir);
-
-  write_lines_to_file(lines, superset, untrace_file_name);
-  /* while delta debugging, do not trace to file or stdout */
-  Result exit = d_murxla->run(d_seed,
-                              d_time,
-                              tmp_out_file_name,
-                              tmp_err_file_name,
-                              "",
-                              untrace_file_name,
-                              true,
-                              false,
-                              Murxla::TraceMode::NONE);
-  d_ntests += 1;
-  if (exit == golden_exit
-      && (d_murxla->d_options.dd_ignore_out
-          || (!d_murxla->d_options.dd_match_out.empty()
-              && find_in_file(
-                  tmp_err_file_name, d_murxla->d_options.dd_match_out, false))
-          || compare_files(tmp_out_file_name, d_gold_out_file_name))
-      && (d_murxla->d_options.dd_ignore_err
-          || (!d_murxla->d_options.dd_match_err.empty()
-              && find_in_file(
-                  tmp_err_file_name, d_murxla->d_options.dd_match_err, false))
-          || compare_files(tmp_err_file_name, d_gold_err_file_name)))
+  std::string trace = serialize_lines(lines, superset);
+  TraceDigest digest(trace);
+  bool success;
+
+  if (!lookup_test(digest, success))
+  {
+    Murxla::TestRun run =
+        new_test(trace, untrace_file_name, get_worker_tmp_dir(0));
+    start_test(run, lines, superset);
+    while (!run.d_done)
+    {
+      d_murxla->wait_test_run();
+    }
+    success = finish_test(golden_exit, run, digest);
+  }
+  if (success)
   {
     res_superset = superset;
-    d_ntests_success += 1;
   }
   return res_superset;
 }
 
+Murxla::TestRun
+DD::new_test(const std::string& trace,
+             const std::string& untrace_file_name,
+             const std::string& tmp_dir)
+{
+  std::ofstream out_file = open_output_file(untrace_file_name, false);
+  out_file << trace;
+  out_file.close();
+  /* while delta debugging, do not trace to file or stdout, the output of the
+   * test run is only captured in memory */
+  return d_murxla->new_test_run(d_seed,
+                                d_time,
+                                tmp_dir,
+                                DEVNULL,
+                                DEVNULL,
+                                "",
+                                untrace_file_name,
+                                true,
+                                Murxla::TraceMode::NONE);
+}
+
 void
-DD::write_lines_to_file(const std::vector<std::vector<std::string>>& lines,
-                        const std::vector<size_t> indices,
-                        const std::string& out_file_name)
+DD::start_test(Murxla::TestRun& run,
+               const std::vector<std::vector<std::string>>& lines,
+               const std::vector<size_t>& superset)
 {
-  size_t size            = lines.size();
-  std::ofstream out_file = open_output_file(out_file_name, false);
+  if (d_use_snapshots)
+  {
+    size_t n = update_snapshot_lines(lines, superset);
+    /* Snapshot the prefix this test shares with the previous test if it is
+     * shared with the test before, too. */
+    if (n > 0 && n == d_snapshot_prefix_prev
+        && (d_snapshots.empty() || d_snapshots.back().first < n))
+    {
+      add_snapshot(n);
+    }
+    d_snapshot_prefix_prev = n;
+
+    if (!d_snapshots.empty())
+    {
+      auto& [n_lines, snapshot] = d_snapshots.back();
+      std::vector<size_t> suffix(superset.begin() + n_lines, superset.end());
+      write_lines_to_file(lines, suffix, run.d_untrace_file_name);
+      if (d_murxla->start_test_run(run, snapshot))
+      {
+        d_ntests_snapshot += 1;
+        return;
+      }
+      /* The snapshot process is not available anymore, replay full trace. */
+      delete_snapshots();
+      write_lines_to_file(lines, superset, run.d_untrace_file_name);
+    }
+  }
+  d_murxla->start_test_run(run, false);
+}
+
+size_t
+DD::update_snapshot_lines(const std::vector<std::vector<std::string>>& lines,
+                          const std::vector<size_t>& superset)
+{
+  size_t n    = 0;
+  size_t size = std::min(superset.size(), d_snapshot_lines.size());
+  while (n < size && lines[superset[n]] == d_snapshot_lines[n])
+  {
+    n += 1;
+  }
+  delete_snapshots(n);
+  d_snapshot_lines.resize(n);
+  for (size_t i = n, size = superset.size(); i < size; ++i)
+  {
+    d_snapshot_lines.push_back(lines[superset[i]]);
+  }
+  return n;
+}
+
+void
+DD::add_snapshots(const std::vector<std::vector<std::string>>& lines,
+                  const std::vector<size_t>& superset,
+                  const std::vector<size_t>& prefix_sizes)
+{
+  update_snapshot_lines(lines, superset);
+  d_snapshot_prefix_prev = 0;
+
+  /* Spread the snapshots evenly if there are too many prefixes. */
+  size_t step = prefix_sizes.size() / MURXLA_DD_MAX_SNAPSHOTS + 1;
+  for (size_t i = step - 1, size = prefix_sizes.size(); i < size; i += step)
+  {
+    if (!d_snapshots.empty() && d_snapshots.back().first >= prefix_sizes[i])
+    {
+      continue;
+    }
+    /* If the prefix can't be replayed, the longer ones can't either. */
+    if (!add_snapshot(prefix_sizes[i])) break;
+  }
+}
+
+bool
+DD::add_snapshot(size_t n)
+{
+  assert(n <= d_snapshot_lines.size());
+  if (d_snapshots.size() >= MURXLA_DD_MAX_SNAPSHOTS) return false;
+
+  size_t n_parent               = 0;
+  const Murxla::Snapshot* parent = nullptr;
+  if (!d_snapshots.empty())
+  {
+    n_parent = d_snapshots.back().first;
+    parent   = &d_snapshots.back().second;
+  }
+  assert(n_parent < n);
+
+  std::vector<size_t> indices(n - n_parent);
+  std::iota(indices.begin(), indices.end(), n_parent);
+  write_lines_to_file(d_snapshot_lines, indices, d_snapshot_trace_file_name);
+
+  Murxla::Snapshot snapshot;
+  if (!d_murxla->new_snapshot(snapshot,
+                              d_seed,
+                              d_time,
+                              d_murxla->d_tmp_dir,
+                              d_snapshot_trace_file_name,
+                              parent))
+  {
+    return false;
+  }
+  d_snapshots.emplace_back(n, snapshot);
+  return true;
+}
+
+void
+DD::delete_snapshots(size_t n)
+{
+  while (!d_snapshots.empty() && d_snapshots.back().first > n)
+  {
+    d_murxla->delete_snapshot(d_snapshots.back().second);
+    d_snapshots.pop_back();
+  }
+}
+
+bool
+DD::finish_test(Result golden_exit,
+                Murxla::TestRun& run,
+                const TraceDigest& digest)
+{
+  const Options& options = d_murxla->d_options;
+  Result exit            = d_murxla->finish_test_run(run);
+  bool success =
+      exit == golden_exit
+      && (options.dd_ignore_out
+          || (!options.dd_match_out.empty()
+              && find_in_output(run.d_out, options.dd_match_out))
+          || run.d_out == d_gold_out)
+      && (options.dd_ignore_err
+          || (!options.dd_match_err.empty()
+              && find_in_output(run.d_err, options.dd_match_err))
+          || run.d_err == d_gold_err);
+
+  d_test_cache.emplace(digest, std::make_pair(exit, success));
+  d_ntests += 1;
+  if (success)
+  {
+    d_ntests_success += 1;
+  }
+  return success;
+}
+
+bool
+DD::lookup_test(const TraceDigest& digest, bool& success)
+{
+  auto it = d_test_cache.find(digest);
+  if (it == d_test_cache.end())
+  {
+    return false;
+  }
+  success = it->second.second;
+  d_ntests += 1;
+  d_ntests_cached += 1;
+  if (success)
+  {
+    d_ntests_success += 1;
+  }
+  return true;
+}
+
+std::string
+DD::get_worker_tmp_dir(uint32_t worker) const
+{
+  if (d_murxla->d_options.num_jobs <= 1)
+  {
+    return d_murxla->d_tmp_dir;
+  }
+  std::filesystem::path p(d_murxla->d_tmp_dir);
+  p /= "dd-worker-" + std::to_string(worker);
+  if (!std::filesystem::exists(p))
+  {
+    std::filesystem::create_directory(p);
+  }
+  return p.string();
+}
+
+std::string
+DD::serialize_lines(const std::vector<std::vector<std::string>>& lines,
+                    const std::vector<size_t>& indices) const
+{
+  size_t size = lines.size();
+  std::stringstream ss;
   if (!d_options_line.empty())
   {
-    out_file << d_options_line << std::endl;
+    ss << d_options_line << std::endl;
   }
   for (size_t idx : indices)
   {
     assert(idx < size);
     assert(lines[idx].size() > 0);
     assert(lines[idx].size() <= 2);
-    out_file << lines[idx][0];
+    ss << lines[idx][0];
     if (lines[idx].size() == 2)
     {
-      out_file << std::endl << lines[idx][1];
+      ss << std::endl << lines[idx][1];
     }
-    out_file << std::endl;
+    ss << std::endl;
   }
-  out_file.close();
+  return ss.str();
 }
 
-/* -------------------------------------------------------------------------- */
+void
+DD::write_lines_to_file(const std::vector<std::vector<std::string>>& lines,
+                        const std::vector<size_t> indices,
+                        const std::string& out_file_name)
+{
+  std::ofstream out_file = open_output_file(out_file_name, false);
+  out_file << serialize_lines(lines, indices);
+  out_file.close();
+}
 
 }  // namespace murxla
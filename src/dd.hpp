@@ -10,17 +10,19 @@
 #ifndef __MURXLA__DD_H
 #define __MURXLA__DD_H
 
+#include <array>
 #include <cstdint>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "action.hpp"
+#include "murxla.hpp"
 #include "result.hpp"
+#include "util.hpp"
 
 namespace murxla {
 
-class Murxla;
-
 class DD
 {
  public:
@@ -47,6 +49,43 @@ class DD
            std::string reduced_trace_file_name);
 
  private:
+  /**
+   * The digest of a serialized trace, identifies a test in the test cache
+   * without storing the trace itself.
+   */
+  struct TraceDigest
+  {
+    /** Construct the digest of the given serialized trace. */
+    TraceDigest(const std::string& trace)
+        : d_hash(hash128(trace)), d_size(trace.size())
+    {
+    }
+    bool operator==(const TraceDigest& other) const
+    {
+      return d_hash == other.d_hash && d_size == other.d_size;
+    }
+    /** The 128-bit hash value of the trace. */
+    std::array<uint64_t, 2> d_hash;
+    /** The size of the trace. */
+    size_t d_size;
+  };
+  struct TraceDigestHash
+  {
+    size_t operator()(const TraceDigest& digest) const
+    {
+      return digest.d_hash[0];
+    }
+  };
+
+  /**
+   * Minimize the number of trace lines.
+   *
+   * The complement subsets of one granularity level are tested concurrently
+   * on up to Options::num_jobs workers. Candidates are started and their
+   * results are consumed in the same order as in the sequential case, and all
+   * outstanding candidates are canceled once a candidate succeeds. The result
+   * is thus independent of the number of workers.
+   */
   bool minimize_lines(Result golden_exit,
                       const std::vector<std::vector<std::string>>& lines,
                       std::vector<size_t>& included_lines,
@@ -78,6 +117,90 @@ class DD
                            const std::vector<size_t>& superset,
                            const std::string& input_trace_file_name);
 
+  /**
+   * Create a test run that replays the given serialized trace (see
+   * serialize_lines()). The trace is written to trace file
+   * 'untrace_file_name', the test run uses 'tmp_dir' for its temp files.
+   */
+  Murxla::TestRun new_test(const std::string& trace,
+                           const std::string& untrace_file_name,
+                           const std::string& tmp_dir);
+
+  /**
+   * Start given test run (see new_test()) that replays the trace lines at the
+   * indices given in 'superset'.
+   *
+   * If snapshots are enabled, the test run is forked from the snapshot that
+   * replayed the longest prefix of these lines, and only replays the
+   * remaining lines.
+   */
+  void start_test(Murxla::TestRun& run,
+                  const std::vector<std::vector<std::string>>& lines,
+                  const std::vector<size_t>& superset);
+
+  /**
+   * Finalize given terminated test run and record its outcome in the test
+   * cache under the given digest of its serialized trace.
+   *
+   * Returns true if the test run preserved the golden exit code and the
+   * golden (or matched) stdout and stderr output.
+   */
+  bool finish_test(Result golden_exit,
+                   Murxla::TestRun& run,
+                   const TraceDigest& digest);
+
+  /**
+   * Look up the outcome of a test of the serialized trace with the given
+   * digest in the test cache.
+   *
+   * Returns false if no such trace was tested yet. Else, 'success' is set to
+   * the outcome of the test, and the test is counted as a cached test.
+   */
+  bool lookup_test(const TraceDigest& digest, bool& success);
+
+  /**
+   * Make the trace lines at the indices given in 'superset' the trace that
+   * the snapshots replay a prefix of. Snapshots that did not replay a prefix
+   * of these lines are deleted.
+   *
+   * Returns the number of lines these lines share with the previous trace.
+   */
+  size_t update_snapshot_lines(
+      const std::vector<std::vector<std::string>>& lines,
+      const std::vector<size_t>& superset);
+
+  /**
+   * Create snapshots that replayed the first n lines of the trace lines at the
+   * indices given in 'superset', for each n in 'prefix_sizes' (ascending).
+   */
+  void add_snapshots(const std::vector<std::vector<std::string>>& lines,
+                     const std::vector<size_t>& superset,
+                     const std::vector<size_t>& prefix_sizes);
+
+  /**
+   * Create a snapshot that replayed the first 'n' lines of the snapshot
+   * trace, on top of the snapshot with the longest prefix.
+   * Returns false if the snapshot could not be created.
+   */
+  bool add_snapshot(size_t n);
+
+  /** Delete all snapshots that replayed more than 'n' lines. */
+  void delete_snapshots(size_t n = 0);
+
+  /**
+   * Get the directory for the temp files of given delta debugging worker.
+   * Creates the directory if it does not exist yet.
+   */
+  std::string get_worker_tmp_dir(uint32_t worker) const;
+
+  /**
+   * Serialize the trace lines at the indices given in 'indices', preceded by
+   * the trace line configuring murxla options (see write_lines_to_file()).
+   */
+  std::string serialize_lines(
+      const std::vector<std::vector<std::string>>& lines,
+      const std::vector<size_t>& indices) const;
+
   /**
    * Write trace lines to output file.
    *
@@ -113,10 +236,41 @@ class DD
   uint64_t d_ntests = 0;
   /** Number of successful tests performed while delta debugging. */
   uint64_t d_ntests_success = 0;
+  /** Number of tests answered from the test cache while delta debugging. */
+  uint64_t d_ntests_cached = 0;
+  /**
+   * The test cache, maps the digest of the serialized trace of a test to its
+   * result and its outcome (true if successful).
+   */
+  std::unordered_map<TraceDigest, std::pair<Result, bool>, TraceDigestHash>
+      d_test_cache;
+  /** Number of tests forked from snapshots while delta debugging. */
+  uint64_t d_ntests_snapshot = 0;
+
+  /** True if tests are forked from snapshots of replayed trace prefixes. */
+  bool d_use_snapshots = false;
+  /**
+   * The snapshots and the number of lines they replayed, in ascending order.
+   * Each snapshot replayed a prefix of 'd_snapshot_lines'.
+   */
+  std::vector<std::pair<size_t, Murxla::Snapshot>> d_snapshots;
+  /** The trace lines of the last test started from a snapshot. */
+  std::vector<std::vector<std::string>> d_snapshot_lines;
+  /**
+   * The number of lines the last test started shared with the test before.
+   */
+  size_t d_snapshot_prefix_prev = 0;
+  /** The temp trace file name for creating snapshots. */
+  std::string d_snapshot_trace_file_name;
+
   /** The output file name for the initial dd test run. */
   std::string d_gold_out_file_name;
   /** The error output file name for the initial dd test run. */
   std::string d_gold_err_file_name;
+  /** The stdout output of the initial dd test run. */
+  std::string d_gold_out;
+  /** The stderr output of the initial dd test run. */
+  std::string d_gold_err;
   /** The temp trace file name for dd. */
   std::string d_tmp_trace_file_name;
   /** The trace line configuring murxla options. */
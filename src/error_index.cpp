@@ -0,0 +1,237 @@
+/***
+ * Murxla: A Model-Based API Fuzzer for SMT solvers.
+ *
+ * This file is part of Murxla.
+ *
+ * Copyright (C) 2019-2022 by the authors listed in the AUTHORS file.
+ *
+ * See LICENSE for more information on using this software.
+ */
+#include "error_index.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <sstream>
+#include <unordered_set>
+
+namespace murxla {
+
+/* -------------------------------------------------------------------------- */
+
+namespace {
+
+/** Mix bits of given value (the finalizer of SplitMix64). */
+uint64_t
+mix(uint64_t x)
+{
+  x ^= x >> 30;
+  x *= 0xbf58476d1ce4e5b9;
+  x ^= x >> 27;
+  x *= 0x94d049bb133111eb;
+  x ^= x >> 31;
+  return x;
+}
+
+}  // namespace
+
+/* -------------------------------------------------------------------------- */
+
+double
+ErrorIndex::diff(const std::string& e1, const std::string& e2)
+{
+  size_t len = std::max(e1.size(), e2.size());
+  return static_cast<double>(diff(tokenize(e1), tokenize(e2)))
+         / static_cast<double>(len);
+}
+
+void
+ErrorIndex::add(const std::string& err)
+{
+  size_t idx             = d_entries.size();
+  Entry& entry           = d_entries.emplace_back();
+  entry.d_err            = err;
+  entry.d_tokens         = tokenize(err);
+  entry.d_num_non_digits = count_non_digits(entry.d_tokens);
+
+  Group& group    = d_groups[entry.d_tokens.size()];
+  group.d_max_len = std::max(group.d_max_len, err.size());
+  group.d_entries.push_back(idx);
+
+  Signature sig = get_signature(entry.d_tokens);
+  for (size_t band = 0; band < NUM_BANDS; ++band)
+  {
+    std::vector<size_t>& bucket = d_buckets[get_band_hash(sig, band)];
+    /* Bands of the same error only share a bucket on hash collisions. */
+    if (bucket.empty() || bucket.back() != idx)
+    {
+      bucket.push_back(idx);
+    }
+  }
+}
+
+const std::string*
+ErrorIndex::find(const std::string& err) const
+{
+  if (d_entries.empty()) return nullptr;
+
+  Tokens tokens = tokenize(err);
+  std::unordered_set<size_t> checked;
+
+  /* Candidates: errors that share at least one band. */
+  Signature sig = get_signature(tokens);
+  for (size_t band = 0; band < NUM_BANDS; ++band)
+  {
+    auto it = d_buckets.find(get_band_hash(sig, band));
+    if (it == d_buckets.end()) continue;
+    for (size_t idx : it->second)
+    {
+      if (!checked.insert(idx).second) continue;
+      const Entry& entry = d_entries[idx];
+      if (is_similar(err, tokens, entry.d_err, entry.d_tokens))
+      {
+        return &entry.d_err;
+      }
+    }
+  }
+
+  /* Fallback: compare with the remaining errors that may be similar. The
+   * difference of two errors is at least the difference of their numbers of
+   * tokens, plus the number of non-digit characters the error with fewer
+   * tokens has in excess of the other one (see diff()). */
+  size_t num_tokens     = tokens.size();
+  size_t num_non_digits = count_non_digits(tokens);
+  for (const auto& [n, group] : d_groups)
+  {
+    size_t min_diff_tokens = n > num_tokens ? n - num_tokens : num_tokens - n;
+    if (exceeds_max_diff(min_diff_tokens, err.size(), group.d_max_len))
+    {
+      continue;
+    }
+    for (size_t idx : group.d_entries)
+    {
+      if (checked.find(idx) != checked.end()) continue;
+      const Entry& entry = d_entries[idx];
+      /* On ties, diff() considers the given error to have fewer tokens. */
+      size_t nd1 = n < num_tokens ? entry.d_num_non_digits : num_non_digits;
+      size_t nd2 = n < num_tokens ? num_non_digits : entry.d_num_non_digits;
+      size_t min_diff = min_diff_tokens + (nd1 > nd2 ? nd1 - nd2 : 0);
+      if (exceeds_max_diff(min_diff, err.size(), entry.d_err.size()))
+      {
+        continue;
+      }
+      if (is_similar(err, tokens, entry.d_err, entry.d_tokens))
+      {
+        return &entry.d_err;
+      }
+    }
+  }
+  return nullptr;
+}
+
+ErrorIndex::Tokens
+ErrorIndex::tokenize(const std::string& s)
+{
+  std::istringstream buf(s);
+  return Tokens{std::istream_iterator<std::string>(buf),
+                std::istream_iterator<std::string>()};
+}
+
+size_t
+ErrorIndex::count_non_digits(const Tokens& tokens)
+{
+  size_t res = 0;
+  for (const auto& token : tokens)
+  {
+    res += static_cast<size_t>(
+        std::count_if(token.begin(), token.end(), [](char c) {
+          return !std::isdigit(static_cast<unsigned char>(c));
+        }));
+  }
+  return res;
+}
+
+size_t
+ErrorIndex::diff(const Tokens& t1, const Tokens& t2)
+{
+  if (t1.size() > t2.size())
+  {
+    return diff(t2, t1);
+  }
+
+  size_t res = t2.size() - t1.size();
+  for (size_t i = 0; i < t1.size(); ++i)
+  {
+    if (t1[i] != t2[i])
+    {
+      /* Ignore numbers for diff. */
+      for (char c : t1[i])
+      {
+        if (std::isdigit(static_cast<unsigned char>(c))) continue;
+        ++res;
+      }
+    }
+  }
+  return res;
+}
+
+bool
+ErrorIndex::is_similar(const std::string& e1,
+                       const Tokens& t1,
+                       const std::string& e2,
+                       const Tokens& t2)
+{
+  size_t len = std::max(e1.size(), e2.size());
+  return static_cast<double>(diff(t1, t2)) / static_cast<double>(len)
+         <= MAX_DIFF;
+}
+
+bool
+ErrorIndex::exceeds_max_diff(size_t min_diff, size_t len1, size_t len2)
+{
+  size_t len = std::max(len1, len2);
+  return static_cast<double>(min_diff) / static_cast<double>(len) > MAX_DIFF;
+}
+
+ErrorIndex::Signature
+ErrorIndex::get_signature(const Tokens& tokens)
+{
+  Signature res;
+  res.fill(std::numeric_limits<uint64_t>::max());
+  for (const auto& token : tokens)
+  {
+    /* Numbers are ignored for diff(), thus also for the signature. */
+    std::string t;
+    std::copy_if(token.begin(),
+                 token.end(),
+                 std::back_inserter(t),
+                 [](char c) {
+                   return !std::isdigit(static_cast<unsigned char>(c));
+                 });
+    if (t.empty()) continue;
+
+    uint64_t h = std::hash<std::string>{}(t);
+    for (size_t i = 0; i < res.size(); ++i)
+    {
+      res[i] = std::min(res[i], mix(h + i * 0x9e3779b97f4a7c15));
+    }
+  }
+  return res;
+}
+
+uint64_t
+ErrorIndex::get_band_hash(const Signature& sig, size_t band)
+{
+  uint64_t res = mix(band);
+  for (size_t i = band * BAND_SIZE; i < (band + 1) * BAND_SIZE; ++i)
+  {
+    res = mix(res ^ sig[i]);
+  }
+  return res;
+}
+
+/* -------------------------------------------------------------------------- */
+
+}  // namespace murxla
@@ -0,0 +1,146 @@
+/***
+ * Murxla: A Model-Based API Fuzzer for SMT solvers.
+ *
+ * This file is part of Murxla.
+ *
+ * Copyright (C) 2019-2022 by the authors listed in the AUTHORS file.
+ *
+ * See LICENSE for more information on using this software.
+ */
+#ifndef __MURXLA__ERROR_INDEX_H
+#define __MURXLA__ERROR_INDEX_H
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace murxla {
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * An index of error messages for looking up similar errors.
+ *
+ * Two errors are similar if they differ in at most 5% of characters (see
+ * diff()). Errors are tokenized once when added, and indexed via MinHash
+ * signatures of their sets of tokens, ignoring numbers (locality-sensitive
+ * hashing). A lookup first compares the given error with the errors that share
+ * a band of the signature, which finds similar errors that differ in numbers
+ * or in few tokens.
+ *
+ * Similar errors may share only few tokens, e.g., if one of them contains a
+ * very long token. Lookups are thus exact and only fall back to comparing the
+ * remaining errors if no candidate is similar. Errors are grouped by their
+ * number of tokens, and the fallback skips errors for which a lower bound of
+ * the difference, based on their number of tokens, non-digit characters and
+ * length, already exceeds 5%.
+ *
+ * If an error is similar to more than one indexed error, which one is found
+ * is unspecified.
+ */
+class ErrorIndex
+{
+ public:
+  /** The maximum difference (see diff()) of similar errors. */
+  static constexpr double MAX_DIFF = 0.05;
+
+  /**
+   * Compute the difference of two errors, i.e., the number of non-digit
+   * characters of tokens they differ in (compared by position), relative to
+   * the length of the longer error.
+   * @param e1 The first error.
+   * @param e2 The second error.
+   * @return The difference.
+   */
+  static double diff(const std::string& e1, const std::string& e2);
+
+  /**
+   * Add error.
+   * @param err The error.
+   */
+  void add(const std::string& err);
+  /**
+   * Find indexed error that is similar to the given error.
+   * @param err The error.
+   * @return A pointer to the similar error, or nullptr if there is none.
+   */
+  const std::string* find(const std::string& err) const;
+
+  /** @return The number of indexed errors. */
+  size_t size() const { return d_entries.size(); }
+  /** @return True if no errors are indexed. */
+  bool empty() const { return d_entries.empty(); }
+
+ private:
+  /**
+   * The number of bands of a MinHash signature. Errors with token sets of
+   * Jaccard similarity J share a band with probability
+   * 1 - (1 - J^BAND_SIZE)^NUM_BANDS.
+   */
+  static constexpr size_t NUM_BANDS = 32;
+  /** The number of MinHash values per band. */
+  static constexpr size_t BAND_SIZE = 4;
+
+  using Tokens    = std::vector<std::string>;
+  using Signature = std::array<uint64_t, NUM_BANDS * BAND_SIZE>;
+
+  /** An indexed error. */
+  struct Entry
+  {
+    /** The error. */
+    std::string d_err;
+    /** The tokens of the error. */
+    Tokens d_tokens;
+    /** The number of non-digit characters of the tokens. */
+    size_t d_num_non_digits;
+  };
+
+  /** Indexed errors with the same number of tokens. */
+  struct Group
+  {
+    /** The length of the longest error in the group. */
+    size_t d_max_len = 0;
+    /** The indices of the errors in d_entries. */
+    std::vector<size_t> d_entries;
+  };
+
+  /** Split string into (whitespace separated) tokens. */
+  static Tokens tokenize(const std::string& s);
+  /** Count the number of non-digit characters of the given tokens. */
+  static size_t count_non_digits(const Tokens& tokens);
+  /**
+   * Count the number of non-digit characters of tokens that differ between
+   * two tokenized errors, plus the difference in their number of tokens.
+   */
+  static size_t diff(const Tokens& t1, const Tokens& t2);
+  /** @return True if the given tokenized errors are similar. */
+  static bool is_similar(const std::string& e1,
+                         const Tokens& t1,
+                         const std::string& e2,
+                         const Tokens& t2);
+  /**
+   * @return True if given lower bound of the difference of two errors already
+   *         exceeds the maximum difference of similar errors.
+   */
+  static bool exceeds_max_diff(size_t min_diff, size_t len1, size_t len2);
+  /** Compute the MinHash signature of the given tokens. */
+  static Signature get_signature(const Tokens& tokens);
+  /** @return The hash value of the band with the given index. */
+  static uint64_t get_band_hash(const Signature& sig, size_t band);
+
+  /** The indexed errors, in the order they were added. */
+  std::vector<Entry> d_entries;
+  /** Map band hash values to the indices of errors in d_entries. */
+  std::unordered_map<uint64_t, std::vector<size_t>> d_buckets;
+  /** Map numbers of tokens to the errors with that many tokens. */
+  std::map<size_t, Group> d_groups;
+};
+
+/* -------------------------------------------------------------------------- */
+
+}  // namespace murxla
+
+#endif
@@ -17,6 +17,7 @@
 #include <sstream>
 #include <unordered_set>
 
+#include "binary_trace.hpp"
 #include "solver_manager.hpp"
 
 namespace murxla {
@@ -47,6 +48,10 @@ State::disable_action(Action::Kind kind)
     if (d_actions[i].d_action->get_kind() == kind)
     {
       d_weights[i] = 0;
+      if (!d_sampler.empty())
+      {
+        d_sampler.set(i, 0);
+      }
     }
   }
 }
@@ -56,24 +61,43 @@ State::run(RNGenerator& rng)
 {
   MURXLA_CHECK_CONFIG(!d_actions.empty()) << "no actions configured";
 
-  uint32_t idx      = rng.pick_weighted<uint32_t>(d_weights);
+  uint32_t idx;
+  if (rng.is_compat_sampling())
+  {
+    idx = rng.pick_weighted<uint32_t>(d_weights);
+  }
+  else
+  {
+    if (d_sampler.size() != d_weights.size())
+    {
+      d_sampler.assign(d_weights.begin(), d_weights.end());
+    }
+    idx = static_cast<uint32_t>(
+        rng.pick_weighted(d_sampler, 0, d_weights.size()));
+  }
   ActionTuple& atup = d_actions[idx];
 
   /* record state statistics */
-  ++d_mbt_stats->d_states[get_id()];
+  ++d_mbt_stats->shard().d_states[get_id()];
 
   assert(f_precond == nullptr || f_precond());
 
   /* record action statistics */
-  ++d_mbt_stats->d_actions[atup.d_action->get_id()];
+  ++d_mbt_stats->shard().d_actions[atup.d_action->get_id()];
 
   /* run action */
   atup.d_action->seed_solver_rng();
-  if (atup.d_action->generate()
+  bool generated;
+  {
+    statistics::Timer timer(
+        d_mbt_stats->shard().d_action_times[atup.d_action->get_id()]);
+    generated = atup.d_action->generate();
+  }
+  if (generated
       && (atup.d_next->f_precond == nullptr || atup.d_next->f_precond()))
   {
     /* record action statistics */
-    ++d_mbt_stats->d_actions_ok[atup.d_action->get_id()];
+    ++d_mbt_stats->shard().d_actions_ok[atup.d_action->get_id()];
 
     return d_actions[idx].d_next;
   }
@@ -85,6 +109,10 @@ State::run(RNGenerator& rng)
   else if (atup.d_action->disabled())
   {
     d_weights[idx] = 0;
+    if (!d_sampler.empty())
+    {
+      d_sampler.set(idx, 0);
+    }
   }
 
   return this;
@@ -131,7 +159,7 @@ FSM::FSM(RNGenerator& rng,
       d_solver_profile(solver_profile)
 {
   auto smgr_enabled_theories = d_smgr.get_enabled_theories();
-  auto unsupported_theory_combinations =
+  const auto& unsupported_theory_combinations =
       d_solver_profile.get_unsupported_theory_combinations();
 
   for (const auto& [theory, theory_list] : unsupported_theory_combinations)
@@ -548,7 +576,7 @@ FSM::configure()
   {
     Action* action                                  = std::get<0>(t);
     uint32_t priority                               = std::get<1>(t);
-    std::unordered_set<std::string> excluded_states = std::get<2>(t);
+    std::unordered_set<State::Kind> excluded_states = std::get<2>(t);
     State* next                                     = std::get<3>(t);
     for (const auto& s : d_states)
     {
@@ -574,7 +602,7 @@ FSM::configure()
     Action* action                                  = std::get<0>(t);
     uint32_t priority                               = std::get<1>(t);
     State* state                                    = std::get<2>(t);
-    std::unordered_set<std::string> excluded_states = std::get<3>(t);
+    std::unordered_set<State::Kind> excluded_states = std::get<3>(t);
     for (const auto& s : d_states)
     {
       if (s->d_ignore) continue;
@@ -606,6 +634,7 @@ FSM::configure()
       if (w == 0) continue;
       w = sum / w;
     }
+    s->d_sampler.clear();
   }
 }
 
@@ -674,28 +703,24 @@ FSM::untrace(const std::string& trace_file_name)
   uint32_t nline   = 0;
   std::vector<uint64_t> ret_val;
   Action* ret_action;
-  std::string line;
-  std::ifstream trace;
+  uint32_t seed, next_seed;
+  std::string id, next_id;
+  std::vector<std::string> tokens, next_tokens;
   bool sng_untrace_mode = d_smgr.get_sng().is_untrace_mode();
 
   /* Set mode to untracing. We keep the untraced solver seeds when untracing
    * and do not generate new solver seeds. */
   d_smgr.get_sng().set_untrace_mode(true);
 
-  trace.open(trace_file_name);
+  TraceReader trace(trace_file_name);
   MURXLA_CHECK_CONFIG(trace.is_open())
       << "untrace: unable to open file '" << trace_file_name << "'";
 
   try
   {
-    while (std::getline(trace, line))
+    while (trace.next(seed, id, tokens))
     {
-      nline += 1;
-      if (line.empty()) continue;
-      if (line[0] == '#') continue;
-      if (line.rfind("set-murxla-options", 0) == 0) continue;
-
-      const auto& [seed, id, tokens] = tokenize(line);
+      nline = trace.get_line_number();
       d_smgr.get_sng().set_seed(seed);
 
       if (id == "return")
@@ -743,13 +768,11 @@ FSM::untrace(const std::string& trace_file_name)
             throw MurxlaUntraceException(trace_file_name, nline, e.get_msg());
           }
 
-          if (std::getline(trace, line))
+          if (trace.next(next_seed, next_id, next_tokens))
           {
-            nline += 1;
-
-            const auto& [seed, next_id, next_tokens] = tokenize(line);
-            size_t next_tokens_size                  = next_tokens.size();
-            d_smgr.get_sng().set_seed(seed);
+            nline                   = trace.get_line_number();
+            size_t next_tokens_size = next_tokens.size();
+            d_smgr.get_sng().set_seed(next_seed);
 
             if (next_id != "return")
             {
@@ -828,7 +851,6 @@ FSM::untrace(const std::string& trace_file_name)
   {
     throw MurxlaUntraceException(trace_file_name, nline, e.get_msg());
   }
-  if (trace.is_open()) trace.close();
 
   /* reset to previous mode */
   d_smgr.get_sng().set_untrace_mode(sng_untrace_mode);
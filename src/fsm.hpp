@@ -85,7 +85,7 @@ class State
    * We use strings here to make the set of state kinds easily extensible
    * with solver-specific states.
    */
-  using Kind = std::string;
+  using Kind = InternedKind;
 
   /** The undefined state. */
   inline static const Kind UNDEFINED = "undefined";
@@ -284,7 +284,7 @@ class State
 
  private:
   /** State kind. */
-  const Kind& d_kind;
+  const Kind d_kind;
 
   /** The configuration of this state. */
   ConfigKind d_config = REGULAR;
@@ -308,6 +308,12 @@ class State
   std::vector<ActionTuple> d_actions;
   /** The weights of the actions associated with this state. */
   std::vector<uint32_t> d_weights;
+  /**
+   * Sampler over d_weights, used by run() if compatibility mode for weighted
+   * picks is disabled. Built on demand, cleared when d_weights is modified
+   * other than via disable_action() or run().
+   */
+  WeightedSampler d_sampler;
 
   /** The associated statistics object. */
   statistics::Statistics* d_mbt_stats;
@@ -463,7 +469,7 @@ class FSM
    * @param fun   The precondition for transitioning into the state.
    * @return  The created decision state.
    */
-  State* new_decision_state(const std::string& kind,
+  State* new_decision_state(const State::Kind& kind,
                             std::function<bool(void)> fun = nullptr);
 
   /**
@@ -483,7 +489,7 @@ class FSM
    * @param fun   The precondition for transitioning into the state.
    * @return  The created choice state.
    */
-  State* new_choice_state(const std::string& kind,
+  State* new_choice_state(const State::Kind& kind,
                           std::function<bool(void)> fun = nullptr,
                           bool is_final                 = false);
   /**
@@ -499,7 +505,7 @@ class FSM
    * @param fun   The precondition for transitioning into the state.
    * @return  The created choice state.
    */
-  State* new_final_state(const std::string& kind,
+  State* new_final_state(const State::Kind& kind,
                          std::function<bool(void)> fun = nullptr);
 
   /** Create new action of given type T. */
@@ -533,7 +539,7 @@ class FSM
   void add_action_to_all_states(
       T* action,
       uint32_t priority,
-      const std::unordered_set<std::string>& excluded_states = {},
+      const std::unordered_set<State::Kind>& excluded_states = {},
       State* next                                            = nullptr);
 
   /**
@@ -561,7 +567,7 @@ class FSM
       T* action,
       uint32_t priority,
       State* state,
-      const std::unordered_set<std::string>& excluded_states = {});
+      const std::unordered_set<State::Kind>& excluded_states = {});
 
   /** Set given state as initial state. */
   void set_init_state(State* init_state);
@@ -612,7 +618,7 @@ class FSM
    * The state kinds always to exclude when adding actions to all states
    * (add_action_to_all_states) or when adding all aconfigured states to an
    * action/transition (add_action_to_all_states_next). */
-  std::unordered_set<std::string> d_actions_all_states_excluded = {
+  std::unordered_set<State::Kind> d_actions_all_states_excluded = {
       State::NEW, State::DELETE, State::OPT, State::OPT_REQ, State::SET_LOGIC};
 
   /** The initial state. */
@@ -0,0 +1,567 @@
+/***
+ * Murxla: A Model-Based API Fuzzer for SMT solvers.
+ *
+ * This file is part of Murxla.
+ *
+ * Copyright (C) 2019-2022 by the authors listed in the AUTHORS file.
+ *
+ * See LICENSE for more information on using this software.
+ */
+#ifndef __MURXLA__INDEXED_SET_H
+#define __MURXLA__INDEXED_SET_H
+
+#include <cassert>
+#include <cstddef>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace murxla {
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * The iteration order of IndexedSet and IndexedMap.
+ *
+ * By default, indexed containers are iterated in the order of their dense
+ * vector. In compatibility mode (--compat-sampling), they are iterated in the
+ * iteration order of their position map, which is the same as for the
+ * std::unordered_set (std::unordered_map) with the same sequence of inserts
+ * and erases. This keeps code that depends on the iteration order, and thus
+ * traces recorded in compatibility mode, unchanged.
+ */
+struct IndexedOrder
+{
+  /** True if indexed containers are iterated in compatibility order. */
+  inline static bool s_compat = false;
+};
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * A set with constant-time insert, erase, lookup and random access.
+ *
+ * Elements are stored in a dense vector, together with a map from elements to
+ * their position in the vector. Erasing an element moves the last element
+ * into its position. Random access via get() is used for uniform picks (see
+ * RNGenerator::pick_from_set()).
+ *
+ * Iteration is in the order of the dense vector, or in compatibility mode, in
+ * the order of the position map (see IndexedOrder). Unlike for unordered
+ * sets, erasing an element moves another element, and only the iterator
+ * returned by erase() remains valid. It refers to the element following the
+ * erased one in either order, without skipping any elements.
+ */
+template <typename T, typename Hash = std::hash<T>>
+class IndexedSet
+{
+  using PosMap = std::unordered_map<T, size_t, Hash>;
+
+ public:
+  using value_type = T;
+  using key_type   = T;
+
+  /**
+   * Iterator over the dense vector, or in compatibility mode, over the
+   * position map.
+   */
+  class const_iterator
+  {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type        = T;
+    using difference_type   = std::ptrdiff_t;
+    using pointer           = const T*;
+    using reference         = const T&;
+
+    const_iterator() = default;
+    /** Construct iterator over the position map (compatibility order). */
+    const_iterator(typename PosMap::const_iterator it) : d_it(it) {}
+    /** Construct iterator to the given position of the dense vector. */
+    const_iterator(const std::vector<T>* elems, size_t idx)
+        : d_elems(elems), d_idx(idx)
+    {
+    }
+
+    reference operator*() const
+    {
+      return d_elems ? (*d_elems)[d_idx] : d_it->first;
+    }
+    pointer operator->() const { return &**this; }
+
+    const_iterator& operator++()
+    {
+      if (d_elems)
+      {
+        ++d_idx;
+      }
+      else
+      {
+        ++d_it;
+      }
+      return *this;
+    }
+    const_iterator operator++(int)
+    {
+      const_iterator tmp = *this;
+      ++(*this);
+      return tmp;
+    }
+
+    friend bool operator==(const const_iterator& a, const const_iterator& b)
+    {
+      return a.d_elems ? a.d_idx == b.d_idx : a.d_it == b.d_it;
+    }
+    friend bool operator!=(const const_iterator& a, const const_iterator& b)
+    {
+      return !(a == b);
+    }
+
+   private:
+    friend class IndexedSet;
+    /** The position map iterator, if in compatibility order. */
+    typename PosMap::const_iterator d_it;
+    /** The dense vector, nullptr if in compatibility order. */
+    const std::vector<T>* d_elems = nullptr;
+    /** The position in the dense vector. */
+    size_t d_idx = 0;
+  };
+  using iterator = const_iterator;
+
+  IndexedSet() = default;
+  IndexedSet(std::initializer_list<T> elements)
+  {
+    insert(elements.begin(), elements.end());
+  }
+  template <typename It>
+  IndexedSet(It begin, It end)
+  {
+    insert(begin, end);
+  }
+
+  const_iterator begin() const
+  {
+    return IndexedOrder::s_compat ? const_iterator(d_pos.cbegin())
+                                  : const_iterator(&d_elems, 0);
+  }
+  const_iterator end() const
+  {
+    return IndexedOrder::s_compat ? const_iterator(d_pos.cend())
+                                  : const_iterator(&d_elems, d_elems.size());
+  }
+
+  /** @return The number of elements. */
+  size_t size() const { return d_elems.size(); }
+  /** @return True if the set is empty. */
+  bool empty() const { return d_elems.empty(); }
+
+  /**
+   * Get element at given position.
+   * @param idx The position, must be less than size().
+   * @return The element.
+   */
+  const T& get(size_t idx) const
+  {
+    assert(idx < d_elems.size());
+    return d_elems[idx];
+  }
+
+  const_iterator find(const T& t) const { return make_iterator(d_pos.find(t)); }
+  size_t count(const T& t) const { return d_pos.count(t); }
+
+  /**
+   * Insert element.
+   * @return A pair of an iterator to the element and true if it was inserted.
+   */
+  std::pair<const_iterator, bool> insert(const T& t)
+  {
+    auto [it, inserted] = d_pos.emplace(t, d_elems.size());
+    if (inserted)
+    {
+      d_elems.push_back(t);
+    }
+    return {make_iterator(it), inserted};
+  }
+  /** Insert elements of given range. */
+  template <typename It>
+  void insert(It begin, It end)
+  {
+    for (auto it = begin; it != end; ++it)
+    {
+      insert(*it);
+    }
+  }
+
+  /**
+   * Erase element.
+   * @return The number of erased elements (0 or 1).
+   */
+  size_t erase(const T& t)
+  {
+    auto it = d_pos.find(t);
+    if (it == d_pos.end()) return 0;
+    size_t idx = it->second;
+    d_pos.erase(it);
+    move_last_to(idx);
+    return 1;
+  }
+  /**
+   * Erase element at given iterator.
+   * @return An iterator to the element following the erased element.
+   */
+  const_iterator erase(const_iterator pos)
+  {
+    if (pos.d_elems)
+    {
+      /* The last element is moved to the erased position, which is thus the
+       * position of the next element. */
+      d_pos.erase(d_elems[pos.d_idx]);
+      move_last_to(pos.d_idx);
+      return pos;
+    }
+    /* Note: the element of pos is destroyed on erase from d_pos. */
+    size_t idx = pos.d_it->second;
+    auto res   = d_pos.erase(pos.d_it);
+    move_last_to(idx);
+    return const_iterator(res);
+  }
+
+  /** Remove all elements. */
+  void clear()
+  {
+    d_pos.clear();
+    d_elems.clear();
+  }
+
+ private:
+  /** @return An iterator to the element at given position map iterator. */
+  const_iterator make_iterator(typename PosMap::const_iterator it) const
+  {
+    if (IndexedOrder::s_compat) return const_iterator(it);
+    return const_iterator(&d_elems,
+                          it == d_pos.end() ? d_elems.size() : it->second);
+  }
+  /**
+   * Move the last element to the given position, after the element at that
+   * position has been erased from the position map.
+   */
+  void move_last_to(size_t idx)
+  {
+    if (idx + 1 != d_elems.size())
+    {
+      d_elems[idx] = std::move(d_elems.back());
+      d_pos.find(d_elems[idx])->second = idx;
+    }
+    d_elems.pop_back();
+  }
+
+  /** Maps elements to their position in d_elems. */
+  PosMap d_pos;
+  /** The dense vector of elements. */
+  std::vector<T> d_elems;
+};
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * A map with constant-time insert, erase, lookup and random access.
+ *
+ * The IndexedSet analogue of an std::unordered_map: entries are stored in a
+ * dense vector (via pointers, which keeps references to entries stable), with
+ * a map from keys to their position in the vector. Iteration is in the order
+ * of the dense vector, or in compatibility mode, in the order of the position
+ * map (see IndexedOrder). As for IndexedSet, only the iterator returned by
+ * erase() remains valid after erasing an entry.
+ */
+template <typename K, typename V, typename Hash = std::hash<K>>
+class IndexedMap
+{
+  using PosMap = std::unordered_map<K, size_t, Hash>;
+
+ public:
+  using key_type    = K;
+  using mapped_type = V;
+  using value_type  = std::pair<const K, V>;
+
+ private:
+  using Entries = std::vector<std::unique_ptr<value_type>>;
+
+ public:
+  /**
+   * Iterator over the dense vector, or in compatibility mode, over the
+   * position map.
+   */
+  template <bool is_const>
+  class Iterator
+  {
+    using EntriesPtr = std::conditional_t<is_const, const Entries*, Entries*>;
+
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type        = typename IndexedMap::value_type;
+    using difference_type   = std::ptrdiff_t;
+    using pointer =
+        std::conditional_t<is_const, const value_type*, value_type*>;
+    using reference =
+        std::conditional_t<is_const, const value_type&, value_type&>;
+
+    Iterator() = default;
+    /** Construct iterator over the position map (compatibility order). */
+    Iterator(typename PosMap::const_iterator it, EntriesPtr entries)
+        : d_it(it), d_entries(entries), d_compat(true)
+    {
+    }
+    /** Construct iterator to the given position of the dense vector. */
+    Iterator(EntriesPtr entries, size_t idx) : d_entries(entries), d_idx(idx) {}
+    /** Conversion from non-const to const iterator. */
+    operator Iterator<true>() const
+    {
+      return d_compat ? Iterator<true>(d_it, d_entries)
+                      : Iterator<true>(d_entries, d_idx);
+    }
+
+    reference operator*() const { return *(*d_entries)[get_idx()]; }
+    pointer operator->() const { return (*d_entries)[get_idx()].get(); }
+
+    Iterator& operator++()
+    {
+      if (d_compat)
+      {
+        ++d_it;
+      }
+      else
+      {
+        ++d_idx;
+      }
+      return *this;
+    }
+    Iterator operator++(int)
+    {
+      Iterator tmp = *this;
+      ++(*this);
+      return tmp;
+    }
+
+    friend bool operator==(const Iterator& a, const Iterator& b)
+    {
+      return a.d_compat ? a.d_it == b.d_it : a.d_idx == b.d_idx;
+    }
+    friend bool operator!=(const Iterator& a, const Iterator& b)
+    {
+      return !(a == b);
+    }
+
+   private:
+    friend class IndexedMap;
+    /** @return The position of the entry in the dense vector. */
+    size_t get_idx() const { return d_compat ? d_it->second : d_idx; }
+
+    /** The position map iterator, if in compatibility order. */
+    typename PosMap::const_iterator d_it;
+    /** The dense vector of entries. */
+    EntriesPtr d_entries = nullptr;
+    /** True if in compatibility order. */
+    bool d_compat = false;
+    /** The position in the dense vector, if not in compatibility order. */
+    size_t d_idx = 0;
+  };
+  using iterator       = Iterator<false>;
+  using const_iterator = Iterator<true>;
+
+  IndexedMap() = default;
+  IndexedMap(const IndexedMap& other) : d_pos(other.d_pos)
+  {
+    d_entries.reserve(other.d_entries.size());
+    for (const auto& e : other.d_entries)
+    {
+      d_entries.push_back(std::make_unique<value_type>(*e));
+    }
+  }
+  IndexedMap(IndexedMap&& other) = default;
+  IndexedMap& operator=(const IndexedMap& other)
+  {
+    if (this != &other)
+    {
+      IndexedMap tmp(other);
+      *this = std::move(tmp);
+    }
+    return *this;
+  }
+  IndexedMap& operator=(IndexedMap&& other) = default;
+
+  iterator begin() { return make_iterator(d_pos.cbegin(), 0); }
+  iterator end() { return make_iterator(d_pos.cend(), d_entries.size()); }
+  const_iterator begin() const
+  {
+    return const_cast<IndexedMap*>(this)->begin();
+  }
+  const_iterator end() const { return const_cast<IndexedMap*>(this)->end(); }
+
+  /** @return The number of entries. */
+  size_t size() const { return d_entries.size(); }
+  /** @return True if the map is empty. */
+  bool empty() const { return d_entries.empty(); }
+
+  /**
+   * Get entry at given position.
+   * @param idx The position, must be less than size().
+   * @return The entry.
+   */
+  const value_type& get(size_t idx) const
+  {
+    assert(idx < d_entries.size());
+    return *d_entries[idx];
+  }
+
+  iterator find(const K& key) { return make_iterator(d_pos.find(key)); }
+  const_iterator find(const K& key) const
+  {
+    return const_cast<IndexedMap*>(this)->find(key);
+  }
+  size_t count(const K& key) const { return d_pos.count(key); }
+
+  V& at(const K& key) { return d_entries[d_pos.at(key)]->second; }
+  const V& at(const K& key) const { return d_entries[d_pos.at(key)]->second; }
+  V& operator[](const K& key) { return try_emplace(key).first->second; }
+
+  /**
+   * Insert entry with given key and a value constructed from the given
+   * arguments if the key is not in the map yet.
+   * @return A pair of an iterator to the entry with the given key and true if
+   *         it was inserted.
+   */
+  template <typename... Args>
+  std::pair<iterator, bool> try_emplace(const K& key, Args&&... args)
+  {
+    auto [it, inserted] = d_pos.emplace(key, d_entries.size());
+    if (inserted)
+    {
+      d_entries.push_back(std::make_unique<value_type>(
+          std::piecewise_construct,
+          std::forward_as_tuple(key),
+          std::forward_as_tuple(std::forward<Args>(args)...)));
+    }
+    return {make_iterator(it), inserted};
+  }
+  template <typename... Args>
+  std::pair<iterator, bool> emplace(const K& key, Args&&... args)
+  {
+    return try_emplace(key, std::forward<Args>(args)...);
+  }
+  std::pair<iterator, bool> insert(const value_type& entry)
+  {
+    return try_emplace(entry.first, entry.second);
+  }
+  /** Insert entries of given range. */
+  template <typename It>
+  void insert(It begin, It end)
+  {
+    for (auto it = begin; it != end; ++it)
+    {
+      insert(*it);
+    }
+  }
+
+  /**
+   * Erase entry with given key.
+   * @return The number of erased entries (0 or 1).
+   */
+  size_t erase(const K& key)
+  {
+    auto it = d_pos.find(key);
+    if (it == d_pos.end()) return 0;
+    size_t idx = it->second;
+    d_pos.erase(it);
+    move_last_to(idx);
+    return 1;
+  }
+  /**
+   * Erase entry at given iterator.
+   * @return An iterator to the entry following the erased entry.
+   */
+  iterator erase(const_iterator pos)
+  {
+    size_t idx = pos.get_idx();
+    if (pos.d_compat)
+    {
+      auto res = d_pos.erase(pos.d_it);
+      move_last_to(idx);
+      return iterator(res, &d_entries);
+    }
+    d_pos.erase(d_entries[idx]->first);
+    /* The last entry is moved to the erased position, which is thus the
+     * position of the next entry. */
+    move_last_to(idx);
+    return iterator(&d_entries, idx);
+  }
+
+  /** Remove all entries. */
+  void clear()
+  {
+    d_pos.clear();
+    d_entries.clear();
+  }
+
+ private:
+  /**
+   * @return An iterator to the entry at given position map iterator, or at
+   *         the given position of the dense vector if not in compatibility
+   *         order.
+   */
+  iterator make_iterator(typename PosMap::const_iterator it, size_t idx)
+  {
+    if (IndexedOrder::s_compat) return iterator(it, &d_entries);
+    return iterator(&d_entries, idx);
+  }
+  /** @return An iterator to the entry at given position map iterator. */
+  iterator make_iterator(typename PosMap::const_iterator it)
+  {
+    return make_iterator(it, it == d_pos.end() ? d_entries.size() : it->second);
+  }
+  /**
+   * Move the last entry to the given position, after the key of the entry at
+   * that position has been erased from the position map.
+   */
+  void move_last_to(size_t idx)
+  {
+    std::swap(d_entries[idx], d_entries.back());
+    /* Destroys the erased entry. */
+    d_entries.pop_back();
+    if (idx < d_entries.size())
+    {
+      d_pos.find(d_entries[idx]->first)->second = idx;
+    }
+  }
+
+  /** Maps keys to the position of their entry in d_entries. */
+  PosMap d_pos;
+  /** The dense vector of entries. */
+  Entries d_entries;
+};
+
+/* -------------------------------------------------------------------------- */
+
+/** Type trait for containers that support constant-time random access. */
+template <typename T>
+struct is_indexed : std::false_type
+{
+};
+template <typename T, typename Hash>
+struct is_indexed<IndexedSet<T, Hash>> : std::true_type
+{
+};
+template <typename K, typename V, typename Hash>
+struct is_indexed<IndexedMap<K, V, Hash>> : std::true_type
+{
+};
+
+/* -------------------------------------------------------------------------- */
+
+}  // namespace murxla
+
+#endif
@@ -0,0 +1,67 @@
+/***
+ * Murxla: A Model-Based API Fuzzer for SMT solvers.
+ *
+ * This file is part of Murxla.
+ *
+ * Copyright (C) 2019-2022 by the authors listed in the AUTHORS file.
+ *
+ * See LICENSE for more information on using this software.
+ */
+#include "kind_registry.hpp"
+
+#include <cassert>
+#include <functional>
+
+namespace murxla {
+
+/* -------------------------------------------------------------------------- */
+
+KindRegistry&
+KindRegistry::get()
+{
+  /* Function-local, since kinds are interned during static initialization. */
+  static KindRegistry registry;
+  return registry;
+}
+
+KindRegistry::Id
+KindRegistry::intern(std::string_view kind)
+{
+  KindRegistry& reg = get();
+  auto it           = reg.d_ids.find(kind);
+  if (it != reg.d_ids.end())
+  {
+    return it->second;
+  }
+  Id id                  = static_cast<Id>(reg.d_strs.size());
+  const std::string& str = reg.d_strs.emplace_back(kind);
+  /* Same hash value as for std::string, which keeps the iteration order of
+   * unordered containers of kinds as with kinds represented as strings. */
+  reg.d_hashes.push_back(std::hash<std::string>{}(str));
+  reg.d_ids.emplace(str, id);
+  return id;
+}
+
+const std::string&
+KindRegistry::get_str(Id id)
+{
+  assert(id < get().d_strs.size());
+  return get().d_strs[id];
+}
+
+size_t
+KindRegistry::get_hash(Id id)
+{
+  assert(id < get().d_hashes.size());
+  return get().d_hashes[id];
+}
+
+size_t
+KindRegistry::size()
+{
+  return get().d_strs.size();
+}
+
+/* -------------------------------------------------------------------------- */
+
+}  // namespace murxla
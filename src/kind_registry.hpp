@@ -0,0 +1,192 @@
+/***
+ * Murxla: A Model-Based API Fuzzer for SMT solvers.
+ *
+ * This file is part of Murxla.
+ *
+ * Copyright (C) 2019-2022 by the authors listed in the AUTHORS file.
+ *
+ * See LICENSE for more information on using this software.
+ */
+#ifndef __MURXLA__KIND_REGISTRY_H
+#define __MURXLA__KIND_REGISTRY_H
+
+#include <cstdint>
+#include <deque>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace murxla {
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * The global registry of interned kind strings (operator, action and state
+ * kinds).
+ *
+ * Each distinct kind string is assigned a dense integer id on first use, in
+ * the order kinds are interned. Interned strings are never released. The
+ * registry is not thread-safe.
+ */
+class KindRegistry
+{
+ public:
+  /** The type of kind ids. */
+  using Id = uint32_t;
+
+  /**
+   * Intern kind string.
+   * @param kind The kind string.
+   * @return The id of the kind.
+   */
+  static Id intern(std::string_view kind);
+  /**
+   * Get the string of an interned kind.
+   * @param id The id of the kind.
+   * @return The kind string.
+   */
+  static const std::string& get_str(Id id);
+  /**
+   * Get the hash value of an interned kind. This is the hash value of its
+   * string, computed once on interning.
+   * @param id The id of the kind.
+   * @return The hash value.
+   */
+  static size_t get_hash(Id id);
+  /** @return The number of interned kinds, i.e., an upper bound of ids. */
+  static size_t size();
+
+ private:
+  static KindRegistry& get();
+
+  /** Map kind strings to ids. Keys point into d_strs. */
+  std::unordered_map<std::string_view, Id> d_ids;
+  /** Map ids to kind strings (deque for reference stability). */
+  std::deque<std::string> d_strs;
+  /** Map ids to hash values. */
+  std::vector<size_t> d_hashes;
+};
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * An interned kind string.
+ *
+ * Kinds are implicitly constructed from and converted to strings, which keeps
+ * sets of kinds (e.g., solver-specific operator kinds) extensible via plain
+ * strings. Internally, a kind is an id of the KindRegistry, i.e., copying and
+ * comparing kinds for equality are integer operations, hashing is a table
+ * lookup, and per-kind data can be stored in flat arrays indexed by
+ * get_id().
+ */
+class InternedKind
+{
+ public:
+  /** Default constructor, creates the empty kind. */
+  InternedKind() : InternedKind(std::string_view()) {}
+  /** Constructor. */
+  InternedKind(const std::string& kind) : d_id(KindRegistry::intern(kind)) {}
+  /** Constructor. */
+  InternedKind(const char* kind) : d_id(KindRegistry::intern(kind)) {}
+  /** Constructor. */
+  explicit InternedKind(std::string_view kind)
+      : d_id(KindRegistry::intern(kind))
+  {
+  }
+
+  /** @return The id of this kind. */
+  KindRegistry::Id get_id() const { return d_id; }
+  /** @return The string representation of this kind. */
+  const std::string& str() const { return KindRegistry::get_str(d_id); }
+  operator const std::string&() const { return str(); }
+
+  const char* c_str() const { return str().c_str(); }
+  size_t size() const { return str().size(); }
+  bool empty() const { return str().empty(); }
+
+  bool operator==(const InternedKind& other) const
+  {
+    return d_id == other.d_id;
+  }
+  bool operator!=(const InternedKind& other) const
+  {
+    return d_id != other.d_id;
+  }
+  bool operator==(const std::string& other) const { return str() == other; }
+  bool operator!=(const std::string& other) const { return str() != other; }
+  bool operator==(const char* other) const { return str() == other; }
+  bool operator!=(const char* other) const { return str() != other; }
+  /** Kinds are ordered by their string representation. */
+  bool operator<(const InternedKind& other) const
+  {
+    return d_id != other.d_id && str() < other.str();
+  }
+
+ private:
+  /** The id of this kind. */
+  KindRegistry::Id d_id;
+};
+
+inline bool
+operator==(const std::string& a, const InternedKind& b)
+{
+  return b == a;
+}
+
+inline bool
+operator!=(const std::string& a, const InternedKind& b)
+{
+  return b != a;
+}
+
+inline std::string
+operator+(const std::string& a, const InternedKind& b)
+{
+  return a + b.str();
+}
+
+inline std::string
+operator+(const InternedKind& a, const std::string& b)
+{
+  return a.str() + b;
+}
+
+inline std::string
+operator+(const char* a, const InternedKind& b)
+{
+  return a + b.str();
+}
+
+inline std::string
+operator+(const InternedKind& a, const char* b)
+{
+  return a.str() + b;
+}
+
+inline std::ostream&
+operator<<(std::ostream& out, const InternedKind& kind)
+{
+  return out << kind.str();
+}
+
+/* -------------------------------------------------------------------------- */
+
+}  // namespace murxla
+
+namespace std {
+
+/** Specialization of `std::hash` for InternedKind. */
+template <>
+struct hash<murxla::InternedKind>
+{
+  size_t operator()(const murxla::InternedKind& kind) const
+  {
+    return murxla::KindRegistry::get_hash(kind.get_id());
+  }
+};
+
+}  // namespace std
+
+#endif
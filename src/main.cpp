@@ -16,6 +16,7 @@
 #include <sys/wait.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <cstdlib>
 #include <ctime>
 #include <filesystem>
@@ -25,6 +26,7 @@
 #include <regex>
 #include <sstream>
 
+#include "binary_trace.hpp"
 #include "dd.hpp"
 #include "except.hpp"
 #include "exit.hpp"
@@ -49,7 +51,7 @@ static bool g_errors_print_csv = false;
 /* -------------------------------------------------------------------------- */
 
 static Statistics*
-initialize_statistics()
+initialize_statistics(uint32_t num_shards)
 {
   int fd;
   std::stringstream ss;
@@ -63,13 +65,17 @@ initialize_statistics()
                     < 0)
       << "failed to create shared memory file for statistics";
 
-  stats = static_cast<Statistics*>(mmap(0,
-                                        sizeof(Statistics),
-                                        PROT_READ | PROT_WRITE,
-                                        MAP_ANONYMOUS | MAP_SHARED,
-                                        fd,
-                                        0));
-  memset(stats, 0, sizeof(Statistics));
+  /* Each worker records statistics in its own shard. */
+  void* mem = mmap(0,
+                   Statistics::get_size(num_shards),
+                   PROT_READ | PROT_WRITE,
+                   MAP_ANONYMOUS | MAP_SHARED,
+                   fd,
+                   0);
+  MURXLA_EXIT_ERROR(mem == MAP_FAILED)
+      << "failed to map shared memory for statistics";
+  stats = Statistics::init(mem, num_shards);
+  stats->init_timer();
 
   MURXLA_EXIT_ERROR(close(fd))
       << "failed to close shared memory file for statistics";
@@ -208,6 +214,8 @@ set_sigint_handler_stats(void)
   "  -O, --out-dir <dir>        write output files to given directory\n"       \
   "  -l, --smt-lib              generate SMT-LIB compliant traces only\n"      \
   "  -y, --random-symbols       use random symbol names\n"                     \
+  "  --compat-sampling          use random sampling of earlier versions\n"     \
+  "                             to reproduce their seeded runs\n"              \
   "  --stats                    print statistics\n"                            \
   "  --print-fsm                print FSM configuration, may be combined\n"    \
   "                             with solver option to show config for \n"      \
@@ -215,6 +223,8 @@ set_sigint_handler_stats(void)
   " Continuous mode options:\n"                                                \
   "  -t, --time <double>        time limit per test run\n"                     \
   "  -m, --max-runs <int>       limit number of test runs\n"                   \
+  "  -j, --jobs <int>           number of test runs to execute in parallel\n"  \
+  "                             (also applies to delta debugging)\n"           \
   "  --csv                      print error summary in csv format\n"           \
   "  -e, --export-errors <out>  export found errors to JSON file <out>\n"      \
   "\n"                                                                         \
@@ -223,6 +233,16 @@ set_sigint_handler_stats(void)
   "  -a, --api-trace <file>     trace API call sequence into <file>\n"         \
   "  -f, --smt2-file <file>     write --smt2 output to <file>\n"               \
   "  -u, --untrace <file>       replay given API call sequence\n"              \
+  "  --binary-trace             write API trace files in binary format\n"      \
+  "  --buffer-trace             buffer API trace and SMT2 file output in\n"    \
+  "                             memory instead of flushing per statement;\n"   \
+  "                             output that is not written yet is lost if\n"   \
+  "                             the solver process is killed without\n"        \
+  "                             handling SIGTERM, e.g., if it does not\n"      \
+  "                             terminate within 100ms after a time out\n"     \
+  "  --convert-trace <file>     convert the trace given via --untrace from\n"  \
+  "                             text to binary format or vice versa into\n"    \
+  "                             <file>\n"                                      \
   "  --solver-trace             print native solver API trace to stdout\n"     \
   "\n"                                                                         \
   " Trace minimizer:\n"                                                        \
@@ -233,6 +253,8 @@ set_sigint_handler_stats(void)
   "                             output when delta debugging\n"                 \
   "  --dd-ignore-err            ignore stderr output when delta debugging\n"   \
   "  --dd-ignore-out            ignore stdout output when delta debugging\n"   \
+  "  --dd-share-prefix          replay shared trace prefixes only once when\n" \
+  "                             delta debugging (fork from snapshots)\n"       \
   "  -D, --dd-trace <file>      delta debug API trace into <file>\n"           \
   "\n"                                                                         \
   " Solvers:\n"                                                                \
@@ -243,6 +265,11 @@ set_sigint_handler_stats(void)
   "  --smt2 [<binary>]          print SMT-LIB 2 (optionally to solver "        \
   "binary\n"                                                                   \
   "                             via stdout)\n"                                 \
+  "  --smt2-pipelined           do not wait for 'success' responses of the\n"  \
+  "                             --smt2 binary before sending the next\n"       \
+  "                             command\n"                                     \
+  "  --smt2-persistent          reuse the --smt2 binary process across test\n" \
+  "                             runs (one per job), reset before each run\n"   \
   "  -o name=value,...          solver options enabled by default\n"           \
   "  --fuzz-opts [wildcard,...] restrict options to be fuzzed with multiple\n" \
   "                             wildcards, which are matched against option\n" \
@@ -251,6 +278,8 @@ set_sigint_handler_stats(void)
   "  -c, --cross-check <solver> cross check with <solver> (SMT-LIB only)\n"    \
   "  --cross-check-opts name=value,...\n"                                      \
   "                             options for cross check solver\n"              \
+  "  --cross-check-concurrent   run check-sat calls of solver and cross\n"     \
+  "                             check solver concurrently\n"                   \
   "  -C, --check [<solver>]     check unsat cores/assumptions and \n"          \
   "                             model values with <solver>\n"                  \
   "\n"                                                                         \
@@ -343,16 +372,21 @@ get_options(Options& options,
   if (!options.untrace_file_name.empty())
   {
     std::vector<std::string> opts;
-    std::ifstream trace(options.untrace_file_name);
-    if (trace.good())
+    std::string line;
+    bool eol;
+    try
     {
-      std::string line;
-      std::getline(trace, line);
-      if (line.rfind("set-murxla-options", 0) == 0)
-      {
-        opts = split(line, ' ');
-        args.insert(args.begin(), opts.begin() + 1, opts.end());
-      }
+      TraceReader trace(options.untrace_file_name);
+      if (!trace.is_open() || !trace.next_line(line, eol)) return;
+    }
+    catch (MurxlaException& e)
+    {
+      MURXLA_EXIT_ERROR(true) << e.get_msg();
+    }
+    if (line.rfind("set-murxla-options", 0) == 0)
+    {
+      opts = split(line, ' ');
+      args.insert(args.begin(), opts.begin() + 1, opts.end());
     }
   }
 }
@@ -440,6 +474,10 @@ parse_options(Options& options, int argc, char* argv[])
     {
       options.dd_ignore_err = true;
     }
+    else if (arg == "--dd-share-prefix")
+    {
+      options.dd_share_prefix = true;
+    }
     else if (arg == "-D" || arg == "--dd-trace")
     {
       i += 1;
@@ -452,6 +490,20 @@ parse_options(Options& options, int argc, char* argv[])
       check_next_arg(arg, i, size);
       options.untrace_file_name = args[i];
     }
+    else if (arg == "--binary-trace")
+    {
+      options.binary_trace = true;
+    }
+    else if (arg == "--buffer-trace")
+    {
+      options.buffer_trace = true;
+    }
+    else if (arg == "--convert-trace")
+    {
+      i += 1;
+      check_next_arg(arg, i, size);
+      options.convert_trace_file_name = args[i];
+    }
     else if (arg == "-c" || arg == "--cross-check")
     {
       record_args.push_back(arg);
@@ -464,6 +516,11 @@ parse_options(Options& options, int argc, char* argv[])
       check_solver(solver);
       options.cross_check = solver;
     }
+    else if (arg == "--cross-check-concurrent")
+    {
+      record_args.push_back(arg);
+      options.cross_check_concurrent = true;
+    }
     else if (arg == "-C" || arg == "--check")
     {
       record_args.push_back(arg);
@@ -535,6 +592,16 @@ parse_options(Options& options, int argc, char* argv[])
       }
       options.solver = SOLVER_SMT2;
     }
+    else if (arg == "--smt2-pipelined")
+    {
+      record_args.push_back(arg);
+      options.smt2_pipelined = true;
+    }
+    else if (arg == "--smt2-persistent")
+    {
+      record_args.push_back(arg);
+      options.smt2_persistent = true;
+    }
     else if (arg == "-f" || arg == "--smt2-file")
     {
       i += 1;
@@ -561,6 +628,10 @@ parse_options(Options& options, int argc, char* argv[])
                                             split_opt[1]);
       }
     }
+    else if (arg == "--compat-sampling")
+    {
+      options.compat_sampling = true;
+    }
     else if (arg == "--stats")
     {
       options.print_stats = true;
@@ -589,6 +660,15 @@ parse_options(Options& options, int argc, char* argv[])
       check_next_arg(arg, i, size);
       options.max_runs = std::stoi(args[i]);
     }
+    else if (arg == "-j" || arg == "--jobs")
+    {
+      i += 1;
+      check_next_arg(arg, i, size);
+      int32_t num_jobs = std::stoi(args[i]);
+      MURXLA_EXIT_ERROR(num_jobs < 1)
+          << "invalid number of jobs '" << args[i] << "'";
+      options.num_jobs = num_jobs;
+    }
     else if (arg == "-l" || arg == "--smt-lib")
     {
       options.smtlib_compliant = true;
@@ -753,16 +833,38 @@ parse_options(Options& options, int argc, char* argv[])
 int
 main(int argc, char* argv[])
 {
-  statistics::Statistics* stats = initialize_statistics();
   SolverOptions solver_options;
   Options options;
 
   parse_options(options, argc, argv);
 
+  statistics::Statistics* stats =
+      initialize_statistics(std::max<uint32_t>(options.num_jobs, 1));
+
   bool is_untrace    = !options.untrace_file_name.empty();
   bool is_continuous = !options.is_seeded && !is_untrace;
   bool is_forked     = options.dd || is_continuous;
 
+  if (!options.convert_trace_file_name.empty())
+  {
+    MURXLA_EXIT_ERROR(!is_untrace)
+        << "option --convert-trace requires a trace given via --untrace";
+    MURXLA_EXIT_ERROR(options.convert_trace_file_name
+                      == options.untrace_file_name)
+        << "converting a trace into the file that is converted is not "
+           "supported";
+    try
+    {
+      BinaryTrace::convert(options.untrace_file_name,
+                           options.convert_trace_file_name);
+    }
+    catch (MurxlaException& e)
+    {
+      MURXLA_EXIT_ERROR(true) << e.get_msg();
+    }
+    exit(0);
+  }
+
   create_tmp_directory(options.tmp_dir);
 
   std::string api_trace_file_name = options.api_trace_file_name;
@@ -771,6 +873,9 @@ main(int argc, char* argv[])
                     && api_trace_file_name == options.untrace_file_name)
       << "tracing into the file that is untraced is not supported";
 
+  MURXLA_EXIT_ERROR(options.binary_trace && options.dd)
+      << "binary API traces are not supported when delta debugging";
+
   try
   {
     Murxla murxla(stats, options, &solver_options, &g_errors, TMP_DIR);
@@ -856,7 +961,7 @@ main(int argc, char* argv[])
     stats->print();
   }
 
-  MURXLA_EXIT_ERROR(munmap(stats, sizeof(Statistics)))
+  MURXLA_EXIT_ERROR(munmap(stats, Statistics::get_size(stats->d_num_shards)))
       << "failed to unmap shared memory for statistics";
 
   if (std::filesystem::exists(TMP_DIR))
@@ -13,17 +13,26 @@
 #include <signal.h>
 #include <sys/stat.h>
 #include <sys/wait.h>
+#include <time.h>
 #include <unistd.h>
 
+#include <cerrno>
+#include <climits>
+#include <cstring>
 #include <filesystem>
 #include <fstream>
 #include <iomanip>
+#include <list>
+#include <memory>
 #include <nlohmann/json.hpp>
 #include <regex>
 
+#include "binary_trace.hpp"
+#include "config.hpp"
 #include "dd.hpp"
 #include "except.hpp"
 #include "fsm.hpp"
+#include "indexed_set.hpp"
 #include "solver/btor/btor_solver.hpp"
 #include "solver/bzla/bzla_solver.hpp"
 #include "solver/cvc5/cvc5_solver.hpp"
@@ -33,8 +42,28 @@
 #include "solver/solver_profile.hpp"
 #include "solver/yices/yices_solver.hpp"
 #include "statistics.hpp"
+#include "trace_buffer.hpp"
 #include "util.hpp"
 
+#ifdef __linux__
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/prctl.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/timerfd.h>
+#include <sys/mman.h>
+#ifdef SYS_pidfd_open
+#define MURXLA_USE_PIDFD
+#endif
+#ifdef MFD_ALLOW_SEALING
+#define MURXLA_USE_MEMFD
+#endif
+#ifdef PR_SET_CHILD_SUBREAPER
+#define MURXLA_USE_SNAPSHOTS
+#endif
+#endif
+
 namespace murxla {
 
 /* -------------------------------------------------------------------------- */
@@ -69,73 +98,227 @@ namespace {
 std::string
 normalize_asan_error(const std::string& s)
 {
-  std::vector<std::string> regex = {"0x[0-9a-fA-F]+", "==[0-9]+=="};
+  static const std::regex re_addr("0x[0-9a-fA-F]+", std::regex::optimize);
+  static const std::regex re_pid("==[0-9]+==", std::regex::optimize);
+  return std::regex_replace(std::regex_replace(s, re_addr, ""), re_pid, "");
+}
+
+/**
+ * Get the current time of the monotonic clock in seconds.
+ * Used for the deadlines of test runs.
+ */
+double
+get_monotonic_time()
+{
+  struct timespec ts;
+  MURXLA_EXIT_ERROR(clock_gettime(CLOCK_MONOTONIC, &ts)) << "failed to get time";
+  return (double) ts.tv_sec + (double) ts.tv_nsec / 1000000000;
+}
 
-  std::string res, cur_s(s);
-  for (const auto& re : regex)
+/**
+ * Open a file descriptor to capture the output of a forked test run.
+ *
+ * On Linux, this is an in-memory file (see memfd_create()), limited to
+ * MURXLA_MAX_CAPTURED_OUTPUT bytes. Else, the output is captured in the given
+ * temp file.
+ */
+int32_t
+open_capture_fd(const std::string& name, const std::string& tmp_file_name)
+{
+  int32_t fd;
+#ifdef MURXLA_USE_MEMFD
+  fd = memfd_create(name.c_str(), MFD_CLOEXEC | MFD_ALLOW_SEALING);
+  if (fd >= 0)
   {
-    res.clear();
-    std::regex_replace(std::back_inserter(res),
-                       cur_s.begin(),
-                       cur_s.end(),
-                       std::regex(re),
-                       "");
-    cur_s = res;
+    /* Writes beyond the size limit fail. The child process shares the file
+     * offset with the parent, which determines the size of the output. */
+    MURXLA_CHECK(ftruncate(fd, MURXLA_MAX_CAPTURED_OUTPUT) == 0
+                 && fcntl(fd, F_ADD_SEALS, F_SEAL_GROW) == 0)
+        << "unable to limit size of output buffer";
+    return fd;
   }
+#else
+  (void) name;
+#endif
+  fd = open(tmp_file_name.c_str(),
+            O_CREAT | O_RDWR | O_TRUNC | O_CLOEXEC,
+            S_IRUSR | S_IWUSR);
+  MURXLA_CHECK(fd >= 0) << "unable to open file " << tmp_file_name;
+  return fd;
+}
 
+/**
+ * Get the output captured so far by given file descriptor (see
+ * open_capture_fd()).
+ */
+std::string
+get_captured_output(int32_t fd)
+{
+  std::string res;
+  off_t size = lseek(fd, 0, SEEK_CUR);
+  if (size > 0)
+  {
+    res.resize(static_cast<size_t>(size));
+    size_t nread = 0;
+    while (nread < res.size())
+    {
+      ssize_t n = pread(fd, &res[nread], res.size() - nread, nread);
+      if (n <= 0) break;
+      nread += static_cast<size_t>(n);
+    }
+    res.resize(nread);
+  }
   return res;
 }
 
 /**
- * Split string into tokens.
+ * Read the output captured by given file descriptor (see open_capture_fd())
+ * and close it.
  */
-std::vector<std::string>
-str_tokenize(const std::string& s)
+std::string
+read_capture_fd(int32_t fd)
 {
-  std::istringstream buf(s);
-  std::vector<std::string> ret{std::istream_iterator<std::string>(buf),
-                               std::istream_iterator<std::string>()};
-  return ret;
+  std::string res;
+  if (fd < 0) return res;
+  res = get_captured_output(fd);
+  close(fd);
+  return res;
 }
 
+#ifdef MURXLA_USE_SNAPSHOTS
 /**
- * Count the number of non-digit characters two strings differ in.
+ * Copy the output captured so far by file descriptor 'from' to file
+ * descriptor 'to'. Used to pass on the output of a snapshot process to the
+ * processes forked from it.
  */
-size_t
-str_diff(const std::string& s1, const std::string& s2)
+void
+copy_captured_output(int32_t from, int32_t to)
 {
-  size_t diff;
-  auto t1 = str_tokenize(s1);
-  auto t2 = str_tokenize(s2);
+  std::string out = get_captured_output(from);
+  size_t nwritten = 0;
+  while (nwritten < out.size())
+  {
+    ssize_t n = write(to, &out[nwritten], out.size() - nwritten);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) break;
+    nwritten += static_cast<size_t>(n);
+  }
+}
+
+/** The kinds of requests to a snapshot process (see Murxla::Snapshot). */
+enum SnapshotRequest : char
+{
+  /** Fork a snapshot that replays a trace on top of the snapshot. */
+  FORK_SNAPSHOT = 's',
+  /** Fork a test run that replays a trace on top of the snapshot. */
+  FORK_TEST_RUN = 't',
+};
+
+/**
+ * Send a message and the given file descriptors (at most two) via given
+ * socket. Messages must not be empty. Returns false on failure.
+ */
+bool
+send_message(int32_t fd,
+             const std::string& msg,
+             const std::vector<int32_t>& fds = {})
+{
+  assert(!msg.empty());
+  assert(fds.size() <= 2);
 
-  if (t1.size() > t2.size())
+  struct msghdr hdr = {};
+  struct iovec iov;
+  union
   {
-    std::swap(t1, t2);
+    char buf[CMSG_SPACE(2 * sizeof(int32_t))];
+    struct cmsghdr align;
+  } control;
+
+  iov.iov_base   = const_cast<char*>(msg.data());
+  iov.iov_len    = msg.size();
+  hdr.msg_iov    = &iov;
+  hdr.msg_iovlen = 1;
+  if (!fds.empty())
+  {
+    size_t size        = fds.size() * sizeof(int32_t);
+    hdr.msg_control    = control.buf;
+    hdr.msg_controllen = CMSG_SPACE(size);
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&hdr);
+    cmsg->cmsg_level     = SOL_SOCKET;
+    cmsg->cmsg_type      = SCM_RIGHTS;
+    cmsg->cmsg_len       = CMSG_LEN(size);
+    std::memcpy(CMSG_DATA(cmsg), fds.data(), size);
   }
 
-  diff = t2.size() - t1.size();
-  for (size_t i = 0; i < t1.size(); ++i)
+  ssize_t n;
+  do
+  {
+    n = sendmsg(fd, &hdr, MSG_NOSIGNAL);
+  } while (n < 0 && errno == EINTR);
+  return n == static_cast<ssize_t>(msg.size());
+}
+
+/**
+ * Receive a message and the file descriptors sent with it via given socket
+ * (see send_message()). Returns false if the socket was closed on the other
+ * end, or on failure.
+ */
+bool
+recv_message(int32_t fd, std::string& msg, std::vector<int32_t>& fds)
+{
+  struct msghdr hdr = {};
+  struct iovec iov;
+  union
   {
-    if (t1[i] != t2[i])
+    char buf[CMSG_SPACE(2 * sizeof(int32_t))];
+    struct cmsghdr align;
+  } control;
+  char buf[PATH_MAX + 1];
+
+  iov.iov_base       = buf;
+  iov.iov_len        = sizeof(buf);
+  hdr.msg_iov        = &iov;
+  hdr.msg_iovlen     = 1;
+  hdr.msg_control    = control.buf;
+  hdr.msg_controllen = sizeof(control.buf);
+
+  ssize_t n;
+  do
+  {
+    n = recvmsg(fd, &hdr, 0);
+  } while (n < 0 && errno == EINTR);
+  if (n <= 0) return false;
+
+  msg.assign(buf, static_cast<size_t>(n));
+  fds.clear();
+  for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&hdr); cmsg;
+       cmsg                 = CMSG_NXTHDR(&hdr, cmsg))
+  {
+    if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS)
     {
-      /* Ignore numbers for diff. */
-      for (size_t j = 0; j < t1[i].size(); ++j)
-      {
-        if (std::isdigit(t1[i][j])) continue;
-        ++diff;
-      }
+      size_t nfds = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int32_t);
+      fds.resize(nfds);
+      std::memcpy(fds.data(), CMSG_DATA(cmsg), nfds * sizeof(int32_t));
     }
   }
-  return diff;
+  return true;
 }
 
-double
-error_diff(const std::string& e1, const std::string& e2)
+/**
+ * Redirect given output file descriptor of the current process into a new
+ * capture buffer, initialized with the output captured so far.
+ */
+void
+redirect_captured_output(int32_t fd,
+                         const std::string& name,
+                         const std::string& tmp_file_name)
 {
-  size_t len  = std::max(e1.size(), e2.size());
-  size_t diff = str_diff(e1, e2);
-  return static_cast<double>(diff) / static_cast<double>(len);
+  int32_t fd_capture = open_capture_fd(name, tmp_file_name);
+  copy_captured_output(fd, fd_capture);
+  MURXLA_CHECK(dup2(fd_capture, fd) >= 0) << "unable to redirect output";
+  close(fd_capture);
 }
+#endif
 
 }  // namespace
 
@@ -154,8 +337,16 @@ Murxla::Murxla(statistics::Statistics* stats,
 {
   assert(stats);
   assert(solver_options);
+  /* Indexed containers are iterated in the order of the unordered containers
+   * they replace in compatibility mode, which picks depend on. */
+  IndexedOrder::s_compat = options.compat_sampling;
   load_solver_profile();
 
+  for (const auto& p : *d_errors)
+  {
+    d_error_index.add(p.first);
+  }
+
   if (!d_options.export_errors_filename.empty())
   {
     d_export_errors.insert(d_export_errors.end(),
@@ -164,6 +355,15 @@ Murxla::Murxla(statistics::Statistics* stats,
   }
 }
 
+Murxla::~Murxla()
+{
+  close_event_fds();
+  for (smt2::Smt2Process& process : d_smt2_processes)
+  {
+    process.stop();
+  }
+}
+
 Result
 Murxla::run(uint64_t seed,
             double time,
@@ -175,90 +375,25 @@ Murxla::run(uint64_t seed,
             bool record_stats,
             Murxla::TraceMode trace_mode)
 {
-  std::string tmp_file_out = get_tmp_file_path("run-tmp1.out", d_tmp_dir);
-  std::string tmp_file_err = get_tmp_file_path("run-tmp1.err", d_tmp_dir);
-
-  /* If we don't run forked, and an explicit api trace file name is given, the
-   * trace is immediately written to the given file (rather than writing it
-   * first to a temp file).  This is because else, we don't get a chance to
-   * write the contents from the temp file back to the given file when the
-   * process aborts (if the trace triggers an issue).
-   *
-   * When forking, run_aux stores the name of the temp file in
-   * 'tmp_api_trace_file_name', and its contents are then copied into the
-   * given file 'api_trace_file_name'. */
-  std::string tmp_api_trace_file_name;
-  if (!run_forked)
-  {
-    tmp_api_trace_file_name = api_trace_file_name;
-  }
-
-  Result res = run_aux(seed,
-                       time,
-                       tmp_file_out,
-                       tmp_file_err,
-                       tmp_api_trace_file_name,
-                       untrace_file_name,
-                       run_forked,
-                       record_stats,
-                       trace_mode,
-                       d_error_msg);
-
-  if (trace_mode == TO_FILE)
-  {
-    std::string copy_from, copy_to;
-
-    /* For the SMT2 solver, we only write the SMT2 file (not the trace). */
-    if (!d_options.dd && d_options.solver == SOLVER_SMT2)
-    {
-      copy_from = get_tmp_file_path(SMT2_FILE, d_tmp_dir);
-      copy_to   = get_smt2_file_name(seed, untrace_file_name);
-    }
-    /* For all other solvers, we write the trace file. */
-    else if (api_trace_file_name != DEVNULL)
-    {
-      copy_from = tmp_api_trace_file_name;
-      copy_to   = api_trace_file_name;
-    }
-
-    if (copy_from != copy_to)
-    {
-      assert(std::filesystem::exists(copy_from));
-
-      // Create parent directories if they do not exist yet.
-      std::filesystem::path fp(copy_to);
-      if (fp.has_parent_path() && !std::filesystem::exists(fp.parent_path()))
-      {
-        std::filesystem::create_directories(fp.parent_path());
-      }
-      std::filesystem::copy(copy_from,
-                            copy_to,
-                            std::filesystem::copy_options::overwrite_existing);
-    }
-  }
-  // Print terminating "}" for main() function of native API traces.
-  else if (trace_mode == TO_STDOUT && d_options.solver_trace)
+  TestRun run = new_test_run(seed,
+                             time,
+                             d_tmp_dir,
+                             file_out,
+                             file_err,
+                             api_trace_file_name,
+                             untrace_file_name,
+                             run_forked,
+                             trace_mode);
+  start_test_run(run, record_stats);
+
+  /* Note: This may also collect other in-flight test runs that terminate
+   *       before this run, their result is recorded in their TestRun object. */
+  while (!run.d_done)
   {
-    std::cout << "}" << std::endl;
+    wait_test_run();
   }
 
-  if (run_forked)
-  {
-    std::ofstream err = open_output_file(file_err, true);
-    std::ofstream out = open_output_file(file_out, true);
-
-    std::ifstream tmp_out = open_input_file(tmp_file_out, true);
-    out << tmp_out.rdbuf();
-    tmp_out.close();
-
-    std::ifstream tmp_err = open_input_file(tmp_file_err, true);
-    err << tmp_err.rdbuf();
-    tmp_err.close();
-
-    out.close();
-    err.close();
-  }
-  return res;
+  return finish_test_run(run);
 }
 
 void
@@ -267,6 +402,7 @@ Murxla::test()
   uint64_t num_timeouts = 0, num_printed_lines = 0;
   uint64_t error_id = 0, error_nduplicates = 0;
   uint32_t num_runs         = 0;
+  uint32_t num_started_runs = 0;
   double start_time         = get_cur_wall_time();
   std::string out_file_name = DEVNULL;
   SeedGenerator sg;
@@ -275,14 +411,38 @@ Murxla::test()
     sg.set_seed(d_options.seed);
   }
 
-  std::string err_file_name = get_tmp_file_path("tmp.err", d_tmp_dir);
   Terminal term;
 
-  do
+  /* In sequential mode, the status line of a test run is printed when the run
+   * is started. In parallel mode, it is printed when the run is finished. */
+  uint32_t num_jobs = std::max<uint32_t>(d_options.num_jobs, 1);
+  bool is_parallel  = num_jobs > 1;
+
+  /* The workers that are currently not executing a test run. */
+  std::vector<uint32_t> idle_workers;
+  for (uint32_t i = 0; i < num_jobs; ++i)
   {
-    double cur_time = get_cur_wall_time();
+    idle_workers.push_back(num_jobs - i - 1);
+  }
+  /* The in-flight test runs (and their worker), in the order of creation. */
+  std::list<std::pair<uint32_t, TestRun>> test_runs;
+
+  bool smt2_offline =
+      (d_options.solver == SOLVER_SMT2 && d_options.solver_binary.empty());
+
+  /* The persistent online solver processes are started on demand, and
+   * restarted after they terminated or a test run using them did not
+   * terminate regularly (which may leave the solver in an unknown state). */
+  bool smt2_persistent = d_options.smt2_persistent
+                         && d_options.solver == SOLVER_SMT2
+                         && !d_options.solver_binary.empty();
+  if (smt2_persistent)
+  {
+    d_smt2_processes.resize(num_jobs);
+  }
 
-    uint64_t seed = sg.next();
+  auto print_status = [&](uint64_t seed) {
+    double cur_time = get_cur_wall_time();
 
     if (num_printed_lines % 100 == 0)
     {
@@ -303,174 +463,256 @@ Murxla::test()
     std::cout << " " << std::setw(5) << num_runs;
     std::cout << " " << std::setw(8) << std::setprecision(2) << std::fixed;
     std::cout << num_runs / (cur_time - start_time);
-    std::cout << " " << std::setw(5) << d_stats->d_results[Solver::Result::SAT];
     std::cout << " " << std::setw(5)
-              << d_stats->d_results[Solver::Result::UNSAT];
+              << d_stats->get_num_results(Solver::Result::SAT);
+    std::cout << " " << std::setw(5)
+              << d_stats->get_num_results(Solver::Result::UNSAT);
     std::cout << " " << std::setw(5)
-              << d_stats->d_results[Solver::Result::UNKNOWN];
+              << d_stats->get_num_results(Solver::Result::UNKNOWN);
     std::cout << " " << std::setw(5) << num_timeouts;
     std::cout << " " << std::setw(5) << d_errors->size();
     std::cout << std::flush;
     num_runs++;
+  };
 
-    /* Note: If the selected solver is SOLVER_SMT2 and no online solver is
-     *       configured, we'll never run into the error case below and replay
-     *       (the Smt2Solver only answers 'unknown' and dumps SMT2 -> should
-     *       never terminate with an error).  We therefore dump every generated
-     *       sequence to smt2 continuously. */
-
-    /* Run and test for error without tracing to trace file (we by default still
-     * trace to stdout here, which is redirected to /dev/null).
-     * If error encountered, replay and trace below. */
-
-    std::string api_trace_file_name = get_api_trace_file_name(seed);
-    bool smt2_offline =
-        (d_options.solver == SOLVER_SMT2 && d_options.solver_binary.empty());
-    Result res =
-        run(seed,
-            d_options.time,
-            out_file_name,
-            err_file_name,
-            api_trace_file_name,
-            d_options.untrace_file_name,
-            true,
-            true,
-            // for the SMT2 offline mode we want to store all SMT2 files
-            smt2_offline ? TO_FILE : NONE);
-
-    std::string errmsg, errmsg_filtered;
-    ErrorKind errkind = ErrorKind::ERROR;
-    /* report status */
-    if (res == RESULT_OK)
-    {
-      if (term.is_term())
+  /* Kill all in-flight test runs, used when aborting on config errors. */
+  auto kill_test_runs = [&]() {
+    for (auto& [worker, run] : test_runs)
+    {
+      cancel_test_run(run);
+    }
+  };
+
+  do
+  {
+    /* Start new test runs until all workers are busy. */
+    while (!idle_workers.empty()
+           && (d_options.max_runs == 0
+               || num_started_runs < d_options.max_runs))
+    {
+      uint32_t worker = idle_workers.back();
+      idle_workers.pop_back();
+
+      uint64_t seed       = sg.next();
+      std::string tmp_dir = get_worker_tmp_dir(worker);
+
+      /* Note: If the selected solver is SOLVER_SMT2 and no online solver is
+       *       configured, we'll never run into the error case below and
+       *       replay (the Smt2Solver only answers 'unknown' and dumps SMT2 ->
+       *       should never terminate with an error).  We therefore dump every
+       *       generated sequence to smt2 continuously. */
+
+      /* Run and test for error without tracing to trace file (we by default
+       * still trace to stdout here, which is redirected to /dev/null).
+       * If error encountered, replay and trace below. */
+      test_runs.emplace_back(
+          worker,
+          new_test_run(seed,
+                       d_options.time,
+                       tmp_dir,
+                       out_file_name,
+                       DEVNULL,
+                       get_api_trace_file_name(seed),
+                       d_options.untrace_file_name,
+                       true,
+                       // for the SMT2 offline mode we want to store all SMT2
+                       // files
+                       smt2_offline ? TO_FILE : NONE));
+
+      test_runs.back().second.d_worker = worker;
+
+      if (smt2_persistent)
       {
-        term.erase(std::cout);
+        smt2::Smt2Process& process = d_smt2_processes[worker];
+        if (!process.is_running())
+        {
+          process.start(d_options.solver_binary);
+        }
+        test_runs.back().second.d_smt2_process = &process;
       }
-      else
+
+      if (!is_parallel)
       {
-        std::cout << std::endl;
-        ++num_printed_lines;
+        print_status(seed);
       }
+      start_test_run(test_runs.back().second, true);
+      num_started_runs += 1;
     }
-    else
+
+    if (test_runs.empty()) break;
+
+    /* Wait for the next test run to terminate. */
+    wait_test_run();
+
+    for (auto it = test_runs.begin(); it != test_runs.end();)
     {
-      /* Read error file and check if we already encounterd the same error. */
-      if (res == RESULT_ERROR || res == RESULT_ERROR_CONFIG
-          || res == RESULT_ERROR_UNTRACE)
+      TestRun& run = it->second;
+      if (!run.d_done)
       {
-        std::ifstream errs = open_input_file(err_file_name, false);
-        std::string line;
-        while (std::getline(errs, line))
-        {
-          errmsg += line + "\n";
-        }
-        if (res == RESULT_ERROR)
-        {
-          std::tie(errkind, errmsg_filtered, error_id, error_nduplicates) =
-              add_error(errmsg, seed);
-        }
-        else if (res == RESULT_ERROR_CONFIG)
+        ++it;
+        continue;
+      }
+
+      uint64_t seed                   = run.d_seed;
+      std::string api_trace_file_name = run.d_api_trace_file_name;
+
+      Result res = finish_test_run(run);
+
+      if (run.d_smt2_process && res != RESULT_OK)
+      {
+        run.d_smt2_process->stop();
+      }
+
+      if (is_parallel)
+      {
+        print_status(seed);
+      }
+
+      std::string errmsg, errmsg_filtered;
+      ErrorKind errkind = ErrorKind::ERROR;
+      /* report status */
+      if (res == RESULT_OK)
+      {
+        if (term.is_term())
         {
           term.erase(std::cout);
-          MURXLA_CHECK_CONFIG(false) << errmsg_filtered << " " << d_error_msg;
         }
         else
         {
-          assert(res == RESULT_ERROR_UNTRACE);
-          MURXLA_CHECK_TRACE(false) << errmsg_filtered << " " << d_error_msg;
+          std::cout << std::endl;
+          ++num_printed_lines;
         }
       }
-
-      std::stringstream info;
-      info << " [";
-      switch (res)
+      else
       {
-        case RESULT_ERROR:
-          if (errkind == ErrorKind::DUPLICATE)
+        /* Read captured error output and check if we already encountered the
+         * same error. */
+        if (res == RESULT_ERROR || res == RESULT_ERROR_CONFIG
+            || res == RESULT_ERROR_UNTRACE)
+        {
+          std::istringstream errs(run.d_err);
+          std::string line;
+          while (std::getline(errs, line))
           {
-            info << term.green() << "duplicate:" << error_id;
+            errmsg += line + "\n";
           }
-          else if (errkind == ErrorKind::ERROR)
+          if (res == RESULT_ERROR)
           {
-            info << term.red() << "error:" << error_id;
+            std::tie(errkind, errmsg_filtered, error_id, error_nduplicates) =
+                add_error(errmsg, seed);
           }
-          else if (errkind == ErrorKind::FILTER)
+          else if (res == RESULT_ERROR_CONFIG)
           {
-            info << term.gray() << "filtered";
+            term.erase(std::cout);
+            kill_test_runs();
+            MURXLA_CHECK_CONFIG(false) << errmsg_filtered << " " << d_error_msg;
           }
-          break;
-        case RESULT_ERROR_CONFIG: info << term.red() << "config error"; break;
-        case RESULT_ERROR_UNTRACE: info << term.red() << "untrace error"; break;
-        case RESULT_TIMEOUT:
-          info << term.blue() << "timeout";
-          ++num_timeouts;
-          break;
-        default: assert(res == RESULT_UNKNOWN); info << "unknown";
-      }
-      info << term.defaultcolor() << "]";
+          else
+          {
+            assert(res == RESULT_ERROR_UNTRACE);
+            kill_test_runs();
+            MURXLA_CHECK_TRACE(false) << errmsg_filtered << " " << d_error_msg;
+          }
+        }
 
-      std::cout << info.str() << std::flush;
-      if (res == RESULT_ERROR && errkind != ErrorKind::FILTER)
-      {
-        std::cout << " ";
-      }
-      else
-      {
-        std::cout << std::endl;
-        ++num_printed_lines;
-      }
+        std::stringstream info;
+        info << " [";
+        switch (res)
+        {
+          case RESULT_ERROR:
+            if (errkind == ErrorKind::DUPLICATE)
+            {
+              info << term.green() << "duplicate:" << error_id;
+            }
+            else if (errkind == ErrorKind::ERROR)
+            {
+              info << term.red() << "error:" << error_id;
+            }
+            else if (errkind == ErrorKind::FILTER)
+            {
+              info << term.gray() << "filtered";
+            }
+            break;
+          case RESULT_ERROR_CONFIG: info << term.red() << "config error"; break;
+          case RESULT_ERROR_UNTRACE:
+            info << term.red() << "untrace error";
+            break;
+          case RESULT_TIMEOUT:
+            info << term.blue() << "timeout";
+            ++num_timeouts;
+            break;
+          default: assert(res == RESULT_UNKNOWN); info << "unknown";
+        }
+        info << term.defaultcolor() << "]";
 
-      /* Replay and trace on error.
-       *
-       * If SMT2 solver with online solver configured, dump smt2 on replay.
-       * If SMT2 solver configured without an online solver, we'll never enter
-       * here (the SMT2 solver should never return an error result). */
-      if (res != RESULT_TIMEOUT && errkind != ErrorKind::FILTER)
-      {
-        // No need to replay SMT2 since we already have the SMT2 problem.
-        if (smt2_offline)
+        std::cout << info.str() << std::flush;
+        if (res == RESULT_ERROR && errkind != ErrorKind::FILTER)
         {
-          std::cout << get_smt2_file_name(seed, api_trace_file_name)
-                    << std::endl;
+          std::cout << " ";
         }
         else
         {
-          assert(error_id > 0);
-          api_trace_file_name = get_api_trace_file_name(seed, error_id);
-          Result res_replay = replay(seed,
-                                     out_file_name,
-                                     err_file_name,
-                                     api_trace_file_name,
-                                     d_options.untrace_file_name);
-
-          std::cout << api_trace_file_name << std::endl;
-
-          // Note: This may happen in few cases where the replay runs into a
-          // timeout, but the original run does not.
-          MURXLA_WARN(res != res_replay)
-              << "Replay did not return the same result as original run. "
-              << "Original run returned " << res << ", but replay returned "
-              << res_replay << ".";
+          std::cout << std::endl;
+          ++num_printed_lines;
+        }
+
+        /* Replay and trace on error.
+         *
+         * If SMT2 solver with online solver configured, dump smt2 on replay.
+         * If SMT2 solver configured without an online solver, we'll never
+         * enter here (the SMT2 solver should never return an error result).
+         *
+         * Note: Replay is executed while the other workers continue with
+         *       their test runs. */
+        if (res != RESULT_TIMEOUT && errkind != ErrorKind::FILTER)
+        {
+          // No need to replay SMT2 since we already have the SMT2 problem.
+          if (smt2_offline)
+          {
+            std::cout << get_smt2_file_name(seed, api_trace_file_name)
+                      << std::endl;
+          }
+          else
+          {
+            assert(error_id > 0);
+            api_trace_file_name = get_api_trace_file_name(seed, error_id);
+            Result res_replay   = replay(seed,
+                                       out_file_name,
+                                       DEVNULL,
+                                       api_trace_file_name,
+                                       d_options.untrace_file_name);
+
+            std::cout << api_trace_file_name << std::endl;
+
+            // Note: This may happen in few cases where the replay runs into a
+            // timeout, but the original run does not.
+            MURXLA_WARN(res != res_replay)
+                << "Replay did not return the same result as original run. "
+                << "Original run returned " << res << ", but replay returned "
+                << res_replay << ".";
+          }
+        }
+        /* Print new error message after it was found. */
+        if (res == RESULT_ERROR && errkind == ErrorKind::ERROR)
+        {
+          std::cout << std::endl;
+          std::cout << rstrip(errmsg_filtered) << "\n" << std::endl;
+          num_printed_lines = 0;  // print header again after error
+
+          // If it is the first error, we also store the error message in a
+          // text file.
+          assert(error_nduplicates == 1);
+          std::filesystem::path fp(api_trace_file_name);
+          std::string text_file = prepend_path(fp.parent_path(), "error.txt");
+          std::ofstream os(text_file);
+          os << errmsg_filtered << "\n";
         }
       }
-      /* Print new error message after it was found. */
-      if (res == RESULT_ERROR && errkind == ErrorKind::ERROR)
-      {
-        std::cout << std::endl;
-        std::cout << rstrip(errmsg_filtered) << "\n" << std::endl;
-        num_printed_lines = 0;  // print header again after error
-
-        // If it is the first error, we also store the error message in a text
-        // file.
-        assert(error_nduplicates == 1);
-        std::filesystem::path fp(api_trace_file_name);
-        std::string text_file = prepend_path(fp.parent_path(), "error.txt");
-        std::ofstream os(text_file);
-        os << errmsg_filtered << "\n";
-      }
+
+      idle_workers.push_back(it->first);
+      it = test_runs.erase(it);
     }
-  } while (d_options.max_runs == 0 || num_runs < d_options.max_runs);
+  } while (true);
 }
 
 Result
@@ -528,7 +770,11 @@ Murxla::new_solver(SolverSeedGenerator& sng,
   }
   else if (solver_kind == SOLVER_SMT2)
   {
-    return new smt2::Smt2Solver(sng, smt2_out, d_options.solver_binary);
+    return new smt2::Smt2Solver(sng,
+                                smt2_out,
+                                d_options.solver_binary,
+                                d_options.smt2_pipelined,
+                                d_smt2_process);
   }
   MURXLA_CHECK(true) << "no solver created";
   return nullptr;
@@ -549,7 +795,8 @@ Murxla::create_solver(SolverSeedGenerator& sng, std::ostream& smt2_out) const
   if (!d_options.cross_check.empty())
   {
     Solver* reference_solver = new_solver(sng, d_options.cross_check);
-    solver = new shadow::ShadowSolver(sng, solver, reference_solver);
+    solver = new shadow::ShadowSolver(
+        sng, solver, reference_solver, d_options.cross_check_concurrent);
   }
 
   return solver;
@@ -564,8 +811,8 @@ Murxla::create_fsm(RNGenerator& rng,
                    bool in_untrace_replay_mode) const
 {
   /* Dummy statistics object for the cases were we don't want to record
-   * statistics (replay, dd). */
-  statistics::Statistics dummy_stats;
+   * statistics (replay, dd). Static since it is referenced by the FSM. */
+  static auto dummy_stats = statistics::Statistics::create();
 
   if (!d_options.cmd_line_trace.empty())
   {
@@ -583,7 +830,7 @@ Murxla::create_fsm(RNGenerator& rng,
              d_options.smtlib_compliant,
              d_options.fuzz_options,
              d_options.fuzz_options_filter,
-             record_stats ? d_stats : &dummy_stats,
+             record_stats ? d_stats : dummy_stats.get(),
              d_options.enabled_theories,
              d_options.disabled_theories,
              d_options.solver_options,
@@ -603,26 +850,57 @@ Murxla::print_fsm() const
   fsm.print();
 }
 
-Result
-Murxla::run_aux(uint64_t seed,
-                double time,
-                const std::string& file_out,
-                const std::string& file_err,
-                std::string& api_trace_file_name,
-                const std::string& untrace_file_name,
-                bool run_forked,
-                bool record_stats,
-                Murxla::TraceMode trace_mode,
-                std::string& error_msg)
-{
-  int32_t status, fd;
-  Result result;
-  pid_t pid_solver = 0, pid_timeout = 0;
+Murxla::TestRun
+Murxla::new_test_run(uint64_t seed,
+                     double time,
+                     const std::string& tmp_dir,
+                     const std::string& file_out,
+                     const std::string& file_err,
+                     const std::string& api_trace_file_name,
+                     const std::string& untrace_file_name,
+                     bool run_forked,
+                     Murxla::TraceMode trace_mode) const
+{
+  TestRun run;
+  run.d_seed                = seed;
+  run.d_time                = time;
+  run.d_tmp_dir             = tmp_dir;
+  run.d_tmp_file_out        = get_tmp_file_path("run-tmp1.out", tmp_dir);
+  run.d_tmp_file_err        = get_tmp_file_path("run-tmp1.err", tmp_dir);
+  run.d_file_out            = file_out;
+  run.d_file_err            = file_err;
+  run.d_api_trace_file_name = api_trace_file_name;
+  run.d_untrace_file_name   = untrace_file_name;
+  run.d_run_forked          = run_forked;
+  run.d_trace_mode          = trace_mode;
+
+  /* If we don't run forked, and an explicit api trace file name is given, the
+   * trace is immediately written to the given file (rather than writing it
+   * first to a temp file).  This is because else, we don't get a chance to
+   * write the contents from the temp file back to the given file when the
+   * process aborts (if the trace triggers an issue).
+   *
+   * When forking, start_test_run() stores the name of the temp file in
+   * 'd_tmp_api_trace_file_name', and its contents are then copied into the
+   * given file 'd_api_trace_file_name' in finish_test_run(). */
+  if (!run_forked)
+  {
+    run.d_tmp_api_trace_file_name = api_trace_file_name;
+  }
+  return run;
+}
+
+void
+Murxla::start_test_run(TestRun& run, bool record_stats)
+{
+  pid_t pid_solver = 0;
   std::ofstream file_trace, file_smt2;
+  std::unique_ptr<TraceBuffer> trace_buffer, smt2_buffer;
+  std::unique_ptr<BinaryTraceWriter> binary_trace;
   std::ostream smt2_out(std::cout.rdbuf());
   std::ostream trace(std::cout.rdbuf());
 
-  if (trace_mode == NONE)
+  if (run.d_trace_mode == NONE)
   {
     file_trace = open_output_file(DEVNULL, false);
     trace.rdbuf(file_trace.rdbuf());
@@ -631,28 +909,59 @@ Murxla::run_aux(uint64_t seed,
       smt2_out.rdbuf(file_trace.rdbuf());
     }
   }
-  else if (trace_mode == TO_FILE)
+  else if (run.d_trace_mode == TO_FILE)
   {
     /* If we don't run forked and an explicit api trace file name is given,
      * we have to immediately trace into file. Else, we don't get a chance to
      * write the contents from the temp file back to the given file when the
      * process aborts (if the trace triggers an issue). */
-    if (run_forked || api_trace_file_name.empty())
+    if (run.d_run_forked || run.d_tmp_api_trace_file_name.empty())
     {
-      api_trace_file_name = get_tmp_file_path(API_TRACE, d_tmp_dir);
+      run.d_tmp_api_trace_file_name = get_tmp_file_path(API_TRACE, run.d_tmp_dir);
+    }
+    std::streambuf* trace_out;
+    if (d_options.buffer_trace)
+    {
+      trace_buffer.reset(new TraceBuffer(run.d_tmp_api_trace_file_name));
+      MURXLA_EXIT_ERROR(!trace_buffer->is_open())
+          << "unable to open output file '" << run.d_tmp_api_trace_file_name
+          << "'";
+      trace_out = trace_buffer.get();
+    }
+    else
+    {
+      file_trace = open_output_file(run.d_tmp_api_trace_file_name, false);
+      trace_out  = file_trace.rdbuf();
+    }
+    if (d_options.binary_trace)
+    {
+      binary_trace.reset(new BinaryTraceWriter(trace_out));
+      trace.rdbuf(binary_trace.get());
+    }
+    else
+    {
+      trace.rdbuf(trace_out);
     }
-    file_trace = open_output_file(api_trace_file_name, false);
-    trace.rdbuf(file_trace.rdbuf());
     if (d_options.solver == SOLVER_SMT2)
     {
-      std::string smt2_file_name = get_tmp_file_path(SMT2_FILE, d_tmp_dir);
-      file_smt2                  = open_output_file(smt2_file_name, false);
-      smt2_out.rdbuf(file_smt2.rdbuf());
+      std::string smt2_file_name = get_tmp_file_path(SMT2_FILE, run.d_tmp_dir);
+      if (d_options.buffer_trace)
+      {
+        smt2_buffer.reset(new TraceBuffer(smt2_file_name));
+        MURXLA_EXIT_ERROR(!smt2_buffer->is_open())
+            << "unable to open output file '" << smt2_file_name << "'";
+        smt2_out.rdbuf(smt2_buffer.get());
+      }
+      else
+      {
+        file_smt2 = open_output_file(smt2_file_name, false);
+        smt2_out.rdbuf(file_smt2.rdbuf());
+      }
     }
   }
   else
   {
-    assert(trace_mode == TO_STDOUT);
+    assert(run.d_trace_mode == TO_STDOUT);
     /* Disable API trace output if we only want SMT2 or native API calls to
      * stdout. */
     if (d_options.solver == SOLVER_SMT2 || d_options.solver_trace)
@@ -666,16 +975,21 @@ Murxla::run_aux(uint64_t seed,
    * solvers, which maintain their own RNG, seed with seeds from the solver
    * seed generator. This guarantees that runs can be reproduced even when
    * solvers use the RNG in their API wrapper functions. */
-  RNGenerator rng(seed);
+  RNGenerator rng(run.d_seed);
+  rng.set_compat_sampling(d_options.compat_sampling);
   /* The solver seed generator.  Responsible for generating seeds to be used to
    * seed the random generator of the solver. */
-  SolverSeedGenerator sng(seed);
-
-  result = RESULT_UNKNOWN;
+  SolverSeedGenerator sng(run.d_seed);
+  sng.set_compat_sampling(d_options.compat_sampling);
 
   /* If seeded, run in main process. */
-  if (run_forked)
+  if (run.d_run_forked)
   {
+    /* The output of the child process is captured in memory, and only written
+     * to the file system in finish_test_run() if requested. */
+    run.d_fd_out = open_capture_fd("murxla-out", run.d_tmp_file_out);
+    run.d_fd_err = open_capture_fd("murxla-err", run.d_tmp_file_err);
+
     pid_solver = fork();
 
     MURXLA_CHECK(pid_solver >= 0) << "forking solver process failed.";
@@ -684,151 +998,728 @@ Murxla::run_aux(uint64_t seed,
   /* parent */
   if (pid_solver)
   {
-    /* If a time limit is given, fork another process that kills the pid_solver
-     * after time seconds. (https://stackoverflow.com/a/8020324) */
-    if (time != 0)
+    register_test_run(run, pid_solver);
+  }
+  /* child */
+  else
+  {
+    signal(SIGINT, SIG_DFL);  // reset stats signal handler
+#ifdef MURXLA_COVERAGE
+    signal(SIGABRT, handle_abort);
+#endif
+
+    if (run.d_run_forked)
+    {
+      /* Redirect stdout and stderr of child process into capture buffers. */
+      MURXLA_EXIT_ERROR_FORK(dup2(run.d_fd_out, STDOUT_FILENO) < 0, true)
+          << "unable to redirect stdout";
+      MURXLA_EXIT_ERROR_FORK(dup2(run.d_fd_err, STDERR_FILENO) < 0, true)
+          << "unable to redirect stderr";
+      close(run.d_fd_out);
+      close(run.d_fd_err);
+    }
+
+    d_smt2_process = run.d_smt2_process;
+    statistics::Statistics::set_shard(run.d_worker);
+
+    try
     {
-      pid_timeout = fork();
+      FSM fsm = create_fsm(rng,
+                           sng,
+                           trace,
+                           smt2_out,
+                           record_stats,
+                           !run.d_untrace_file_name.empty());
 
-      MURXLA_CHECK(pid_timeout >= 0) << "forking timeout process failed";
+      fsm.configure();
 
-      if (pid_timeout == 0)
+      /* replay/untrace given API trace */
+      if (!run.d_untrace_file_name.empty())
       {
-        signal(SIGINT, SIG_DFL);  // reset stats signal handler
-        usleep(static_cast<useconds_t>(time * 1000000));
-        exit(EXIT_OK);
+        fsm.untrace(run.d_untrace_file_name);
       }
+      /* regular MBT run */
+      else
+      {
+        fsm.run();
+      }
+    }
+    catch (MurxlaConfigException& e)
+    {
+      MURXLA_EXIT_ERROR_CONFIG_FORK(true, run.d_run_forked) << e.get_msg();
+    }
+    catch (MurxlaUntraceException& e)
+    {
+      MURXLA_EXIT_ERROR_UNTRACE_FORK(true, run.d_run_forked) << e.get_msg();
+    }
+    catch (MurxlaException& e)
+    {
+      MURXLA_EXIT_ERROR_FORK(true, run.d_run_forked) << e.get_msg();
     }
 
-    /* Wait for the first process to finish (pid_solver or pid_timeout). */
-    pid_t exited_pid = wait(&status);
+    binary_trace.reset();
+    trace_buffer.reset();
+    smt2_buffer.reset();
+    if (file_trace.is_open()) file_trace.close();
 
-    if (exited_pid == pid_solver)
+    if (run.d_run_forked)
     {
-      /* Kill and collect timeout process if solver process terminated first. */
-      if (pid_timeout)
+      exit(EXIT_OK);
+    }
+    else
+    {
+      run.d_result = RESULT_OK;
+      run.d_done   = true;
+    }
+  }
+}
+
+void
+Murxla::register_test_run(TestRun& run, pid_t pid_solver)
+{
+  /* Register in-flight test run, collected in wait_test_run(). */
+  run.d_pid_solver = pid_solver;
+  if (run.d_time != 0)
+  {
+    run.d_deadline = get_monotonic_time() + run.d_time;
+  }
+  d_pid_to_test_run[pid_solver] = &run;
+  watch_solver_process(run);
+}
+
+bool
+Murxla::wait_test_run()
+{
+  if (d_pid_to_test_run.empty()) return false;
+
+  std::vector<TestRun*> runs;
+  for (const auto& p : d_pid_to_test_run)
+  {
+    runs.push_back(p.second);
+  }
+
+  for (;;)
+  {
+    bool collected  = false;
+    double now      = get_monotonic_time();
+    double deadline = 0;
+
+    for (TestRun* run : runs)
+    {
+      int32_t status;
+      pid_t pid = waitpid(run->d_pid_solver, &status, WNOHANG);
+      MURXLA_CHECK(pid >= 0 || errno == EINTR)
+          << "waiting for solver process failed";
+      if (pid == run->d_pid_solver)
       {
-        kill(pid_timeout, SIGKILL);
-        waitpid(pid_timeout, nullptr, 0);
+        collect_solver_process(*run, status);
+        collected = true;
       }
-      if (WIFEXITED(status))
+      else if (run->d_deadline > 0 && now >= run->d_deadline)
       {
-        switch (WEXITSTATUS(status))
-        {
-          case EXIT_OK: result = RESULT_OK; break;
-          case EXIT_ERROR_CONFIG: result = RESULT_ERROR_CONFIG; break;
-          case EXIT_ERROR_UNTRACE: result = RESULT_ERROR_UNTRACE; break;
-          default:
-            assert(WEXITSTATUS(status) == EXIT_ERROR);
-            result = RESULT_ERROR;
-        }
+        kill_solver_process(*run, RESULT_TIMEOUT);
+        collected = true;
       }
-      else if (WIFSIGNALED(status))
+      else if (run->d_deadline > 0
+               && (deadline == 0 || run->d_deadline < deadline))
       {
-        result = RESULT_ERROR;
+        deadline = run->d_deadline;
       }
-      if (result == RESULT_ERROR_CONFIG || result == RESULT_ERROR_UNTRACE)
+    }
+
+    if (collected) return true;
+
+    /* Wait until a solver process terminates or the next deadline is
+     * reached. */
+    wait_solver_processes(deadline);
+  }
+}
+
+void
+Murxla::cancel_test_run(TestRun& run)
+{
+  if (run.d_done) return;
+  assert(run.d_run_forked);
+  kill_solver_process(run, RESULT_UNKNOWN);
+}
+
+void
+Murxla::watch_solver_process(TestRun& run)
+{
+#ifdef MURXLA_USE_PIDFD
+  if (d_epoll_fd < 0 && !d_epoll_unavailable)
+  {
+    d_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    d_timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (d_epoll_fd >= 0 && d_timer_fd >= 0)
+    {
+      struct epoll_event ev = {};
+      ev.events             = EPOLLIN;
+      ev.data.fd            = d_timer_fd;
+      MURXLA_CHECK(epoll_ctl(d_epoll_fd, EPOLL_CTL_ADD, d_timer_fd, &ev) == 0)
+          << "unable to register timer";
+    }
+    else
+    {
+      close_event_fds();
+    }
+  }
+  if (d_epoll_fd >= 0)
+  {
+    int32_t fd =
+        static_cast<int32_t>(syscall(SYS_pidfd_open, run.d_pid_solver, 0));
+    if (fd >= 0)
+    {
+      struct epoll_event ev = {};
+      ev.events             = EPOLLIN;
+      ev.data.fd            = fd;
+      MURXLA_CHECK(epoll_ctl(d_epoll_fd, EPOLL_CTL_ADD, fd, &ev) == 0)
+          << "unable to register solver process";
+      run.d_pidfd = fd;
+    }
+    else
+    {
+      /* pidfd_open() is not supported by the kernel (Linux < 5.3), fall back
+       * to polling for all remaining runs. */
+      close_event_fds();
+    }
+  }
+#else
+  (void) run;
+#endif
+}
+
+void
+Murxla::wait_solver_processes(double deadline)
+{
+#ifdef MURXLA_USE_PIDFD
+  if (d_epoll_fd >= 0)
+  {
+    struct itimerspec its = {};
+    if (deadline > 0)
+    {
+      its.it_value.tv_sec  = static_cast<time_t>(deadline);
+      its.it_value.tv_nsec = static_cast<long>(
+          (deadline - static_cast<double>(its.it_value.tv_sec)) * 1000000000);
+    }
+    MURXLA_CHECK(
+        timerfd_settime(d_timer_fd, TFD_TIMER_ABSTIME, &its, nullptr) == 0)
+        << "unable to set timer";
+
+    struct epoll_event events[16];
+    int32_t n = epoll_wait(d_epoll_fd, events, 16, -1);
+    MURXLA_CHECK(n >= 0 || errno == EINTR) << "waiting for events failed";
+    for (int32_t i = 0; i < n; ++i)
+    {
+      if (events[i].data.fd == d_timer_fd)
       {
-        std::ifstream ferr(file_err);
-        std::stringstream ss;
-        ss << ferr.rdbuf();
-        error_msg = ss.str();
+        uint64_t expirations;
+        (void) !read(d_timer_fd, &expirations, sizeof(expirations));
       }
     }
-    else
+    return;
+  }
+#endif
+  /* Fallback: poll solver processes. */
+  double timeout = 0.001;
+  if (deadline > 0)
+  {
+    timeout = std::min(timeout, std::max(deadline - get_monotonic_time(), 0.0));
+  }
+  usleep(static_cast<useconds_t>(timeout * 1000000));
+}
+
+void
+Murxla::collect_solver_process(TestRun& run, int32_t status)
+{
+  Result result = RESULT_UNKNOWN;
+
+  if (WIFEXITED(status))
+  {
+    switch (WEXITSTATUS(status))
     {
-      /* Kill and collect solver process if time limit is exceeded. */
-      assert(pid_timeout);
+      case EXIT_OK: result = RESULT_OK; break;
+      case EXIT_ERROR_CONFIG: result = RESULT_ERROR_CONFIG; break;
+      case EXIT_ERROR_UNTRACE: result = RESULT_ERROR_UNTRACE; break;
+      default:
+        assert(WEXITSTATUS(status) == EXIT_ERROR);
+        result = RESULT_ERROR;
+    }
+  }
+  else if (WIFSIGNALED(status))
+  {
+    result = RESULT_ERROR;
+  }
+  unregister_test_run(run, result);
+  if (result == RESULT_ERROR_CONFIG || result == RESULT_ERROR_UNTRACE)
+  {
+    run.d_error_msg = run.d_err;
+  }
+}
+
+void
+Murxla::kill_solver_process(TestRun& run, Result result)
+{
 #ifdef MURXLA_COVERAGE
-      /* Try to trigger the abort handler to dump coverage information. */
-      kill(pid_solver, SIGABRT);
-      usleep(100);
+  /* Try to trigger the abort handler to dump coverage information. */
+  kill(run.d_pid_solver, SIGABRT);
+  usleep(100);
 #endif
-      /* Signal the SMT2 solver to kill the online solver process. */
-      if (d_options.solver == SOLVER_SMT2 && !d_options.solver_binary.empty())
+  /* Signal the SMT2 solver to kill the online solver process. */
+  if (d_options.solver == SOLVER_SMT2 && !d_options.solver_binary.empty())
+  {
+    kill(run.d_pid_solver, SIGINT);
+    usleep(100);
+  }
+  /* Give the solver process the chance to write its buffered trace output
+   * (see TraceBuffer) before it gets killed. */
+  if (d_options.buffer_trace)
+  {
+    kill(run.d_pid_solver, SIGTERM);
+    for (uint32_t i = 0; i < MURXLA_TERM_GRACE_PERIOD_MS; ++i)
+    {
+      if (waitpid(run.d_pid_solver, nullptr, WNOHANG) == run.d_pid_solver)
       {
-        kill(pid_solver, SIGINT);
-        usleep(100);
+        unregister_test_run(run, result);
+        return;
       }
-      kill(pid_solver, SIGKILL);
-      waitpid(pid_solver, nullptr, 0);
-      result = RESULT_TIMEOUT;
+      usleep(1000);
     }
   }
-  /* child */
-  else
+  kill(run.d_pid_solver, SIGKILL);
+  waitpid(run.d_pid_solver, nullptr, 0);
+  unregister_test_run(run, result);
+}
+
+void
+Murxla::unregister_test_run(TestRun& run, Result result)
+{
+#ifdef MURXLA_USE_PIDFD
+  if (run.d_pidfd >= 0)
   {
-    signal(SIGINT, SIG_DFL);  // reset stats signal handler
-#ifdef MURXLA_COVERAGE
-    signal(SIGABRT, handle_abort);
+    if (d_epoll_fd >= 0)
+    {
+      epoll_ctl(d_epoll_fd, EPOLL_CTL_DEL, run.d_pidfd, nullptr);
+    }
+    close(run.d_pidfd);
+    run.d_pidfd = -1;
+  }
+#endif
+  d_pid_to_test_run.erase(run.d_pid_solver);
+  run.d_out    = read_capture_fd(run.d_fd_out);
+  run.d_err    = read_capture_fd(run.d_fd_err);
+  run.d_fd_out = -1;
+  run.d_fd_err = -1;
+  run.d_result = result;
+  run.d_done   = true;
+}
+
+void
+Murxla::close_event_fds()
+{
+#ifdef MURXLA_USE_PIDFD
+  if (d_epoll_fd >= 0) close(d_epoll_fd);
+  if (d_timer_fd >= 0) close(d_timer_fd);
+  d_epoll_fd          = -1;
+  d_timer_fd          = -1;
+  d_epoll_unavailable = true;
 #endif
+}
+
+Result
+Murxla::finish_test_run(TestRun& run)
+{
+  assert(run.d_done);
+
+  if (run.d_trace_mode == TO_FILE)
+  {
+    std::string copy_from, copy_to;
 
-    if (run_forked)
+    /* For the SMT2 solver, we only write the SMT2 file (not the trace). */
+    if (!d_options.dd && d_options.solver == SOLVER_SMT2)
+    {
+      copy_from = get_tmp_file_path(SMT2_FILE, run.d_tmp_dir);
+      copy_to   = get_smt2_file_name(run.d_seed, run.d_untrace_file_name);
+    }
+    /* For all other solvers, we write the trace file. */
+    else if (run.d_api_trace_file_name != DEVNULL)
     {
-      /* Redirect stdout and stderr of child process into given files. */
-      fd = open(
-          file_out.c_str(), O_CREAT | O_WRONLY | O_TRUNC, S_IRUSR | S_IWUSR);
+      copy_from = run.d_tmp_api_trace_file_name;
+      copy_to   = run.d_api_trace_file_name;
+    }
 
-      MURXLA_EXIT_ERROR_FORK(fd < 0, true)
-          << "unable to open file " << file_out;
-      dup2(fd, STDOUT_FILENO);
-      close(fd);
-      fd = open(
-          file_err.c_str(), O_CREAT | O_WRONLY | O_TRUNC, S_IRUSR | S_IWUSR);
-      if (fd < 0)
+    if (copy_from != copy_to)
+    {
+      assert(std::filesystem::exists(copy_from));
+
+      // Create parent directories if they do not exist yet.
+      std::filesystem::path fp(copy_to);
+      if (fp.has_parent_path() && !std::filesystem::exists(fp.parent_path()))
       {
-        perror(0);
-        MURXLA_EXIT_ERROR_FORK(true, true)
-            << "unable to open file " << file_err;
+        std::filesystem::create_directories(fp.parent_path());
       }
-      dup2(fd, STDERR_FILENO);
-      close(fd);
+      std::filesystem::copy(copy_from,
+                            copy_to,
+                            std::filesystem::copy_options::overwrite_existing);
     }
+  }
+  // Print terminating "}" for main() function of native API traces.
+  else if (run.d_trace_mode == TO_STDOUT && d_options.solver_trace)
+  {
+    std::cout << "}" << std::endl;
+  }
 
-    try
+  if (run.d_run_forked)
+  {
+    if (run.d_file_out != DEVNULL)
+    {
+      std::ofstream out = open_output_file(run.d_file_out, true);
+      out << run.d_out;
+    }
+    if (run.d_file_err != DEVNULL)
     {
-      FSM fsm = create_fsm(
-          rng, sng, trace, smt2_out, record_stats, !untrace_file_name.empty());
+      std::ofstream err = open_output_file(run.d_file_err, true);
+      err << run.d_err;
+    }
+  }
 
-      fsm.configure();
+  d_error_msg = run.d_error_msg;
+  return run.d_result;
+}
 
-      /* replay/untrace given API trace */
-      if (!untrace_file_name.empty())
+bool
+Murxla::supports_snapshots() const
+{
+#ifdef MURXLA_USE_SNAPSHOTS
+  /* The process of an online solver can't be forked together with the
+   * snapshot process. */
+  return d_options.solver != SOLVER_SMT2 || d_options.solver_binary.empty();
+#else
+  return false;
+#endif
+}
+
+bool
+Murxla::new_snapshot(Snapshot& snapshot,
+                     uint64_t seed,
+                     double time,
+                     const std::string& tmp_dir,
+                     const std::string& untrace_file_name,
+                     const Snapshot* parent)
+{
+#ifdef MURXLA_USE_SNAPSHOTS
+  assert(supports_snapshots());
+
+  int32_t fds[2];
+  if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, fds))
+  {
+    return false;
+  }
+
+  /* Test runs forked from snapshots are reparented to this process, see
+   * serve_snapshot(). */
+  if (d_num_snapshots == 0 && prctl(PR_SET_CHILD_SUBREAPER, 1) != 0)
+  {
+    close(fds[0]);
+    close(fds[1]);
+    return false;
+  }
+  d_num_snapshots += 1;
+
+  bool success    = true;
+  pid_t pid_child = 0;
+  if (parent)
+  {
+    success = send_message(parent->d_fd,
+                           std::string(1, FORK_SNAPSHOT) + untrace_file_name,
+                           {fds[1]});
+    close(fds[1]);
+  }
+  else
+  {
+    int32_t fd_out = open_capture_fd(
+        "murxla-snapshot-out", get_tmp_file_path("snapshot.out", tmp_dir));
+    int32_t fd_err = open_capture_fd(
+        "murxla-snapshot-err", get_tmp_file_path("snapshot.err", tmp_dir));
+    pid_t pid_main = getpid();
+
+    pid_child = fork();
+    MURXLA_CHECK(pid_child >= 0) << "forking snapshot process failed.";
+
+    /* child */
+    if (pid_child == 0)
+    {
+      close(fds[0]);
+      /* Do not outlive the main process. */
+      prctl(PR_SET_PDEATHSIG, SIGKILL);
+      if (getppid() != pid_main) _exit(EXIT_ERROR);
+      signal(SIGINT, SIG_DFL);  // reset stats signal handler
+      /* Snapshot processes do not collect their children. */
+      signal(SIGCHLD, SIG_IGN);
+
+      MURXLA_EXIT_ERROR_FORK(dup2(fd_out, STDOUT_FILENO) < 0, true)
+          << "unable to redirect stdout";
+      MURXLA_EXIT_ERROR_FORK(dup2(fd_err, STDERR_FILENO) < 0, true)
+          << "unable to redirect stderr";
+      close(fd_out);
+      close(fd_err);
+
+      /* While delta debugging, do not trace to file or stdout. */
+      std::ofstream file_trace = open_output_file(DEVNULL, false);
+      std::ostream trace(file_trace.rdbuf());
+      std::ostream smt2_out(std::cout.rdbuf());
+      if (d_options.solver == SOLVER_SMT2)
+      {
+        smt2_out.rdbuf(file_trace.rdbuf());
+      }
+      RNGenerator rng(seed);
+      rng.set_compat_sampling(d_options.compat_sampling);
+      SolverSeedGenerator sng(seed);
+      sng.set_compat_sampling(d_options.compat_sampling);
+
+      try
       {
+        FSM fsm = create_fsm(rng, sng, trace, smt2_out, false, true);
+        fsm.configure();
         fsm.untrace(untrace_file_name);
+        /* Only returns in forked test runs. */
+        fsm.untrace(serve_snapshot(fsm, fds[1], pid_main, tmp_dir));
       }
-      /* regular MBT run */
-      else
+      catch (MurxlaConfigException& e)
       {
-        fsm.run();
+        MURXLA_EXIT_ERROR_CONFIG_FORK(true, true) << e.get_msg();
       }
+      catch (MurxlaUntraceException& e)
+      {
+        MURXLA_EXIT_ERROR_UNTRACE_FORK(true, true) << e.get_msg();
+      }
+      catch (MurxlaException& e)
+      {
+        MURXLA_EXIT_ERROR_FORK(true, true) << e.get_msg();
+      }
+      if (file_trace.is_open()) file_trace.close();
+      exit(EXIT_OK);
     }
-    catch (MurxlaConfigException& e)
-    {
-      MURXLA_EXIT_ERROR_CONFIG_FORK(true, run_forked) << e.get_msg();
-    }
-    catch (MurxlaUntraceException& e)
+
+    close(fds[1]);
+    close(fd_out);
+    close(fd_err);
+  }
+
+  /* Wait until the snapshot process replayed the trace, it then sends its
+   * pid. */
+  std::string msg;
+  std::vector<int32_t> fds_received;
+  if (success)
+  {
+    struct pollfd pfd = {fds[0], POLLIN, 0};
+    int32_t timeout   = time > 0 ? static_cast<int32_t>(time * 1000) + 1 : -1;
+    int32_t res;
+    do
     {
-      MURXLA_EXIT_ERROR_UNTRACE_FORK(true, run_forked) << e.get_msg();
-    }
-    catch (MurxlaException& e)
+      res = poll(&pfd, 1, timeout);
+    } while (res < 0 && errno == EINTR);
+    success = res > 0 && recv_message(fds[0], msg, fds_received);
+  }
+  if (!success)
+  {
+    /* Note: If the snapshot was forked from a parent snapshot and did not
+     *       terminate yet, it will be killed when the parent is deleted. */
+    if (pid_child > 0)
     {
-      MURXLA_EXIT_ERROR_FORK(true, run_forked) << e.get_msg();
+      kill(pid_child, SIGKILL);
+      waitpid(pid_child, nullptr, 0);
     }
+    close(fds[0]);
+    if (--d_num_snapshots == 0) prctl(PR_SET_CHILD_SUBREAPER, 0);
+    return false;
+  }
+  snapshot.d_pid = static_cast<pid_t>(std::stol(msg));
+  snapshot.d_fd  = fds[0];
+  return true;
+#else
+  (void) snapshot;
+  (void) seed;
+  (void) time;
+  (void) tmp_dir;
+  (void) untrace_file_name;
+  (void) parent;
+  return false;
+#endif
+}
 
-    if (file_trace.is_open()) file_trace.close();
+void
+Murxla::delete_snapshot(Snapshot& snapshot)
+{
+#ifdef MURXLA_USE_SNAPSHOTS
+  assert(d_num_snapshots > 0);
+  kill(snapshot.d_pid, SIGKILL);
+  close(snapshot.d_fd);
+
+  /* The snapshot process is collected by its parent snapshot, or by this
+   * process if it is a direct child or was reparented to it. */
+  for (;;)
+  {
+    pid_t pid = waitpid(snapshot.d_pid, nullptr, WNOHANG);
+    if (pid == snapshot.d_pid) break;
+    if (pid < 0 && errno == ECHILD && kill(snapshot.d_pid, 0) != 0) break;
+    usleep(10);
+  }
+
+  snapshot.d_pid = 0;
+  snapshot.d_fd  = -1;
+  if (--d_num_snapshots == 0) prctl(PR_SET_CHILD_SUBREAPER, 0);
+#else
+  (void) snapshot;
+#endif
+}
 
-    if (run_forked)
+bool
+Murxla::start_test_run(TestRun& run, const Snapshot& snapshot)
+{
+#ifdef MURXLA_USE_SNAPSHOTS
+  assert(run.d_run_forked);
+  assert(run.d_trace_mode == NONE);
+
+  run.d_fd_out = open_capture_fd("murxla-out", run.d_tmp_file_out);
+  run.d_fd_err = open_capture_fd("murxla-err", run.d_tmp_file_err);
+
+  /* The snapshot process forks the test run, which sends its pid. */
+  std::string msg;
+  std::vector<int32_t> fds;
+  pid_t pid_solver = 0;
+  if (send_message(snapshot.d_fd,
+                   std::string(1, FORK_TEST_RUN) + run.d_untrace_file_name,
+                   {run.d_fd_out, run.d_fd_err})
+      && recv_message(snapshot.d_fd, msg, fds))
+  {
+    pid_solver = static_cast<pid_t>(std::stol(msg));
+  }
+  if (pid_solver <= 0)
+  {
+    close(run.d_fd_out);
+    close(run.d_fd_err);
+    run.d_fd_out = -1;
+    run.d_fd_err = -1;
+    return false;
+  }
+  register_test_run(run, pid_solver);
+  return true;
+#else
+  (void) run;
+  (void) snapshot;
+  return false;
+#endif
+}
+
+std::string
+Murxla::serve_snapshot(FSM& fsm,
+                       int32_t fd,
+                       pid_t pid_main,
+                       const std::string& tmp_dir)
+{
+#ifdef MURXLA_USE_SNAPSHOTS
+  std::string msg;
+  std::vector<int32_t> fds;
+
+  /* Signal that the trace has been replayed. */
+  std::cout << std::flush;
+  std::cerr << std::flush;
+  if (!send_message(fd, std::to_string(getpid()))) _exit(EXIT_OK);
+
+  /* Terminate when the main process closes the socket. */
+  while (recv_message(fd, msg, fds))
+  {
+    std::string untrace_file_name = msg.substr(1);
+
+    if (msg[0] == FORK_SNAPSHOT)
     {
-      exit(EXIT_OK);
+      assert(fds.size() == 1);
+      pid_t pid = fork();
+      if (pid == 0)
+      {
+        close(fd);
+        fd = fds[0];
+        prctl(PR_SET_PDEATHSIG, SIGKILL);
+        std::string file_name =
+            get_tmp_file_path("snapshot-" + std::to_string(getpid()), tmp_dir);
+        redirect_captured_output(
+            STDOUT_FILENO, "murxla-snapshot-out", file_name + ".out");
+        redirect_captured_output(
+            STDERR_FILENO, "murxla-snapshot-err", file_name + ".err");
+        fsm.untrace(untrace_file_name);
+        std::cout << std::flush;
+        std::cerr << std::flush;
+        if (!send_message(fd, std::to_string(getpid()))) _exit(EXIT_OK);
+        continue;
+      }
+      close(fds[0]);
     }
     else
     {
-      result = RESULT_OK;
+      assert(msg[0] == FORK_TEST_RUN);
+      assert(fds.size() == 2);
+      pid_t pid = fork();
+      if (pid == 0)
+      {
+        /* The test run is forked from an intermediate process that
+         * terminates immediately. The test run is thus reparented to the
+         * main process (a child subreaper) and collected there like any
+         * other test run. */
+        pid = fork();
+        if (pid != 0)
+        {
+          if (pid < 0) send_message(fd, "-1");
+          _exit(EXIT_OK);
+        }
+        signal(SIGCHLD, SIG_DFL);
+        while (getppid() != pid_main)
+        {
+          if (getppid() == 1) _exit(EXIT_ERROR);
+          usleep(10);
+        }
+        copy_captured_output(STDOUT_FILENO, fds[0]);
+        copy_captured_output(STDERR_FILENO, fds[1]);
+        if (dup2(fds[0], STDOUT_FILENO) < 0 || dup2(fds[1], STDERR_FILENO) < 0
+            || !send_message(fd, std::to_string(getpid())))
+        {
+          _exit(EXIT_ERROR);
+        }
+        close(fds[0]);
+        close(fds[1]);
+        close(fd);
+        return untrace_file_name;
+      }
+      if (pid < 0) send_message(fd, "-1");
+      close(fds[0]);
+      close(fds[1]);
     }
   }
+  _exit(EXIT_OK);
+#else
+  (void) fsm;
+  (void) fd;
+  (void) pid_main;
+  (void) tmp_dir;
+  assert(false);
+  return "";
+#endif
+}
 
-  return result;
+std::string
+Murxla::get_worker_tmp_dir(uint32_t worker) const
+{
+  if (d_options.num_jobs <= 1)
+  {
+    return d_tmp_dir;
+  }
+  std::filesystem::path p(d_tmp_dir);
+  p /= "worker-" + std::to_string(worker);
+  if (!std::filesystem::exists(p))
+  {
+    std::filesystem::create_directory(p);
+  }
+  return p.string();
 }
 
 std::string
@@ -838,7 +1729,7 @@ Murxla::filter_error(const std::string& err)
   for (const auto& re : d_error_filters)
   {
     std::smatch sm;
-    std::regex_search(err, sm, std::regex(re));
+    std::regex_search(err, sm, re);
     if (sm.size() == 1)
     {
       res = sm[0];
@@ -855,40 +1746,34 @@ Murxla::add_error(const std::string& err, uint64_t seed)
   std::string err_norm = normalize_asan_error(filtered_err);
 
   /* Filter errors if specified in the solver profile. */
-  for (const auto& e : d_exclude_errors)
+  for (const auto& re : d_exclude_error_regexes)
   {
-    std::smatch sm;
-    std::regex_search(filtered_err, sm, std::regex(e));
-    if (!sm.empty())
-    {
-      return std::make_tuple(ErrorKind::FILTER, filtered_err, 0, 0);
-    }
-
-    /* Errors are classified as the same error if they differ in at most 5% of
-     * characters. */
-    if (error_diff(err_norm, e) <= 0.05)
+    if (std::regex_search(filtered_err, re))
     {
       return std::make_tuple(ErrorKind::FILTER, filtered_err, 0, 0);
     }
   }
-
-  for (auto& p : *d_errors)
+  /* Errors are classified as the same error if they differ in at most 5% of
+   * characters. */
+  if (d_exclude_error_index.find(err_norm))
   {
-    const auto& e_norm = p.first;
-    auto& e_info       = p.second;
+    return std::make_tuple(ErrorKind::FILTER, filtered_err, 0, 0);
+  }
 
-    /* Errors are classified as the same error if they differ in at most 5% of
-     * characters. */
-    if (error_diff(err_norm, e_norm) <= 0.05)
-    {
-      e_info.seeds.push_back(seed);
-      return std::make_tuple(
-          ErrorKind::DUPLICATE, filtered_err, e_info.id, e_info.seeds.size());
-    }
+  if (const std::string* e_norm = d_error_index.find(err_norm))
+  {
+    auto& e_info = d_errors->at(*e_norm);
+    e_info.seeds.push_back(seed);
+    return std::make_tuple(
+        ErrorKind::DUPLICATE, filtered_err, e_info.id, e_info.seeds.size());
   }
 
-  d_errors->emplace(err_norm,
-                    ErrorInfo(d_errors->size() + 1, filtered_err, {seed}));
+  auto res = d_errors->emplace(
+      err_norm, ErrorInfo(d_errors->size() + 1, filtered_err, {seed}));
+  if (res.second)
+  {
+    d_error_index.add(err_norm);
+  }
 
   // Export errors to JSON file.
   if (!d_options.export_errors_filename.empty())
@@ -921,12 +1806,38 @@ Murxla::load_solver_profile()
     profile = SolverProfile::merge(profile, buf.str());
   }
 
+  /* Note: The solver profile is parsed once here, in the main process, and
+   *       shared with all forked test runs. */
   d_solver_profile.reset(new SolverProfile(profile));
-  auto errors = d_solver_profile->get_excluded_errors();
+  const auto& errors = d_solver_profile->get_excluded_errors();
   d_exclude_errors.insert(errors.begin(), errors.end());
-  auto error_filters = d_solver_profile->get_error_filters();
-  d_error_filters.insert(
-      d_error_filters.end(), error_filters.begin(), error_filters.end());
+  /* Regular expressions are compiled once here rather than per error. */
+  for (const auto& e : d_exclude_errors)
+  {
+    d_exclude_error_index.add(e);
+    try
+    {
+      d_exclude_error_regexes.emplace_back(e, std::regex::optimize);
+    }
+    catch (const std::regex_error&)
+    {
+      /* Excluded errors are not necessarily regular expressions (e.g., when
+       * exported via --export-errors), these are only matched by similarity. */
+    }
+  }
+  for (const auto& re : d_solver_profile->get_error_filters())
+  {
+    try
+    {
+      d_error_filters.emplace_back(re, std::regex::optimize);
+    }
+    catch (const std::regex_error& e)
+    {
+      MURXLA_EXIT_ERROR(true)
+          << "invalid error filter '" << re << "' in solver profile: "
+          << e.what();
+    }
+  }
 }
 
 std::string
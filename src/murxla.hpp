@@ -10,10 +10,14 @@
 #ifndef __MURXLA__MURXLA_H
 #define __MURXLA__MURXLA_H
 
+#include <sys/types.h>
+
 #include <cstdint>
+#include <regex>
 #include <string>
 
 #include "action.hpp"
+#include "error_index.hpp"
 #include "options.hpp"
 #include "result.hpp"
 #include "solver/solver_profile.hpp"
@@ -27,6 +31,9 @@ namespace murxla {
 namespace statistics {
 struct Statistics;
 };
+namespace smt2 {
+class Smt2Process;
+};
 class Solver;
 
 /* -------------------------------------------------------------------------- */
@@ -64,6 +71,8 @@ class Murxla
          SolverOptions* solver_options,
          ErrorMap* error_map,
          const std::string& tmp_dir);
+  /** Destructor. */
+  ~Murxla();
 
   /**
    * A single test run.
@@ -76,7 +85,7 @@ class Murxla
    *                      if 'run_forked' is false. Else, 'api_trace_file_name'
    *                      is set to the name of the temp trace file name and
    *                      its contents are copied to the final trace file in
-   *                      run(), after run_aux() is finished.
+   *                      finish_test_run(), after the run terminated.
    * untrace_file_name  : When non-empty, the name of the trace file to replay.
    * run_forked         : True if test run is executed in a child process.
    * record_stats       : True if statistics for this test run should be
@@ -96,9 +105,209 @@ class Murxla
              bool record_stats,
              TraceMode trace_mode);
 
-  /** Continuous test run. */
+  /**
+   * Continuous test run.
+   *
+   * Keeps up to Options::num_jobs forked test runs in flight at the same time.
+   * Each in-flight run is assigned to a worker with its own directory for
+   * temp files.
+   */
   void test();
 
+  /**
+   * A test run.
+   *
+   * Stores the configuration of a test run, and for test runs that are
+   * executed in a child process, the state of the child processes while the
+   * run is in flight.
+   */
+  struct TestRun
+  {
+    /** The seed for the RNG. */
+    uint64_t d_seed = 0;
+    /** The time limit for this test run. */
+    double d_time = 0;
+    /** The directory for the temp files of this test run. */
+    std::string d_tmp_dir;
+    /**
+     * The temp file to capture stdout of the child process in, if it can't be
+     * captured in memory.
+     */
+    std::string d_tmp_file_out;
+    /**
+     * The temp file to capture stderr of the child process in, if it can't be
+     * captured in memory.
+     */
+    std::string d_tmp_file_err;
+    /** The file to write stdout output of this test run to. */
+    std::string d_file_out;
+    /** The file to write stderr output of this test run to. */
+    std::string d_file_err;
+    /** The final API trace file (see run()). */
+    std::string d_api_trace_file_name;
+    /** The API trace file that is written to while the run is executed. */
+    std::string d_tmp_api_trace_file_name;
+    /** The name of the trace file to replay, empty if none. */
+    std::string d_untrace_file_name;
+    /** The trace mode of this run. */
+    TraceMode d_trace_mode = NONE;
+    /** True if this test run is executed in a child process. */
+    bool d_run_forked = false;
+    /** The pid of the child process executing the test run. */
+    pid_t d_pid_solver = 0;
+    /** The pidfd of the solver process, -1 if not available. */
+    int32_t d_pidfd = -1;
+    /**
+     * The point in time (monotonic clock, in seconds) at which the solver
+     * process is killed, 0 if the test run has no time limit.
+     */
+    double d_deadline = 0;
+    /** True if the test run terminated. */
+    bool d_done = false;
+    /** The result of the test run, only valid if d_done is true. */
+    Result d_result = RESULT_UNKNOWN;
+    /** The error message in case of a config or untrace error. */
+    std::string d_error_msg;
+    /** The file descriptor capturing stdout of the child process. */
+    int32_t d_fd_out = -1;
+    /** The file descriptor capturing stderr of the child process. */
+    int32_t d_fd_err = -1;
+    /** The captured stdout output, only valid if d_done is true. */
+    std::string d_out;
+    /** The captured stderr output, only valid if d_done is true. */
+    std::string d_err;
+    /**
+     * The persistent online solver process used by this test run, nullptr if
+     * none.
+     */
+    smt2::Smt2Process* d_smt2_process = nullptr;
+    /** The worker executing this test run, selects the statistics shard. */
+    uint32_t d_worker = 0;
+  };
+
+  /**
+   * Initialize a test run.
+   *
+   * seed               : The current seed for the RNG.
+   * double             : The time limit for one test run.
+   * tmp_dir            : The directory for temp files of this run.
+   * file_out           : The file to write stdout output of a test run to.
+   * file_err           : The file to write stderr output of a test run to.
+   * api_trace_file_name: The API trace file name (see run()).
+   * untrace_file_name  : When non-empty, the name of the trace file to replay.
+   * run_forked         : True if test run is executed in a child process.
+   * trace_mode         : The trace mode for this run.
+   */
+  TestRun new_test_run(uint64_t seed,
+                       double time,
+                       const std::string& tmp_dir,
+                       const std::string& file_out,
+                       const std::string& file_err,
+                       const std::string& api_trace_file_name,
+                       const std::string& untrace_file_name,
+                       bool run_forked,
+                       TraceMode trace_mode) const;
+
+  /**
+   * Start given test run.
+   *
+   * If the test run is executed forked, this forks the child process(es) and
+   * returns immediately. The test run is then registered as in flight until
+   * it is collected via wait_test_run(). Else, the test run is executed in
+   * the current process and marked as done.
+   *
+   * run         : The test run to start.
+   * record_stats: True if statistics for this test run should be
+   *               recorded. This should only be true for main test
+   *               runs, not for replayed runs or delta debugging runs.
+   */
+  void start_test_run(TestRun& run, bool record_stats);
+
+  /**
+   * Wait for any in-flight test run to terminate or to exceed its time limit,
+   * and record its result. Solver processes that exceed their time limit are
+   * killed. Returns false if there are no in-flight test runs.
+   */
+  bool wait_test_run();
+
+  /**
+   * Cancel given in-flight test run: kill its solver process and mark it as
+   * terminated with result RESULT_UNKNOWN.
+   */
+  void cancel_test_run(TestRun& run);
+
+  /**
+   * Finalize a terminated test run: copy output and trace files of the test
+   * run to their final destination.
+   *
+   * Returns the result of the test run.
+   */
+  Result finish_test_run(TestRun& run);
+
+  /**
+   * A snapshot of the state of a test run that replayed a prefix of a trace.
+   *
+   * A snapshot is a parked child process that, on request, forks test runs
+   * (or further snapshots) that continue replaying from its state. This is
+   * only supported on Linux, and not for solvers that run in a separate
+   * process (see supports_snapshots()).
+   */
+  struct Snapshot
+  {
+    /** The pid of the snapshot process. */
+    pid_t d_pid = 0;
+    /** The socket for sending requests to the snapshot process. */
+    int32_t d_fd = -1;
+  };
+
+  /** Return true if snapshots are supported for the configured solver. */
+  bool supports_snapshots() const;
+
+  /**
+   * Create a snapshot.
+   *
+   * snapshot         : The snapshot to initialize.
+   * seed             : The seed for the RNG.
+   * time             : The time limit for replaying the trace, 0 for none.
+   * tmp_dir          : The directory for temp files of the snapshot.
+   * untrace_file_name: The name of the trace file to replay.
+   * parent           : The snapshot to replay the trace on top of, nullptr
+   *                    to replay it from scratch.
+   *
+   * Returns false if the snapshot could not be created, e.g., because the
+   * trace triggers an error or exceeds the time limit.
+   */
+  bool new_snapshot(Snapshot& snapshot,
+                    uint64_t seed,
+                    double time,
+                    const std::string& tmp_dir,
+                    const std::string& untrace_file_name,
+                    const Snapshot* parent = nullptr);
+
+  /**
+   * Kill the process of given snapshot.
+   * Snapshots created on top of it must be deleted before.
+   */
+  void delete_snapshot(Snapshot& snapshot);
+
+  /**
+   * Start given test run from given snapshot.
+   *
+   * The test run is forked from the snapshot process and replays trace file
+   * 'd_untrace_file_name' of the run on top of the state of the snapshot.
+   * It is registered as in flight like any other forked test run (see
+   * start_test_run()).
+   *
+   * Returns false if the test run could not be started from the snapshot.
+   */
+  bool start_test_run(TestRun& run, const Snapshot& snapshot);
+
+  /**
+   * Get the directory for the temp files of given worker.
+   * Creates the directory if it does not exist yet.
+   */
+  std::string get_worker_tmp_dir(uint32_t worker) const;
+
   /** Print the current configuration of the FSM to stdout. */
   void print_fsm() const;
 
@@ -164,38 +373,56 @@ class Murxla
                  bool record_stats,
                  bool in_untrace_replay_mode) const;
 
+  /** Register given test run as in flight with given solver process. */
+  void register_test_run(TestRun& run, pid_t pid_solver);
+
   /**
-   * Auxiliary helper for run().
-   * Forks in case that we run forked (continuous testing, delta debugging).
+   * Serve the requests to a snapshot process that are received via socket
+   * 'fd' (see Snapshot).
    *
-   * seed               : The current seed for the RNG.
-   * double             : The time limit for one test run.
-   * file_out           : The file to write stdout output of a test run to.
-   * file_err           : The file to write stderr output of a test run to.
-   * api_trace_file_name: When non-empty, trace is immediately written to file
-   *                      if 'run_forked' is false. Else, 'api_trace_file_name'
-   *                      is set to the name of the temp trace file name and
-   *                      its contents are copied to the final trace file in
-   *                      run(), after run_aux() is finished.
-   * untrace_file_name  : When non-empty, the name of the trace file to replay.
-   * run_forked         : True if test run is executed in a child process.
-   * record_stats       : True if statistics for this test run should be
-   *                      recorded. This should only be true for main test
-   *                      runs, not for replayed runs or delta debugging runs.
-   * trace_mode         : The trace mode for this run.
+   * Only returns in test runs forked from the snapshot, with the name of the
+   * trace file to replay.
    *
-   * Returns a result that indicates the status of the test run.
+   * fsm     : The FSM of the snapshot process.
+   * fd      : The socket for receiving requests.
+   * pid_main: The pid of the main process.
+   * tmp_dir : The directory for temp files.
    */
-  Result run_aux(uint64_t seed,
-                 double time,
-                 const std::string& file_out,
-                 const std::string& file_err,
-                 std::string& api_trace_file_name,
-                 const std::string& untrace_file_name,
-                 bool run_forked,
-                 bool record_stats,
-                 TraceMode trace_mode,
-                 std::string& error_msg);
+  std::string serve_snapshot(FSM& fsm,
+                             int32_t fd,
+                             pid_t pid_main,
+                             const std::string& tmp_dir);
+
+  /**
+   * Register the solver process of given test run for being watched in
+   * wait_solver_processes().
+   *
+   * On Linux, solver processes are watched via pidfds and time limits are
+   * enforced via a timerfd, both in one epoll instance. If this is not
+   * supported, wait_solver_processes() falls back to polling.
+   */
+  void watch_solver_process(TestRun& run);
+
+  /**
+   * Block until a watched solver process terminates or the given deadline
+   * (monotonic clock, 0 for none) is reached.
+   */
+  void wait_solver_processes(double deadline);
+
+  /** Record the result of the terminated solver process of given run. */
+  void collect_solver_process(TestRun& run, int32_t status);
+
+  /**
+   * Kill the solver process of given test run and mark the run as terminated
+   * with given result (RESULT_TIMEOUT if it exceeded its time limit).
+   */
+  void kill_solver_process(TestRun& run, Result result);
+
+  /** Mark given test run as terminated with given result. */
+  void unregister_test_run(TestRun& run, Result result);
+
+  /** Close the epoll and timer file descriptors and disable their use. */
+  void close_event_fds();
 
   /**
    * Replay a single test run.
@@ -235,13 +462,46 @@ class Murxla
   /** Map normalized error message to pair (original error message, seeds). */
   ErrorMap* d_errors;
 
+  /** Index of the normalized errors in d_errors, for finding duplicates. */
+  ErrorIndex d_error_index;
+
+  /** The errors to exclude, as specified in the solver profile. */
   std::unordered_set<std::string> d_exclude_errors;
-  std::vector<std::string> d_error_filters;
+  /** Index of d_exclude_errors, for matching errors by similarity. */
+  ErrorIndex d_exclude_error_index;
+  /** The compiled regular expressions of d_exclude_errors. */
+  std::vector<std::regex> d_exclude_error_regexes;
+  /** The compiled error filter regular expressions of the solver profile. */
+  std::vector<std::regex> d_error_filters;
 
   std::unique_ptr<SolverProfile> d_solver_profile;
 
   /** Stores error messages to be exported when --export-errors is enabled. */
   std::vector<std::string> d_export_errors;
+
+  /** Map pids of solver processes of in-flight test runs to their run. */
+  std::unordered_map<pid_t, TestRun*> d_pid_to_test_run;
+  /** The epoll instance for watching solver processes, -1 if not used. */
+  int32_t d_epoll_fd = -1;
+  /** The timer for enforcing time limits of test runs, -1 if not used. */
+  int32_t d_timer_fd = -1;
+  /** True if watching solver processes via epoll is not supported. */
+  bool d_epoll_unavailable = false;
+  /**
+   * The number of snapshots, this process is a child subreaper while there
+   * are snapshots.
+   */
+  uint32_t d_num_snapshots = 0;
+  /**
+   * The persistent online solver processes of the workers in continuous mode,
+   * see Options::smt2_persistent.
+   */
+  std::vector<smt2::Smt2Process> d_smt2_processes;
+  /**
+   * The persistent online solver process to be used by the SMT2 solver
+   * created in new_solver(), nullptr if none.
+   */
+  smt2::Smt2Process* d_smt2_process = nullptr;
 };
 
 /* -------------------------------------------------------------------------- */
@@ -80,8 +80,12 @@ Op::get_arg_sort_kind(size_t i) const
 Op&
 OpKindManager::get_op(const Op::Kind& kind)
 {
-  if (d_op_kinds.find(kind) == d_op_kinds.end()) return d_op_undefined;
-  return d_op_kinds.at(kind);
+  KindRegistry::Id id = kind.get_id();
+  if (id >= d_op_kinds_by_id.size() || d_op_kinds_by_id[id] == nullptr)
+  {
+    return d_op_undefined;
+  }
+  return *d_op_kinds_by_id[id];
 }
 
 void
@@ -495,8 +499,13 @@ OpKindManager::add_op_kind(const Op::Kind& kind,
     }
     sort_kinds_args.push_back(sk);
   }
-  d_op_kinds.emplace(
+  auto res = d_op_kinds.emplace(
       kind, Op(id, kind, arity, nidxs, sort_kinds, sort_kinds_args, theory));
+  if (kind.get_id() >= d_op_kinds_by_id.size())
+  {
+    d_op_kinds_by_id.resize(kind.get_id() + 1, nullptr);
+  }
+  d_op_kinds_by_id[kind.get_id()] = &res.first->second;
   strncpy(d_stats->d_op_kinds[id], kind.c_str(), kind.size());
 }
 
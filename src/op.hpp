@@ -15,6 +15,8 @@
 #include <unordered_map>
 #include <vector>
 
+#include "indexed_set.hpp"
+#include "kind_registry.hpp"
 #include "sort.hpp"
 
 namespace murxla {
@@ -29,7 +31,7 @@ struct Statistics;
 struct Op
 {
   /** The kind of an operator. */
-  using Kind = std::string;
+  using Kind = InternedKind;
 
   /**
    * \addtogroup operator-kinds
@@ -3281,7 +3283,7 @@ struct Op
   /** The operator id, assigned in the order operators have been created. */
   uint64_t d_id = 0u;
   /** The operator kind. */
-  const Kind& d_kind = UNDEFINED;
+  const Kind d_kind = UNDEFINED;
   /**
    * The arity (number of arguments) of this operator kind.
    *
@@ -3318,8 +3320,8 @@ struct Op
 using OpKindVector = std::vector<Op::Kind>;
 /** A std::unordered_set of operator kinds. */
 using OpKindSet    = std::unordered_set<Op::Kind>;
-/** A std::unordered_map mapping operator kind to operator. */
-using OpKindMap    = std::unordered_map<Op::Kind, Op>;
+/** An IndexedMap mapping operator kind to operator. */
+using OpKindMap    = IndexedMap<Op::Kind, Op>;
 /**
  * A std::unordered_map mapping sort kind of an operator to operator kinds of
  * that sort kind.
@@ -3413,6 +3415,11 @@ class OpKindManager
 
   /** The set of enabled operator kinds. Maps Op::Kind to Op. */
   OpKindMap d_op_kinds;
+  /**
+   * Maps the id of an operator kind (see InternedKind::get_id()) to its entry
+   * in d_op_kinds, nullptr if the operator kind is not enabled.
+   */
+  std::vector<Op*> d_op_kinds_by_id;
   /** The set of enabled theories. */
   TheorySet d_enabled_theories;
   /** Enabled sort kinds. */
@@ -35,6 +35,11 @@ struct Options
   double time = 1;
   /** The maximum number of test runs to perform. */
   uint32_t max_runs = 0;
+  /**
+   * The number of test runs to execute in parallel in continuous mode and
+   * when delta debugging.
+   */
+  uint32_t num_jobs = 1;
 
   /** True if seed is provided by user. */
   bool is_seeded = false;
@@ -42,6 +47,13 @@ struct Options
   bool simple_symbols = true;
   /** True to only generate SMT-LIB compliant API traces. */
   bool smtlib_compliant = false;
+  /**
+   * True to pick FSM actions and terms via std::discrete_distribution rather
+   * than a WeightedSampler, operator kinds without the operator kind index of
+   * the SolverManager, and random strings one character at a time, to
+   * reproduce runs of earlier versions.
+   */
+  bool compat_sampling = false;
   /** True to print statistics. */
   bool print_stats = false;
   /** True to print FSM configuration. */
@@ -61,10 +73,34 @@ struct Options
   SolverKind solver;
   /** The path to the solver binary to test when --smt2 is enabled. */
   std::string solver_binary;
+  /**
+   * True to pipeline commands to the solver binary given via --smt2, i.e.,
+   * to check 'success' responses asynchronously.
+   */
+  bool smt2_pipelined = false;
+  /**
+   * True to reuse one process of the solver binary given via --smt2 per
+   * worker across test runs in continuous mode, rather than starting a new
+   * process for each test run.
+   */
+  bool smt2_persistent = false;
   /** The file to trace the API call sequence to. */
   std::string api_trace_file_name;
+  /** Write API trace files in the compact binary trace format. */
+  bool binary_trace = false;
+  /**
+   * Buffer API trace and SMT2 file output in memory rather than flushing it
+   * after each traced statement. The buffers are written when full, before
+   * check-sat calls, at exit and when crashing.
+   */
+  bool buffer_trace = false;
   /** The API trace file to replay. */
   std::string untrace_file_name;
+  /**
+   * The file to write the trace given via untrace_file_name to, converted
+   * from text to binary format or vice versa.
+   */
+  std::string convert_trace_file_name;
   /** The file to dump the SMT-LIB2 representation of the current trace to. */
   std::string smt2_file_name;
 
@@ -90,11 +126,21 @@ struct Options
    * matching against the whole stderr output) when delta debugging.
    */
   std::string dd_match_err;
+  /**
+   * Replay trace prefixes that are shared between delta debugging tests only
+   * once, and fork the tests from snapshots of the replayed prefixes.
+   */
+  bool dd_share_prefix = false;
   /** The file to write the reduced API trace to. */
   std::string dd_trace_file_name;
 
   /** The name of the solver to cross-check given solver with. */
   std::string cross_check;
+  /**
+   * True to run the satisfiability checks of the solver and the cross-check
+   * solver concurrently.
+   */
+  bool cross_check_concurrent = false;
 
   /** The name of the solver to use for checking. */
   std::string check_solver_name;
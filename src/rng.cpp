@@ -51,21 +51,129 @@ SeedGenerator::next()
 
 /* -------------------------------------------------------------------------- */
 
-RNGenerator::RNGenerator(uint64_t seed) : d_seed(seed)
+void
+WeightedSampler::clear()
 {
-  d_rng.seed(seed);
+  d_weights.clear();
+  d_tree.assign(1, 0);
+}
 
-  /* generate set of printable characters */
-  uint32_t i = 32;
-  for (; i < 256; ++i)
+void
+WeightedSampler::push_back(uint64_t weight)
+{
+  d_weights.push_back(weight);
+  size_t n = d_weights.size();
+  /* node n holds the sum of the weights in [n - lowbit(n), n) */
+  d_tree.push_back(weight + sum(n - 1) - sum(n - (n & -n)));
+}
+
+void
+WeightedSampler::shrink(size_t size)
+{
+  assert(size <= d_weights.size());
+  /* the nodes up to 'size' only cover weights in [0, size) */
+  d_weights.resize(size);
+  d_tree.resize(size + 1);
+}
+
+void
+WeightedSampler::set(size_t idx, uint64_t weight)
+{
+  assert(idx < d_weights.size());
+  /* computed modulo 2^64, the sums are exact since they do not overflow */
+  uint64_t delta = weight - d_weights[idx];
+  d_weights[idx] = weight;
+  for (size_t i = idx + 1, n = d_weights.size(); i <= n; i += i & -i)
+  {
+    d_tree[i] += delta;
+  }
+}
+
+uint64_t
+WeightedSampler::sum(size_t end) const
+{
+  assert(end <= d_weights.size());
+  uint64_t res = 0;
+  for (size_t i = end; i > 0; i -= i & -i)
+  {
+    res += d_tree[i];
+  }
+  return res;
+}
+
+size_t
+WeightedSampler::find(uint64_t value) const
+{
+  assert(value < sum(d_weights.size()));
+  size_t n = d_weights.size(), pos = 0, step = 1;
+  while (step <= n / 2) step <<= 1;
+  for (; step > 0; step >>= 1)
+  {
+    if (pos + step <= n && d_tree[pos + step] <= value)
+    {
+      pos += step;
+      value -= d_tree[pos];
+    }
+  }
+  assert(pos < n);
+  return pos;
+}
+
+/* -------------------------------------------------------------------------- */
+
+CharSet::CharSet(const std::string& chars) : d_chars(chars)
+{
+  assert(!d_chars.empty());
+  uint64_t size = d_chars.size();
+  if ((size & (size - 1)) == 0)
+  {
+    /* power of two: log2(size) bits per character, no bias */
+    uint32_t bits = 0;
+    while ((uint64_t(1) << bits) < size) ++bits;
+    d_chars_per_draw = bits == 0 ? 64 : 64 / bits;
+  }
+  else
+  {
+    /* size^n <= 2^48, at least 16 bits of the draw remain unused */
+    d_chars_per_draw = 0;
+    for (uint64_t p = size; p <= (uint64_t(1) << 48); p *= size)
+    {
+      d_chars_per_draw += 1;
+    }
+  }
+  assert(d_chars_per_draw > 0);
+}
+
+/* -------------------------------------------------------------------------- */
+
+namespace {
+/** @return The set of printable characters: 32-126 and 128-255 (decimal). */
+std::string
+printable_chars()
+{
+  std::string res;
+  for (uint32_t i = 32; i < 256; ++i)
   {
     // Skip characters not allowed in SMT2 symbols
     if (i == '|' || i == '\\' || i == 127) continue;
-    d_printable_chars.push_back(static_cast<char>(i));
+    res.push_back(static_cast<char>(i));
   }
+  return res;
+}
+}  // namespace
+
+/* -------------------------------------------------------------------------- */
+
+RNGenerator::RNGenerator(uint64_t seed)
+    : d_seed(seed), d_printable_char_set(printable_chars())
+{
+  d_rng.seed(seed);
+
+  d_printable_chars.assign(d_printable_char_set.str().begin(),
+                           d_printable_char_set.str().end());
 
   /* A-F */
-  i = 65;
+  uint32_t i = 65;
   std::generate_n(std::back_inserter(d_hex_chars), 6, [&i]() { return i++; });
   /* a-f */
   i = 97;
@@ -82,6 +190,21 @@ RNGenerator::reseed(uint64_t seed)
   d_seed = seed;
 }
 
+size_t
+RNGenerator::pick_weighted(const WeightedSampler& sampler,
+                           size_t begin,
+                           size_t end)
+{
+  assert(begin < end);
+  assert(end <= sampler.size());
+  uint64_t offset = sampler.sum(begin);
+  uint64_t total  = sampler.sum(end) - offset;
+  assert(total > 0);
+  size_t res = sampler.find(offset + pick<uint64_t>(0, total - 1));
+  assert(res >= begin && res < end);
+  return res;
+}
+
 bool
 RNGenerator::pick_with_prob(uint32_t prob)
 {
@@ -132,30 +255,76 @@ RNGenerator::pick_one_of_five()
 std::string
 RNGenerator::pick_string(uint32_t len)
 {
-  if (len == 0) return "";
-  std::string str(len, 0);
-  std::generate_n(str.begin(), len, [this]() {
-    return pick_from_set<std::vector<char>, char>(d_printable_chars);
-  });
-  return str;
+  std::string res;
+  pick_string(len, res);
+  return res;
 }
 
 std::string
 RNGenerator::pick_string(std::string& chars, uint32_t len)
 {
-  assert(chars.size());
-  if (len == 0) return "";
-  std::string str(len, 0);
-  std::generate_n(str.begin(), len, [this, &chars]() {
-    return chars[pick<size_t>(0, chars.size() - 1)];
-  });
-  return str;
+  std::string res;
+  pick_string(CharSet(chars), len, res);
+  return res;
 }
 
 std::string
 RNGenerator::pick_bin_string(uint32_t len)
 {
-  return pick_string(d_bin_char_set, len);
+  std::string res;
+  pick_bin_string(len, res);
+  return res;
+}
+
+void
+RNGenerator::pick_string(uint32_t len, std::string& res)
+{
+  if (d_compat_sampling)
+  {
+    for (uint32_t i = 0; i < len; ++i)
+    {
+      res.push_back(pick_from_set<std::vector<char>, char>(d_printable_chars));
+    }
+    return;
+  }
+  pick_string(d_printable_char_set, len, res);
+}
+
+void
+RNGenerator::pick_string(const CharSet& chars, uint32_t len, std::string& res)
+{
+  size_t pos = res.size();
+  res.resize(pos + len);
+  uint64_t size = chars.size();
+
+  if (d_compat_sampling)
+  {
+    for (; pos < res.size(); ++pos)
+    {
+      res[pos] = chars[pick<size_t>(0, size - 1)];
+    }
+    return;
+  }
+
+  uint32_t per_draw = chars.chars_per_draw();
+  while (pos < res.size())
+  {
+    /* extract the digits of the fraction draw / 2^64 in base 'size' */
+    uint64_t draw = d_rng();
+    size_t n      = std::min<size_t>(per_draw, res.size() - pos);
+    for (size_t i = 0; i < n; ++i)
+    {
+      unsigned __int128 p = static_cast<unsigned __int128>(draw) * size;
+      res[pos++]          = chars[static_cast<uint64_t>(p >> 64)];
+      draw                = static_cast<uint64_t>(p);
+    }
+  }
+}
+
+void
+RNGenerator::pick_bin_string(uint32_t len, std::string& res)
+{
+  pick_string(d_bin_char_set, len, res);
 }
 
 std::string
@@ -208,48 +377,57 @@ RNGenerator::pick_hex_bin_string(uint32_t bin_len)
 std::string
 RNGenerator::pick_dec_int_string(uint32_t len)
 {
-  assert(len);
   std::string res;
-  if (len > 1)
-  {
-    // numeral may not start with 0 if len > 1
-    std::stringstream ss;
-    ss << pick_from_set<std::vector<char>, char>(
-        {'1', '2', '3', '4', '5', '6', '7', '8', '9'});
-    std::string str(len - 1, 0);
-    std::generate_n(str.begin(), len - 1, [this]() {
-      return pick_from_set<std::vector<char>, char>(
-          {'0', '1', '2', '3', '4', '5', '6', '7', '8', '9'});
-    });
-    ss << str;
-    res = ss.str();
-  }
-  else
+  pick_dec_int_string(len, res);
+  return res;
+}
+
+void
+RNGenerator::pick_dec_int_string(uint32_t len, std::string& res)
+{
+  assert(len);
+  // numeral may not start with 0 if len > 1, and is never 0 if len == 1
+  if (d_compat_sampling)
   {
-    res = std::string(len, 0);
-    std::generate_n(res.begin(), len, [this]() {
-      return pick_from_set<std::vector<char>, char>(
-          {'1', '2', '3', '4', '5', '6', '7', '8', '9'});
-    });
+    res.push_back(
+        pick_from_set<std::string, char>(d_dec_nonzero_char_set.str()));
+    for (uint32_t i = 1; i < len; ++i)
+    {
+      res.push_back(pick_from_set<std::string, char>(d_dec_char_set.str()));
+    }
+    return;
   }
-  return res;
+  pick_string(d_dec_nonzero_char_set, 1, res);
+  pick_string(d_dec_char_set, len - 1, res);
 }
 
 std::string
 RNGenerator::pick_dec_real_string(uint32_t len)
+{
+  std::string res;
+  pick_dec_real_string(len, res);
+  return res;
+}
+
+void
+RNGenerator::pick_dec_real_string(uint32_t len, std::string& res)
 {
   assert(len);
   if (len < 3)
   {
-    return pick_dec_int_string(len);
+    pick_dec_int_string(len, res);
+    return;
   }
   uint32_t len0 = pick<uint32_t>(1, len);
-  if (len0 > len - 2) return pick_dec_int_string(len);
+  if (len0 > len - 2)
+  {
+    pick_dec_int_string(len, res);
+    return;
+  }
   uint32_t len1 = len - len0 - 1;
-  std::stringstream ss;
-  ss << pick_dec_int_string(len0) << "." << pick_dec_int_string(len1);
-  assert(ss.str().size() == len);
-  return ss.str();
+  pick_dec_int_string(len0, res);
+  res.push_back('.');
+  pick_dec_int_string(len1, res);
 }
 
 std::string
@@ -257,32 +435,26 @@ RNGenerator::pick_dec_rational_string(uint32_t nlen, uint32_t dlen)
 {
   assert(nlen);
   assert(dlen);
-  std::string num;
-  std::string den;
-
-  if (nlen > 1)
-  {
-    num = pick_dec_int_string(nlen);
-  }
-  else
+  std::string res;
+  // numerator may not be 0
+  pick_dec_int_string(nlen, res);
+  res.push_back('/');
+  if (dlen > 1)
   {
-    // numerator may not be 0
-    num = pick_from_set<std::vector<char>, char>(
-        {'1', '2', '3', '4', '5', '6', '7', '8', '9'});
+    pick_dec_int_string(dlen, res);
   }
-  if (dlen > 1)
+  else if (d_compat_sampling)
   {
-    den = pick_dec_int_string(dlen);
+    // denominator must be > 1
+    res.push_back(
+        pick_from_set<std::string, char>(d_dec_gt_one_char_set.str()));
   }
   else
   {
     // denominator must be > 1
-    den = pick_from_set<std::vector<char>, char>(
-        {'2', '3', '4', '5', '6', '7', '8', '9'});
+    pick_string(d_dec_gt_one_char_set, 1, res);
   }
-  std::stringstream ss;
-  ss << num << "/" << den;
-  return ss.str();
+  return res;
 }
 
 std::string
@@ -298,8 +470,9 @@ RNGenerator::pick_real_string()
 std::string
 RNGenerator::pick_simple_symbol(uint32_t len)
 {
-  std::string s = pick_string(d_simple_symbol_char_set, len);
-  return s;
+  std::string res;
+  pick_string(d_simple_symbol_char_set, len, res);
+  return res;
 }
 
 std::string
@@ -378,10 +551,11 @@ RNGenerator::pick_string_literal(uint32_t len)
   std::vector<std::string> chars;
 
   // pick ASCII chars
-  for (uint32_t i = 0; i < len_ascii; ++i)
+  std::string ascii;
+  pick_string(len_ascii, ascii);
+  for (char c : ascii)
   {
-    chars.push_back(std::string(
-        1, pick_from_set<std::vector<char>, char>(d_printable_chars)));
+    chars.push_back(std::string(1, c));
   }
 
   // pick escaped unicode chars
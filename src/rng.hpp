@@ -13,9 +13,12 @@
 #include <cassert>
 #include <cstdint>
 #include <random>
+#include <string>
 #include <unordered_map>
 #include <vector>
 
+#include "indexed_set.hpp"
+
 namespace murxla {
 
 /* -------------------------------------------------------------------------- */
@@ -41,6 +44,117 @@ class SeedGenerator
 
 /* -------------------------------------------------------------------------- */
 
+/**
+ * A Fenwick tree (binary indexed tree) over non-negative integer weights, for
+ * weighted sampling in O(log n) via RNGenerator::pick_weighted().
+ *
+ * Weights can be updated and appended in O(log n), and the tree is built from
+ * a weight vector in O(n). In contrast to std::discrete_distribution, which
+ * requires O(n) to set up for every pick, a sampler is kept alive across
+ * picks and only updated incrementally.
+ */
+class WeightedSampler
+{
+ public:
+  /** @return The number of weights. */
+  size_t size() const { return d_weights.size(); }
+  /** @return True if the sampler does not hold any weights. */
+  bool empty() const { return d_weights.empty(); }
+  /** Remove all weights. */
+  void clear();
+
+  /**
+   * Replace all weights with the weights in the given range, in O(n).
+   * @param begin The begin of the weights.
+   * @param end   The end of the weights.
+   */
+  template <typename Iterator>
+  void assign(const Iterator& begin, const Iterator& end);
+  /**
+   * Append a weight, in O(log n).
+   * @param weight The weight.
+   */
+  void push_back(uint64_t weight);
+  /**
+   * Shrink to the given number of weights, in O(1).
+   * @param size The new number of weights, must not be larger than size().
+   */
+  void shrink(size_t size);
+
+  /**
+   * Get weight.
+   * @param idx The index of the weight.
+   * @return The weight at index 'idx'.
+   */
+  uint64_t get(size_t idx) const { return d_weights[idx]; }
+  /**
+   * Update weight, in O(log n).
+   * @param idx    The index of the weight.
+   * @param weight The new weight.
+   */
+  void set(size_t idx, uint64_t weight);
+
+  /**
+   * Get the sum of the first weights, in O(log n).
+   * @param end The number of weights to sum up.
+   * @return The sum of the weights in [0, end).
+   */
+  uint64_t sum(size_t end) const;
+  /**
+   * Find the index at which the prefix sum of the weights exceeds the given
+   * value, in O(log n).
+   * @param value A value less than sum(size()).
+   * @return The smallest index 'idx' with sum(idx + 1) > value.
+   */
+  size_t find(uint64_t value) const;
+
+ private:
+  /** The weights. */
+  std::vector<uint64_t> d_weights;
+  /**
+   * The Fenwick tree, 1-based. Node i holds the sum of the weights in
+   * [i - lowbit(i), i).
+   */
+  std::vector<uint64_t> d_tree = {0};
+};
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * A character set for batched random string generation.
+ *
+ * Each 64-bit output of the RNG engine is interpreted as a fixed-point
+ * fraction in [0, 1), and consecutive characters are extracted as its digits
+ * in base size() (multiply by size(), take the integer part, continue with
+ * the fractional part). This requires no rejection sampling. For sets of
+ * power-of-two size, characters are picked uniformly. For other sizes, the
+ * number of characters per draw is limited such that at least 16 bits of the
+ * draw remain unused, which keeps the bias below 2^-16.
+ */
+class CharSet
+{
+ public:
+  /** Constructor. */
+  CharSet(const std::string& chars);
+
+  /** @return The characters of this set. */
+  const std::string& str() const { return d_chars; }
+  /** @return The number of characters in this set. */
+  uint32_t size() const { return static_cast<uint32_t>(d_chars.size()); }
+  /** @return The character at the given index. */
+  char operator[](size_t idx) const { return d_chars[idx]; }
+  /** @return The number of characters extracted from one 64-bit draw. */
+  uint32_t chars_per_draw() const { return d_chars_per_draw; }
+
+ private:
+  /** The characters. */
+  std::string d_chars;
+  /** The number of characters extracted from one 64-bit draw. */
+  uint32_t d_chars_per_draw;
+};
+
+/* -------------------------------------------------------------------------- */
+
 class RNGenerator
 {
  public:
@@ -118,6 +232,26 @@ class RNGenerator
 
   template <typename T, typename Iterator>
   T pick_weighted(const Iterator& begin, const Iterator& end);
+  /**
+   * Pick index between 'begin' and 'end' (exclusive), weighted by the weights
+   * of the given sampler. The probability to pick each index is w/S with w
+   * its weight and S the sum of all weights in the range, which must not be
+   * zero.
+   */
+  size_t pick_weighted(const WeightedSampler& sampler,
+                       size_t begin,
+                       size_t end);
+
+  /**
+   * Determine if weighted picks from the FSM states and the term database use
+   * std::discrete_distribution rather than a WeightedSampler, operator kinds
+   * are picked without the operator kind index of the SolverManager, and
+   * random strings are picked one character per draw of the RNG engine.
+   * This is slower, but reproduces runs of earlier versions seed for seed.
+   */
+  bool is_compat_sampling() const { return d_compat_sampling; }
+  /** Enable or disable compatibility mode for weighted picks. */
+  void set_compat_sampling(bool value) { d_compat_sampling = value; }
 
   /** Pick with given probability, 100% = 1000. */
   bool pick_with_prob(uint32_t prob);
@@ -136,6 +270,29 @@ class RNGenerator
   std::string pick_string(std::string& chars, uint32_t len);
   /** Pick binary string of given length. */
   std::string pick_bin_string(uint32_t len);
+  /**
+   * Pick random string of given length from the set of printable chars and
+   * append it to the given buffer.
+   */
+  void pick_string(uint32_t len, std::string& res);
+  /**
+   * Pick random string of given length from given character set and append
+   * it to the given buffer. Multiple characters are extracted from each draw
+   * of the RNG engine (see CharSet).
+   */
+  void pick_string(const CharSet& chars, uint32_t len, std::string& res);
+  /** Pick binary string of given length and append it to the given buffer. */
+  void pick_bin_string(uint32_t len, std::string& res);
+  /**
+   * Pick decimal integer string of given length and append it to the given
+   * buffer.
+   */
+  void pick_dec_int_string(uint32_t len, std::string& res);
+  /**
+   * Pick decimal real string of given length (no rationals) and append it to
+   * the given buffer.
+   */
+  void pick_dec_real_string(uint32_t len, std::string& res);
   /**
    * Pick decimal string of given length in binary representation.
    * This will produce signed (that is, possibly negative) values if
@@ -164,25 +321,42 @@ class RNGenerator
   /** Pick string literal (theory of strings) */
   std::string pick_string_literal(uint32_t len);
 
-  /* Pick random element from given map. */
+  /*
+   * Pick random element from given map.
+   * Constant time for IndexedMap, linear in the size of the map otherwise.
+   */
   template <typename TMap, typename TPicked>
   TPicked pick_from_map(const TMap& data);
-  /* Pick random element from given set/vector. */
+  /*
+   * Pick random element from given set/vector.
+   * Constant time for IndexedSet and vectors, linear in the size of the set
+   * otherwise.
+   */
   template <typename TSet, typename TPicked>
   TPicked pick_from_set(const TSet& data);
 
  private:
   uint64_t d_seed;
   std::mt19937_64 d_rng;
+  /** True if compatibility mode for weighted picks is enabled. */
+  bool d_compat_sampling = false;
 
   /** The character set for binary strings. */
-  std::string d_bin_char_set = "01";
+  CharSet d_bin_char_set = CharSet("01");
+  /** The character set for decimal digits. */
+  CharSet d_dec_char_set = CharSet("0123456789");
+  /** The character set for non-zero decimal digits. */
+  CharSet d_dec_nonzero_char_set = CharSet("123456789");
+  /** The character set for decimal digits greater than one. */
+  CharSet d_dec_gt_one_char_set = CharSet("23456789");
   /** The character set for (non-piped) symbol strings. */
-  std::string d_simple_symbol_char_set =
+  CharSet d_simple_symbol_char_set = CharSet(
       "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz+-/"
-      "*=%?!.$_&<>@^~";
+      "*=%?!.$_&<>@^~");
   /** The set of printable characters: 32-126 and 128-255 (decimal). */
   std::vector<char> d_printable_chars;
+  /** The character set of printable characters, see d_printable_chars. */
+  CharSet d_printable_char_set;
   /** The set of hexadecimal characters */
   std::vector<char> d_hex_chars;
 };
@@ -192,6 +366,9 @@ class RNGenerator
 /**
  * The seed generator for seeds for the RNG of the solver.
  * We cannot use SeedGenerator here since it is non-deterministic.
+ *
+ * The RNGs of solvers created with this generator inherit its compatibility
+ * mode (see is_compat_sampling()).
  */
 class SolverSeedGenerator : public RNGenerator
 {
@@ -222,11 +399,40 @@ class SolverSeedGenerator : public RNGenerator
 
 /* -------------------------------------------------------------------------- */
 
+template <typename Iterator>
+void
+WeightedSampler::assign(const Iterator& begin, const Iterator& end)
+{
+  d_weights.assign(begin, end);
+  size_t n = d_weights.size();
+  d_tree.assign(n + 1, 0);
+  for (size_t i = 1; i <= n; ++i)
+  {
+    d_tree[i] += d_weights[i - 1];
+    size_t parent = i + (i & -i);
+    if (parent <= n)
+    {
+      d_tree[parent] += d_tree[i];
+    }
+  }
+}
+
+/* -------------------------------------------------------------------------- */
+
 template <typename TMap, typename TPicked>
 TPicked
 RNGenerator::pick_from_map(const TMap& map)
 {
   assert(!map.empty());
+  if constexpr (is_indexed<std::remove_const_t<TMap>>::value)
+  {
+    /* In compatibility mode, pick in iteration order as for unordered maps
+     * (see IndexedOrder). */
+    if (!d_compat_sampling)
+    {
+      return map.get(pick<uint32_t>() % map.size()).first;
+    }
+  }
   auto it = map.begin();
   std::advance(it, pick<uint32_t>() % map.size());
   return it->first;
@@ -237,6 +443,15 @@ TPicked
 RNGenerator::pick_from_set(const TSet& set)
 {
   assert(!set.empty());
+  if constexpr (is_indexed<std::remove_const_t<TSet>>::value)
+  {
+    /* In compatibility mode, pick in iteration order as for unordered sets
+     * (see IndexedOrder). */
+    if (!d_compat_sampling)
+    {
+      return set.get(pick<uint32_t>() % set.size());
+    }
+  }
   auto it = set.begin();
   std::advance(it, pick<uint32_t>() % set.size());
   return *it;
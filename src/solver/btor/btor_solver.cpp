@@ -436,6 +436,12 @@ BtorSolver::get_profile() const
   return s_profile;
 }
 
+bool
+BtorSolver::is_thread_safe() const
+{
+  return true;
+}
+
 Sort
 BtorSolver::mk_sort(SortKind kind)
 {
@@ -845,6 +845,12 @@ BzlaSolver::get_profile() const
   return s_profile;
 }
 
+bool
+BzlaSolver::is_thread_safe() const
+{
+  return true;
+}
+
 Sort
 BzlaSolver::mk_sort(SortKind kind)
 {
@@ -172,6 +172,7 @@ class BzlaSolver : public Solver
   const std::string get_name() const override;
 
   const std::string get_profile() const override;
+  bool is_thread_safe() const override;
 
   void configure_fsm(FSM* fsm) const override;
   void disable_unsupported_actions(FSM* fsm) const override;
@@ -9,6 +9,8 @@
  */
 #include "solver/meta/shadow_solver.hpp"
 
+#include <future>
+
 #include "solver/solver_profile.hpp"
 
 namespace murxla {
@@ -24,7 +26,7 @@ ShadowSort::~ShadowSort() {}
 size_t
 ShadowSort::hash() const
 {
-  return d_sort->hash();
+  return d_sort->get_hash();
 }
 
 bool
@@ -355,7 +357,7 @@ ShadowTerm::~ShadowTerm() {}
 size_t
 ShadowTerm::hash() const
 {
-  return d_term->hash() + d_term_shadow->hash();
+  return d_term->get_hash() + d_term_shadow->get_hash();
 }
 bool
 ShadowTerm::equals(const Term& other) const
@@ -536,11 +538,15 @@ ShadowTerm::set_leaf_kind(LeafKind kind)
 
 ShadowSolver::ShadowSolver(SolverSeedGenerator& sng,
                            Solver* solver,
-                           Solver* solver_shadow)
+                           Solver* solver_shadow,
+                           bool concurrent)
     : Solver(sng),
       d_solver(solver),
       d_solver_shadow(solver_shadow),
-      d_same_solver(solver->get_name() == solver_shadow->get_name()){};
+      d_same_solver(solver->get_name() == solver_shadow->get_name()),
+      d_concurrent(concurrent
+                   && (solver->is_thread_safe()
+                       || solver_shadow->is_thread_safe())){};
 
 ShadowSolver::~ShadowSolver(){};
 
@@ -721,6 +727,12 @@ ShadowSolver::get_profile() const
                               d_solver_shadow->get_profile());
 }
 
+bool
+ShadowSolver::is_thread_safe() const
+{
+  return d_solver->is_thread_safe() && d_solver_shadow->is_thread_safe();
+}
+
 Term
 ShadowSolver::mk_var(Sort sort, const std::string& name)
 {
@@ -1079,11 +1091,37 @@ ShadowSolver::assert_formula(const Term& t)
   d_solver_shadow->assert_formula(term->get_term_shadow());
 }
 
+std::pair<Solver::Result, Solver::Result>
+ShadowSolver::check_sat_helper(const std::function<Result()>& check_orig,
+                               const std::function<Result()>& check_shadow)
+{
+  if (!d_concurrent)
+  {
+    Result res_orig = check_orig();
+    return {res_orig, check_shadow()};
+  }
+
+  /* Note: If the check on the calling thread throws, the destructor of the
+   *       future waits for the other check to terminate. */
+  if (d_solver_shadow->is_thread_safe())
+  {
+    std::future<Result> res_shadow =
+        std::async(std::launch::async, check_shadow);
+    Result res_orig = check_orig();
+    return {res_orig, res_shadow.get()};
+  }
+  assert(d_solver->is_thread_safe());
+  std::future<Result> res_orig = std::async(std::launch::async, check_orig);
+  Result res_shadow            = check_shadow();
+  return {res_orig.get(), res_shadow};
+}
+
 Solver::Result
 ShadowSolver::check_sat()
 {
-  Result res_orig   = d_solver->check_sat();
-  Result res_shadow = d_solver_shadow->check_sat();
+  auto [res_orig, res_shadow] =
+      check_sat_helper([this]() { return d_solver->check_sat(); },
+                       [this]() { return d_solver_shadow->check_sat(); });
   if (res_orig != Result::UNKNOWN && res_shadow != Result::UNKNOWN)
   {
     MURXLA_TEST(res_orig == res_shadow)
@@ -1098,8 +1136,11 @@ ShadowSolver::check_sat_assuming(const std::vector<Term>& assumptions)
 {
   std::vector<Term> assumptions_orig, assumptions_shadow;
   get_terms_helper(assumptions, assumptions_orig, assumptions_shadow);
-  Result res_orig   = d_solver->check_sat_assuming(assumptions_orig);
-  Result res_shadow = d_solver_shadow->check_sat_assuming(assumptions_shadow);
+  auto [res_orig, res_shadow] = check_sat_helper(
+      [&]() { return d_solver->check_sat_assuming(assumptions_orig); },
+      [&]() {
+        return d_solver_shadow->check_sat_assuming(assumptions_shadow);
+      });
   if (res_orig != Result::UNKNOWN && res_shadow != Result::UNKNOWN)
   {
     MURXLA_TEST(res_orig == res_shadow)
@@ -10,6 +10,8 @@
 #ifndef __MURXLA__SHADOW_SOLVER_H
 #define __MURXLA__SHADOW_SOLVER_H
 
+#include <functional>
+
 #include "fsm.hpp"
 #include "solver/solver.hpp"
 #include "theory.hpp"
@@ -138,7 +140,18 @@ class ShadowSolver : public Solver
                                std::vector<Term>& terms_orig,
                                std::vector<Term>& terms_shadow);
 
-  ShadowSolver(SolverSeedGenerator& sng, Solver* solver, Solver* solver_shadow);
+  /**
+   * Constructor.
+   * @param sng           The solver seed generator.
+   * @param solver        The solver under test.
+   * @param solver_shadow The solver used for checking.
+   * @param concurrent    True to run the satisfiability checks of both
+   *                      solvers concurrently, see check_sat_helper().
+   */
+  ShadowSolver(SolverSeedGenerator& sng,
+               Solver* solver,
+               Solver* solver_shadow,
+               bool concurrent = false);
   ~ShadowSolver() override;
 
   void new_solver() override;
@@ -146,6 +159,7 @@ class ShadowSolver : public Solver
   bool is_initialized() const override;
   const std::string get_name() const override;
   const std::string get_profile() const override;
+  bool is_thread_safe() const override;
 
   Term mk_var(Sort sort, const std::string& name) override;
   Term mk_const(Sort sort, const std::string& name) override;
@@ -229,6 +243,25 @@ class ShadowSolver : public Solver
   void disable_unsupported_actions(FSM* fsm) const override;
 
  protected:
+  /**
+   * Run the given satisfiability checks of the solver under test and the
+   * solver used for checking.
+   *
+   * If concurrent checks are enabled, one of them is run on a separate
+   * thread, which requires the solver called on that thread to be
+   * thread-safe. The other one is run on the calling thread. Else, they are
+   * run one after the other.
+   *
+   * @param check_orig   The satisfiability check of the solver under test.
+   * @param check_shadow The satisfiability check of the solver used for
+   *                     checking.
+   * @return The results of the solver under test and of the solver used for
+   *         checking.
+   */
+  std::pair<Result, Result> check_sat_helper(
+      const std::function<Result()>& check_orig,
+      const std::function<Result()>& check_shadow);
+
   /** The solver under test. */
   std::unique_ptr<Solver> d_solver;
   /** The solver used for checking. */
@@ -236,6 +269,11 @@ class ShadowSolver : public Solver
   /** Flag that indicates whether d_solver and d_solver_shadow are instances of
    * the same solver. */
   bool d_same_solver;
+  /**
+   * True if the satisfiability checks of d_solver and d_solver_shadow are run
+   * concurrently.
+   */
+  bool d_concurrent = false;
 };
 
 }  // namespace shadow
@@ -9,12 +9,15 @@
  */
 #include "smt2_solver.hpp"
 
+#include <fcntl.h>
+#include <poll.h>
 #include <signal.h>
 #include <sys/wait.h>
 #include <unistd.h>
 
 #include <algorithm>
 #include <cassert>
+#include <cerrno>
 #include <unordered_map>
 
 #include "exit.hpp"
@@ -442,7 +445,7 @@ Smt2Term::to_string() const
   return d_repr;
 }
 
-const std::string&
+const Op::Kind&
 Smt2Term::get_kind() const
 {
   return d_kind;
@@ -478,268 +481,721 @@ to_smt2_term(const Term& t)
   return static_cast<Smt2Term*>(t.get());
 }
 
-namespace {
 const std::string&
-get_default(const std::unordered_map<std::string, std::string>& map,
-            const std::string& key,
-            const std::string& default_value)
-{
-  auto it = map.find(key);
-  if (it == map.end())
+Smt2Term::get_op_kind_str(const Op::Kind& kind)
+{
+  /* Built on first use, operator kinds are interned during static
+   * initialization. Kinds interned later (ids >= table size) are not
+   * mapped. */
+  static const std::vector<std::string> table = [] {
+    std::vector<std::string> res;
+    std::initializer_list<std::pair<Op::Kind, const char*>> names = {
+        {Op::DISTINCT, "distinct"},
+        {Op::EQUAL, "="},
+        {Op::ITE, "ite"},
+
+        /* Boolean */
+        {Op::AND, "and"},
+        {Op::IFF, "="},
+        {Op::IMPLIES, "=>"},
+        {Op::NOT, "not"},
+        {Op::OR, "or"},
+        {Op::XOR, "xor"},
+
+        /* Arrays */
+        {Op::ARRAY_SELECT, "select"},
+        {Op::ARRAY_STORE, "store"},
+
+        /* Bags */
+        {Op::BAG_UNION_MAX, "bag.union_max"},
+        {Op::BAG_UNION_DISJOINT, "bag.union_disjoint"},
+        {Op::BAG_INTERSECTION_MIN, "bag.inter_min"},
+        {Op::BAG_DIFFERENCE_SUBTRACT, "bag.difference_subtract"},
+        {Op::BAG_DIFFERENCE_REMOVE, "bag.difference_remove"},
+        {Op::BAG_SUBBAG, "bag.subbag"},
+        {Op::BAG_COUNT, "bag.count"},
+        {Op::BAG_DUPLICATE_REMOVAL, "bag.duplicate_removal"},
+        {Op::BAG_MAKE, "bag"},
+        {Op::BAG_EMPTY, "bag.empty"},
+        {Op::BAG_CARD, "bag.card"},
+        {Op::BAG_CHOOSE, "bag.choose"},
+        {Op::BAG_IS_SINGLETON, "bag.is_singleton"},
+        {Op::BAG_FROM_SET, "bag.from_set"},
+        {Op::BAG_TO_SET, "bag.to_set"},
+        {Op::BAG_MAP, "bag.map"},
+
+        /* BV */
+        {Op::BV_EXTRACT, "extract"},
+        {Op::BV_REPEAT, "repeat"},
+        {Op::BV_ROTATE_LEFT, "rotate_left"},
+        {Op::BV_ROTATE_RIGHT, "rotate_right"},
+        {Op::BV_SIGN_EXTEND, "sign_extend"},
+        {Op::BV_ZERO_EXTEND, "zero_extend"},
+
+        {Op::BV_ADD, "bvadd"},
+        {Op::BV_AND, "bvand"},
+        {Op::BV_ASHR, "bvashr"},
+        {Op::BV_COMP, "bvcomp"},
+        {Op::BV_CONCAT, "concat"},
+        {Op::BV_LSHR, "bvlshr"},
+        {Op::BV_MULT, "bvmul"},
+        {Op::BV_NAND, "bvnand"},
+        {Op::BV_NEG, "bvneg"},
+        {Op::BV_NOR, "bvnor"},
+        {Op::BV_NOT, "bvnot"},
+        {Op::BV_OR, "bvor"},
+        {Op::BV_SDIV, "bvsdiv"},
+        {Op::BV_SGE, "bvsge"},
+        {Op::BV_SGT, "bvsgt"},
+        {Op::BV_SHL, "bvshl"},
+        {Op::BV_SLE, "bvsle"},
+        {Op::BV_SLT, "bvslt"},
+        {Op::BV_SMOD, "bvsmod"},
+        {Op::BV_SREM, "bvsrem"},
+        {Op::BV_SUB, "bvsub"},
+        {Op::BV_UDIV, "bvudiv"},
+        {Op::BV_UGE, "bvuge"},
+        {Op::BV_UGT, "bvugt"},
+        {Op::BV_ULE, "bvule"},
+        {Op::BV_ULT, "bvult"},
+        {Op::BV_UREM, "bvurem"},
+        {Op::BV_XNOR, "bvxnor"},
+        {Op::BV_XOR, "bvxor"},
+
+        /* Datatypes */
+        {Op::DT_APPLY_TESTER, "is"},
+        {Op::DT_APPLY_UPDATER, "update"},
+        {Op::DT_MATCH, "match"},
+        {Op::DT_MATCH_BIND_CASE, ""},
+        {Op::DT_MATCH_CASE, ""},
+
+        /* FP */
+        {Op::FP_TO_FP_FROM_BV, "to_fp"},
+        {Op::FP_TO_FP_FROM_SBV, "to_fp"},
+        {Op::FP_TO_FP_FROM_FP, "to_fp"},
+        {Op::FP_TO_FP_FROM_UBV, "to_fp_unsigned"},
+        {Op::FP_TO_FP_FROM_REAL, "to_fp"},
+        {Op::FP_TO_SBV, "fp.to_sbv"},
+        {Op::FP_TO_UBV, "fp.to_ubv"},
+
+        {Op::FP_ABS, "fp.abs"},
+        {Op::FP_ADD, "fp.add"},
+        {Op::FP_DIV, "fp.div"},
+        {Op::FP_EQ, "fp.eq"},
+        {Op::FP_FMA, "fp.fma"},
+        {Op::FP_FP, "fp"},
+        {Op::FP_IS_NORMAL, "fp.isNormal"},
+        {Op::FP_IS_SUBNORMAL, "fp.isSubnormal"},
+        {Op::FP_IS_INF, "fp.isInfinite"},
+        {Op::FP_IS_NAN, "fp.isNaN"},
+        {Op::FP_IS_NEG, "fp.isNegative"},
+        {Op::FP_IS_POS, "fp.isPositive"},
+        {Op::FP_IS_ZERO, "fp.isZero"},
+        {Op::FP_LT, "fp.lt"},
+        {Op::FP_LEQ, "fp.leq"},
+        {Op::FP_GT, "fp.gt"},
+        {Op::FP_GEQ, "fp.geq"},
+        {Op::FP_MAX, "fp.max"},
+        {Op::FP_MIN, "fp.min"},
+        {Op::FP_MUL, "fp.mul"},
+        {Op::FP_NEG, "fp.neg"},
+        {Op::FP_REM, "fp.rem"},
+        {Op::FP_RTI, "fp.roundToIntegral"},
+        {Op::FP_SQRT, "fp.sqrt"},
+        {Op::FP_SUB, "fp.sub"},
+        {Op::FP_TO_REAL, "fp.to_real"},
+
+        /* Ints */
+        {Op::INT_IS_DIV, "divisible"},
+        {Op::INT_NEG, "-"},
+        {Op::INT_SUB, "-"},
+        {Op::INT_ADD, "+"},
+        {Op::INT_MUL, "*"},
+        {Op::INT_DIV, "div"},
+        {Op::INT_MOD, "mod"},
+        {Op::INT_ABS, "abs"},
+        {Op::INT_LT, "<"},
+        {Op::INT_LTE, "<="},
+        {Op::INT_GT, ">"},
+        {Op::INT_GTE, ">="},
+
+        /* Reals */
+        {Op::REAL_NEG, "-"},
+        {Op::REAL_SUB, "-"},
+        {Op::REAL_ADD, "+"},
+        {Op::REAL_MUL, "*"},
+        {Op::REAL_DIV, "/"},
+        {Op::REAL_LT, "<"},
+        {Op::REAL_LTE, "<="},
+        {Op::REAL_GT, ">"},
+        {Op::REAL_GTE, ">="},
+        {Op::REAL_IS_INT, "is_int"},
+
+        /* Reals and Ints */
+        {Op::INT_TO_REAL, "to_real"},
+        {Op::REAL_TO_INT, "to_int"},
+
+        /* Quantifiers */
+        {Op::FORALL, "forall"},
+        {Op::EXISTS, "exists"},
+
+        /* Sequences */
+        {Op::SEQ_CONCAT, "seq.++"},
+        {Op::SEQ_LENGTH, "seq.len"},
+        {Op::SEQ_EXTRACT, "seq.extract"},
+        {Op::SEQ_UPDATE, "seq.update"},
+        {Op::SEQ_AT, "seq.at"},
+        {Op::SEQ_CONTAINS, "seq.contains"},
+        {Op::SEQ_INDEXOF, "seq.indexof"},
+        {Op::SEQ_REPLACE, "seq.replace"},
+        {Op::SEQ_REPLACE_ALL, "seq.replace_all"},
+        {Op::SEQ_REV, "seq.rev"},
+        {Op::SEQ_PREFIX, "seq.prefixof"},
+        {Op::SEQ_SUFFIX, "seq.suffixof"},
+        {Op::SEQ_UNIT, "seq.unit"},
+        {Op::SEQ_NTH, "seq.nth"},
+
+        /* Sets */
+        {Op::SET_CARD, "set.card"},
+        {Op::SET_COMPLEMENT, "set.complement"},
+        {Op::SET_COMPREHENSION, "set.comprehension"},
+        {Op::SET_CHOOSE, "set.choose"},
+        {Op::SET_INTERSECTION, "set.inter"},
+        {Op::SET_INSERT, "set.insert"},
+        {Op::SET_IS_SINGLETON, "set.is_singleton"},
+        {Op::SET_UNION, "set.union"},
+        {Op::SET_MEMBER, "set.member"},
+        {Op::SET_MINUS, "set.minus"},
+        {Op::SET_SINGLETON, "set.singleton"},
+        {Op::SET_SUBSET, "set.subset"},
+        /* Strings */
+        {Op::STR_CONCAT, "str.++"},
+        {Op::STR_LEN, "str.len"},
+        {Op::STR_LT, "str.<"},
+        {Op::STR_TO_RE, "str.to_re"},
+        {Op::STR_IN_RE, "str.in_re"},
+        {Op::STR_LE, "str.<="},
+        {Op::STR_AT, "str.at"},
+        {Op::STR_SUBSTR, "str.substr"},
+        {Op::STR_PREFIXOF, "str.prefixof"},
+        {Op::STR_SUFFIXOF, "str.suffixof"},
+        {Op::STR_CONTAINS, "str.contains"},
+        {Op::STR_INDEXOF, "str.indexof"},
+        {Op::STR_REPLACE, "str.replace"},
+        {Op::STR_REPLACE_ALL, "str.replace_all"},
+        {Op::STR_REPLACE_RE, "str.replace_re"},
+        {Op::STR_REPLACE_RE_ALL, "str.replace_re_all"},
+        {Op::STR_IS_DIGIT, "str.is_digit"},
+        {Op::STR_TO_CODE, "str.to_code"},
+        {Op::STR_FROM_CODE, "str.from_code"},
+        {Op::STR_TO_INT, "str.to_int"},
+        {Op::STR_FROM_INT, "str.from_int"},
+        {Op::RE_ALL, "re.all"},
+        {Op::RE_ALLCHAR, "re.allchar"},
+        {Op::RE_CONCAT, "re.++"},
+        {Op::RE_COMP, "re.comp"},
+        {Op::RE_DIFF, "re.diff"},
+        {Op::RE_INTER, "re.inter"},
+        {Op::RE_LOOP, "re.loop"},
+        {Op::RE_NONE, "re.none"},
+        {Op::RE_OPT, "re.opt"},
+        {Op::RE_PLUS, "re.+"},
+        {Op::RE_POW, "re.^"},
+        {Op::RE_RANGE, "re.range"},
+        {Op::RE_STAR, "re.*"},
+        {Op::RE_UNION, "re.union"},
+        /* Transcendentals */
+        {Op::TRANS_PI, "real.pi"},
+        {Op::TRANS_SINE, "sin"},
+        {Op::TRANS_COSINE, "cos"},
+        {Op::TRANS_TANGENT, "tan"},
+        {Op::TRANS_COTANGENT, "cot"},
+        {Op::TRANS_SECANT, "sec"},
+        {Op::TRANS_COSECANT, "csc"},
+        {Op::TRANS_ARCSINE, "arcsin"},
+        {Op::TRANS_ARCCOSINE, "arccos"},
+        {Op::TRANS_ARCTANGENT, "arctan"},
+        {Op::TRANS_ARCCOSECANT, "arccsc"},
+        {Op::TRANS_ARCSECANT, "arcsec"},
+        {Op::TRANS_ARCCOTANGENT, "arccot"},
+        {Op::TRANS_SQRT, "sqrt"},
+        /* UF */
+        {Op::UF_APPLY, ""},
+#ifdef MURXLA_USE_CVC5
+        /* cvc5-specific operator kinds */
+        {cvc5::Cvc5Term::OP_BV_REDAND, "bvredand"},
+        {cvc5::Cvc5Term::OP_BV_REDOR, "bvredor"},
+        {cvc5::Cvc5Term::OP_INT_TO_BV, "int2bv"},
+        {cvc5::Cvc5Term::OP_BV_TO_NAT, "bv2nat"},
+        {cvc5::Cvc5Term::OP_INT_IAND, "iand"},
+        {cvc5::Cvc5Term::OP_INT_POW2, "int.pow2"},
+        {cvc5::Cvc5Term::OP_STRING_UPDATE, "str.update"},
+        {cvc5::Cvc5Term::OP_STRING_TOLOWER, "str.tolower"},
+        {cvc5::Cvc5Term::OP_STRING_TOUPPER, "str.toupper"},
+        {cvc5::Cvc5Term::OP_STRING_REV, "str.rev"},
+#endif
+    };
+    for (const auto& [k, name] : names)
+    {
+      if (k.get_id() >= res.size()) res.resize(k.get_id() + 1);
+      res[k.get_id()] = name;
+    }
+    return res;
+  }();
+
+  KindRegistry::Id id = kind.get_id();
+  if (id < table.size() && !table[id].empty())
   {
-    return default_value;
+    return table[id];
   }
-  return it->second;
+  return kind.str();
+}
+
+/* -------------------------------------------------------------------------- */
+/* Smt2Printer                                                                */
+/* -------------------------------------------------------------------------- */
+
+namespace {
+/** @return True if terms of the given kind bind variables in their args. */
+bool
+is_binder(const Op::Kind& kind)
+{
+  return kind == Op::FORALL || kind == Op::EXISTS
+         || kind == Op::SET_COMPREHENSION || kind == Op::DT_MATCH
+         || kind == Op::FUN;
 }
 }  // namespace
 
-const std::string
-Smt2Term::get_repr() const
+void
+Smt2Printer::print(std::ostream& out, const Term& term, bool define)
 {
-  if (!d_repr.empty())
+  d_refs.clear();
+  d_visited.clear();
+  d_lets.clear();
+
+  /* Collect the subterms that may be bound to a name in post-order and
+   * compute their references. Do not go below binders, below leaves and
+   * below subterms that are already bound via define-fun. */
+  std::vector<const Term*> order;
+  std::vector<std::pair<const Term*, bool>> visit = {{&term, false}};
+  while (!visit.empty())
   {
-    return d_repr;
+    auto [cur, done] = visit.back();
+    visit.pop_back();
+    const Smt2Term* t = to_smt2_term(*cur);
+    if (done)
+    {
+      order.push_back(cur);
+      continue;
+    }
+    if (!d_visited.insert(t).second || is_leaf(t)) continue;
+    auto it = d_info.find(t);
+    if (it != d_info.end() && !it->second.d_name.empty()) continue;
+    visit.emplace_back(cur, true);
+    if (is_binder(t->get_kind())) continue;
+    const std::vector<Term>& args = t->get_args();
+    for (auto ita = args.rbegin(); ita != args.rend(); ++ita)
+    {
+      d_refs[to_smt2_term(*ita)] += 1;
+      visit.emplace_back(&*ita, false);
+    }
   }
 
-  std::vector<const Smt2Term*> visit;
-  std::unordered_map<const Smt2Term*, std::string> cache;
-  std::unordered_map<const Smt2Term*, uint64_t> refs;
-  std::vector<std::string> lets;
+  /* Bind shared subterms, subterms before the terms that contain them. */
+  for (const Term* cur : order)
+  {
+    const Smt2Term* t = to_smt2_term(*cur);
+    auto it           = d_info.find(t);
+    bool shared       = d_refs[t] > 1;
+    bool printed      = it != d_info.end() && it->second.d_printed;
+    if (!shared && !printed) continue;
+    bool define_fun =
+        define && !has_vars(*cur) && t->get_sort() != nullptr;
+    if (!shared && !define_fun) continue;
+
+    std::stringstream body;
+    print_inline(body, *cur);
+    if (define_fun)
+    {
+      std::stringstream name, def;
+      name << "_def" << d_n_definitions++;
+      def << "(define-fun " << name.str() << " () "
+          << static_cast<Smt2Sort*>(t->get_sort().get())->get_repr() << " "
+          << body.str() << ")";
+      d_definitions.push_back(def.str());
+      d_info.at(t).d_name = name.str();
+    }
+    else
+    {
+      std::stringstream name;
+      name << "_let" << d_lets.size();
+      out << "(let ((" << name.str() << " " << body.str() << "))";
+      d_lets.emplace(t, name.str());
+    }
+  }
 
-  std::unordered_set<Op::Kind> new_scope = {
-      Op::FORALL, Op::EXISTS, Op::SET_COMPREHENSION, Op::DT_MATCH, Op::FUN};
+  print_inline(out, term);
+  for (size_t i = 0, n = d_lets.size(); i < n; ++i)
+  {
+    out << ")";
+  }
+}
 
-  // Compute references
-  visit.push_back(this);
+std::vector<std::string>
+Smt2Printer::take_definitions()
+{
+  std::vector<std::string> res;
+  res.swap(d_definitions);
+  return res;
+}
+
+void
+Smt2Printer::reset()
+{
+  /* Keep counting definitions, names must not be reused in case the solver
+   * does not forget them. */
+  d_info.clear();
+  d_definitions.clear();
+}
+
+bool
+Smt2Printer::is_leaf(const Smt2Term* term)
+{
+  return term->get_leaf_kind() != AbsTerm::LeafKind::NONE
+         || term->get_kind() == Op::FUN;
+}
+
+bool
+Smt2Printer::has_vars(const Term& term)
+{
+  std::vector<const Term*> visit = {&term};
   while (!visit.empty())
   {
-    const Smt2Term* cur = visit.back();
-    visit.pop_back();
-
-    const auto& it = cache.find(cur);
-    if (it == cache.end())
+    const Term* cur   = visit.back();
+    const Smt2Term* t = to_smt2_term(*cur);
+    Info& info        = d_info.emplace(t, Info{*cur}).first->second;
+    if (info.d_has_vars >= 0)
+    {
+      visit.pop_back();
+      continue;
+    }
+    if (is_leaf(t))
+    {
+      info.d_has_vars =
+          t->get_leaf_kind() == AbsTerm::LeafKind::VARIABLE ? 1 : 0;
+      visit.pop_back();
+      continue;
+    }
+    bool pending = false;
+    int8_t res   = 0;
+    for (const auto& arg : t->get_args())
     {
-      cache.emplace(cur, "");
-      /* Do not go below quantifiers. */
-      if (new_scope.find(cur->d_kind) != new_scope.end())
+      auto it = d_info.find(to_smt2_term(arg));
+      if (it == d_info.end() || it->second.d_has_vars < 0)
       {
-        continue;
+        visit.push_back(&arg);
+        pending = true;
       }
-      for (const auto& arg : cur->d_args)
+      else
       {
-        visit.push_back(to_smt2_term(arg));
-        refs[visit.back()] += 1;
+        res |= it->second.d_has_vars;
       }
-      continue;
+    }
+    if (!pending)
+    {
+      info.d_has_vars = res;
+      visit.pop_back();
     }
   }
+  return d_info.at(to_smt2_term(term)).d_has_vars == 1;
+}
 
-  cache.clear();
-  visit.push_back(this);
-  while (!visit.empty())
+void
+Smt2Printer::print_inline(std::ostream& out, const Term& term)
+{
+  assert(d_tasks.empty());
+  d_tasks.push_back({&term, ""});
+  while (!d_tasks.empty())
   {
-    const Smt2Term* cur = visit.back();
+    Task task = std::move(d_tasks.back());
+    d_tasks.pop_back();
+    if (task.d_term == nullptr)
+    {
+      out << task.d_text;
+      continue;
+    }
 
-    const auto& it = cache.find(cur);
-    if (it == cache.end())
+    const Smt2Term* t = to_smt2_term(*task.d_term);
+    if (is_leaf(t))
     {
-      cache.emplace(cur, "");
-      for (const auto& arg : cur->d_args)
-      {
-        visit.push_back(to_smt2_term(arg));
-      }
+      assert(!t->to_string().empty());
+      out << t->to_string();
       continue;
     }
-    else
+    auto it = d_info.find(t);
+    if (it != d_info.end() && !it->second.d_name.empty())
+    {
+      out << it->second.d_name;
+      continue;
+    }
+    auto itl = d_lets.find(t);
+    if (itl != d_lets.end())
+    {
+      out << itl->second;
+      continue;
+    }
+    if (it == d_info.end())
     {
-      std::stringstream res;
+      it = d_info.emplace(t, Info{*task.d_term}).first;
+    }
+    it->second.d_printed = true;
+    push_tasks(t);
+  }
+}
 
-      size_t i = 0;
-      if (cur->get_leaf_kind() != AbsTerm::LeafKind::NONE
-          || cur->get_kind() == Op::FUN)
+void
+Smt2Printer::push_tasks(const Smt2Term* term)
+{
+  const Op::Kind& kind                     = term->get_kind();
+  const std::vector<Term>& args            = term->get_args();
+  const std::vector<std::string>& str_args = term->get_str_args();
+  const std::vector<uint32_t>& indices     = term->get_indices_uint32();
+
+  d_term_tasks.clear();
+  auto text = [this](std::string s) {
+    d_term_tasks.push_back({nullptr, std::move(s)});
+  };
+  auto arg = [this, &args](size_t idx) {
+    d_term_tasks.push_back({&args[idx], ""});
+  };
+
+  size_t i = 0, size = args.size();
+  if (kind == Op::DT_APPLY_TESTER)
+  {
+    assert(str_args.size() == 1);
+    text("((_ " + Smt2Term::get_op_kind_str(kind) + " " + str_args[0] + ")");
+  }
+  else if (kind == Op::DT_APPLY_UPDATER)
+  {
+    assert(str_args.size() == 2);
+    text("((_ " + Smt2Term::get_op_kind_str(kind) + " " + str_args[1] + ")");
+  }
+  else if (kind == Op::DT_MATCH)
+  {
+    text("(" + Smt2Term::get_op_kind_str(kind) + " ");
+    arg(i++);
+    text(" (");
+    for (; i < size; ++i)
+    {
+      arg(i);
+    }
+    text("))");
+  }
+  else if (kind == Op::DT_MATCH_BIND_CASE)
+  {
+    if (str_args.empty())
+    {
+      /* variable pattern */
+      assert(size == 2);
+      text("(");
+      arg(0);
+      text(" ");
+      arg(1);
+      text(")");
+      i = 2;
+    }
+    else
+    {
+      text("((" + str_args[0] + " ");
+      for (; i < size - 1; ++i)
       {
-        assert(!cur->d_repr.empty());
-        res << cur->d_repr;
+        if (i > 0) text(" ");
+        arg(i);
       }
-      else
+      text(") ");
+      arg(i++);
+      text(")");
+    }
+  }
+  else if (kind == Op::DT_MATCH_CASE)
+  {
+    assert(str_args.size() == 1);
+    assert(size == 1);
+    text("(" + str_args[0] + " ");
+    arg(0);
+    text(") ");
+    i = size;
+  }
+  else if (indices.empty())
+  {
+    if (size > 0)
+    {
+      text("(");
+    }
+    if (kind == Op::UF_APPLY)
+    {
+      arg(i++);
+    }
+    else if (kind == Op::DT_APPLY_CONS)
+    {
+      assert(str_args.size() == 1);
+      text(str_args[0]);
+    }
+    else if (kind == Op::DT_APPLY_SEL)
+    {
+      assert(str_args.size() == 2);
+      text(str_args[1]);
+    }
+    else
+    {
+      text(Smt2Term::get_op_kind_str(kind));
+    }
+    if (kind == Op::FORALL || kind == Op::EXISTS
+        || kind == Op::SET_COMPREHENSION)
+    {
+      assert(size > 1);
+      size_t n_vars = size - 1;
+      if (kind == Op::SET_COMPREHENSION)
       {
-        if (cur->d_kind == Op::DT_APPLY_TESTER)
-        {
-          assert(cur->d_str_args.size() == 1);
-          res << "((_ " << d_op_kind_to_str.at(cur->d_kind) << " "
-              << cur->d_str_args[0] << ")";
-        }
-        else if (cur->d_kind == Op::DT_APPLY_UPDATER)
-        {
-          assert(cur->d_str_args.size() == 2);
-          res << "((_ " << d_op_kind_to_str.at(cur->d_kind) << " "
-              << cur->d_str_args[1] << ")";
-        }
-        else if (cur->d_kind == Op::DT_MATCH)
-        {
-          res << "(" << d_op_kind_to_str.at(cur->d_kind) << " "
-              << to_smt2_term(cur->d_args[i++])->get_repr() << " (";
-          for (size_t n = cur->d_args.size(); i < n; ++i)
-          {
-            res << to_smt2_term(cur->d_args[i])->get_repr();
-          }
-          res << "))";
-        }
-        else if (cur->d_kind == Op::DT_MATCH_BIND_CASE)
-        {
-          if (cur->d_str_args.empty())
-          {
-            /* variable pattern */
-            assert(cur->d_args.size() == 2);
-            res << "(" << to_smt2_term(cur->d_args[0])->get_repr() << " "
-                << to_smt2_term(cur->d_args[1])->get_repr() << ")";
-            i = 2;
-          }
-          else
-          {
-            res << "((" << cur->d_str_args[0] << " ";
-            for (size_t n = cur->d_args.size() - 1; i < n; ++i)
-            {
-              if (i > 0) res << " ";
-              res << to_smt2_term(cur->d_args[i])->get_repr();
-            }
-            res << ") ";
-            res << to_smt2_term(cur->d_args[i++])->get_repr();
-            res << ")";
-          }
-        }
-        else if (cur->d_kind == Op::DT_MATCH_CASE)
-        {
-          assert(cur->d_str_args.size() == 1);
-          assert(cur->d_args.size() == 1);
-          res << "(" << cur->d_str_args[0] << " "
-              << to_smt2_term(cur->d_args[0])->get_repr() << ") ";
-          i = cur->d_args.size();
-        }
-        else if (cur->d_indices.empty())
-        {
-          if (!cur->d_args.empty())
-          {
-            res << "(";
-          }
-          if (cur->d_kind == Op::UF_APPLY)
-          {
-            res << to_smt2_term(cur->d_args[0])->get_repr();
-            i += 1;
-          }
-          else if (cur->d_kind == Op::DT_APPLY_CONS)
-          {
-            assert(cur->get_str_args().size() == 1);
-            res << cur->get_str_args()[0];
-          }
-          else if (cur->d_kind == Op::DT_APPLY_SEL)
-          {
-            assert(cur->get_str_args().size() == 2);
-            res << cur->get_str_args()[1];
-          }
-          else
-          {
-            res << get_default(d_op_kind_to_str, cur->d_kind, cur->d_kind);
-          }
-          if (cur->d_kind == Op::FORALL || cur->d_kind == Op::EXISTS
-              || cur->d_kind == Op::SET_COMPREHENSION)
-          {
-            assert(cur->d_args.size() > 1);
-            size_t size = cur->d_args.size() - 1;
-            if (cur->d_kind == Op::SET_COMPREHENSION)
-            {
-              assert(size >= 1);
-              size -= 1;
-            }
-            /* print bound variables, body is last argument term in d_args */
-            res << " (";
-            for (; i < size; ++i)
-            {
-              if (i > 0) res << " ";
-              const Smt2Term* smt2_term = to_smt2_term(cur->d_args[i]);
-              assert(smt2_term->get_leaf_kind() == AbsTerm::LeafKind::VARIABLE);
-              Smt2Sort* smt2_sort =
-                  static_cast<Smt2Sort*>(cur->d_args[i]->get_sort().get());
-
-              const auto itt = cache.find(smt2_term);
-              assert(itt != cache.end());
-              assert(!itt->second.empty());
-
-              res << "(" << itt->second << " " << smt2_sort->get_repr() << ")";
-            }
-            res << ")";
-          }
-        }
-        else
-        {
-          res << "((_ "
-              << get_default(d_op_kind_to_str, cur->d_kind, cur->d_kind);
-          for (uint32_t p : cur->d_indices)
-          {
-            res << " " << p;
-          }
-          res << ")";
-        }
-        size_t size = cur->d_args.size();
-        if (i < size)
-        {
-          for (; i < size; ++i)
-          {
-            const auto itt = cache.find(to_smt2_term(cur->d_args[i]));
-            assert(itt != cache.end());
-            assert(!itt->second.empty());
-            res << " " << itt->second;
-          }
-          if (!cur->d_args.empty())
-          {
-            res << ")";
-          }
-        }
+        assert(n_vars >= 1);
+        n_vars -= 1;
       }
-
-      if (it->second.empty())
+      /* print bound variables, body is last argument term in args */
+      text(" (");
+      for (; i < n_vars; ++i)
       {
-        uint64_t nrefs = refs[cur];
-
-        if (nrefs > 1 && cur->get_leaf_kind() == AbsTerm::LeafKind::NONE)
-        {
-          std::stringstream let;
-          let << "_let" << lets.size() / 2;
-          lets.push_back(let.str());
-          lets.push_back(res.str());
-          it->second = let.str();
-        }
-        else
-        {
-          it->second = res.str();
-        }
+        if (i > 0) text(" ");
+        assert(to_smt2_term(args[i])->get_leaf_kind()
+               == AbsTerm::LeafKind::VARIABLE);
+        Smt2Sort* smt2_sort = static_cast<Smt2Sort*>(args[i]->get_sort().get());
+        text("(");
+        arg(i);
+        text(" " + smt2_sort->get_repr() + ")");
       }
+      text(")");
     }
-    visit.pop_back();
   }
-
-  auto itt = cache.find(this);
-  assert(itt != cache.end());
-  assert(!itt->second.empty());
-  std::string t = itt->second;
-
-  std::stringstream res;
-  if (!lets.empty())
+  else
   {
-    std::stringstream close;
-    for (size_t i = 0; i < lets.size(); i += 2)
+    std::stringstream ss;
+    ss << "((_ " << Smt2Term::get_op_kind_str(kind);
+    for (uint32_t p : indices)
     {
-      res << "(let ((" << lets[i] << " " << lets[i + 1] << "))";
-      close << ")";
+      ss << " " << p;
     }
-    res << itt->second << close.str();
+    ss << ")";
+    text(ss.str());
   }
-  else
+  if (i < size)
   {
-    res << itt->second;
+    for (; i < size; ++i)
+    {
+      text(" ");
+      arg(i);
+    }
+    text(")");
   }
 
-  return res.str();
+  /* The stack is processed back to front. */
+  d_tasks.insert(d_tasks.end(),
+                 std::make_move_iterator(d_term_tasks.rbegin()),
+                 std::make_move_iterator(d_term_tasks.rend()));
+}
+
+/* -------------------------------------------------------------------------- */
+/* Smt2Process                                                                */
+/* -------------------------------------------------------------------------- */
+
+void
+Smt2Process::start(const std::string& solver_call)
+{
+  assert(d_pid == 0);
+
+  int32_t fd_to[2], fd_from[2];
+
+  /* Open input/output pipes from and to the external online solver. */
+  MURXLA_EXIT_ERROR(pipe(fd_to) != 0) << "creating input pipe failed";
+  MURXLA_EXIT_ERROR(pipe(fd_from) != 0) << "creating output pipe failed";
+
+  d_pid = fork();
+
+  MURXLA_EXIT_ERROR_FORK(d_pid < 0, true) << "forking solver process failed.";
+
+  /* Online solver process. */
+  if (d_pid == 0)
+  {
+    close(fd_to[SMT2_WRITE_END]);
+    dup2(fd_to[SMT2_READ_END], STDIN_FILENO);
+
+    close(fd_from[SMT2_READ_END]);
+    /* Redirect stdout of external solver to write end. */
+    dup2(fd_from[SMT2_WRITE_END], STDOUT_FILENO);
+    /* Redirect stderr of external solver to write end. */
+    dup2(fd_from[SMT2_WRITE_END], STDERR_FILENO);
+
+    std::vector<char*> execv_args;
+    std::string arg;
+    std::stringstream ss(solver_call);
+    while (std::getline(ss, arg, ' '))
+    {
+      execv_args.push_back(strdup(arg.c_str()));
+    }
+    execv_args.push_back(nullptr);
+
+    execv(execv_args[0], execv_args.data());
+
+    for (char* s : execv_args)
+    {
+      free(s);
+    }
+
+    MURXLA_EXIT_ERROR_FORK(true, true)
+        << "'" << solver_call << "' is not executable";
+  }
+
+  close(fd_to[SMT2_READ_END]);
+  close(fd_from[SMT2_WRITE_END]);
+  d_fd_to   = fd_to[SMT2_WRITE_END];
+  d_fd_from = fd_from[SMT2_READ_END];
+  /* Do not leak the pipes into other (online solver) processes. */
+  fcntl(d_fd_to, F_SETFD, FD_CLOEXEC);
+  fcntl(d_fd_from, F_SETFD, FD_CLOEXEC);
+}
+
+void
+Smt2Process::stop()
+{
+  if (d_pid == 0) return;
+  kill(d_pid, SIGKILL);
+  wait();
+}
+
+void
+Smt2Process::wait()
+{
+  if (d_pid == 0) return;
+  waitpid(d_pid, nullptr, 0);
+  d_pid = 0;
+  close_fds();
+}
+
+bool
+Smt2Process::is_running()
+{
+  if (d_pid == 0) return false;
+  if (waitpid(d_pid, nullptr, WNOHANG) == 0) return true;
+  d_pid = 0;
+  close_fds();
+  return false;
+}
+
+void
+Smt2Process::close_fds()
+{
+  if (d_fd_to >= 0) close(d_fd_to);
+  if (d_fd_from >= 0) close(d_fd_from);
+  d_fd_to   = -1;
+  d_fd_from = -1;
 }
 
 /* -------------------------------------------------------------------------- */
@@ -765,23 +1221,33 @@ void
 Smt2Solver::push_to_external(std::string s, ResponseKind expected)
 {
   assert(d_file_to);
-  assert(d_file_from);
+  assert(d_fd_from >= 0);
   fputs(s.c_str(), d_file_to);
   fputc('\n', d_file_to);
+
+  if (d_pipelined && expected == ResponseKind::SMT2_SUCCESS)
+  {
+    d_pending.push_back(std::move(s));
+    if (d_pending.size() >= SMT2_MAX_PENDING)
+    {
+      fflush(d_file_to);
+      check_pending_external(true);
+    }
+    else
+    {
+      check_pending_external(false);
+    }
+    return;
+  }
+
   fflush(d_file_to);
-  std::string res = get_from_external();
+  check_pending_external(true);
+  std::string res;
+  get_from_external(res, true);
   trim_str(res);
   switch (expected)
   {
-    case ResponseKind::SMT2_SUCCESS:
-      if (res != "success")
-      {
-        std::cerr << "[murxla] SMT2: Error: expected 'success' response from "
-                     "online solver but got '"
-                  << res << "'" << std::endl;
-        exit(EXIT_ERROR);
-      }
-      break;
+    case ResponseKind::SMT2_SUCCESS: check_success_external(res, s); break;
     case ResponseKind::SMT2_SAT:
       if (res != "sat" && res != "unsat" && res != "unknown")
       {
@@ -817,54 +1283,119 @@ Smt2Solver::push_to_external(std::string s, ResponseKind expected)
   }
 }
 
-/**
- * Either parses one line or an s-expression if the first character of the
- * stream is '('.
- */
-std::string
-Smt2Solver::get_from_external() const
+void
+Smt2Solver::check_pending_external(bool block)
 {
-  std::vector<std::string> lines;
-  std::stringstream ss;
-  size_t in_sexpr = 0;
-  size_t nchars   = 0;
-  while (true)
+  while (!d_pending.empty())
+  {
+    std::string res;
+    if (!get_from_external(res, block)) break;
+    trim_str(res);
+    check_success_external(res, d_pending.front());
+    d_pending.pop_front();
+  }
+}
+
+void
+Smt2Solver::check_success_external(const std::string& res,
+                                   const std::string& cmd)
+{
+  if (res != "success")
+  {
+    std::cerr << "[murxla] SMT2: Error: expected 'success' response from "
+                 "online solver but got '"
+              << res << "'";
+    if (d_pipelined)
+    {
+      std::cerr << " for command '" << cmd << "'";
+    }
+    std::cerr << std::endl;
+    exit(EXIT_ERROR);
+  }
+}
+
+void
+Smt2Solver::sync_external()
+{
+  /* A previous test run may have been killed before consuming all responses,
+   * and may have enabled print-success. The response to the echo command is
+   * the first response that is not a leftover of previous runs. */
+  static const std::string sync_str = "\"murxla-sync\"";
+  fputs("(reset)\n", d_file_to);
+  fputs(("(echo " + sync_str + ")\n").c_str(), d_file_to);
+  fflush(d_file_to);
+  std::string res;
+  do
   {
-    int32_t c = fgetc(d_file_from);
-    ++nchars;
-    if (c == EOF)
+    get_from_external(res, true, false);
+    trim_str(res);
+    if (res == "[EOF]")
     {
-      return "[EOF]";
+      std::cerr << "[murxla] SMT2: Error: persistent online solver terminated"
+                << std::endl;
+      exit(EXIT_ERROR);
     }
-    else if (c == '(' && (in_sexpr || nchars == 1))
+  } while (res != sync_str);
+}
+
+bool
+Smt2Solver::get_from_external(std::string& res, bool block, bool echo)
+{
+  size_t pos      = 0;
+  size_t in_sexpr = 0;
+  while (true)
+  {
+    /* Scan buffered output for the end of the response. */
+    for (; pos < d_from_buffer.size(); ++pos)
     {
-      ++in_sexpr;
+      char c = d_from_buffer[pos];
+      if (c == '(' && (in_sexpr || pos == 0))
+      {
+        ++in_sexpr;
+      }
+      else if (c == ')' && in_sexpr)
+      {
+        --in_sexpr;
+      }
+      else if (c == '\n' && !in_sexpr)
+      {
+        break;
+      }
     }
-    else if (c == ')' && in_sexpr)
+    if (pos < d_from_buffer.size())
     {
-      --in_sexpr;
+      break;
     }
 
-    ss << ((char) c);
-    if (c == '\n')
+    /* Read more output. */
+    if (!block)
     {
-      lines.push_back(ss.str());
-      ss.str("");
-      ss.clear();
+      pollfd pfd = {d_fd_from, POLLIN, 0};
+      if (poll(&pfd, 1, 0) <= 0) return false;
     }
-    if (c == '\n' && !in_sexpr)
+    char buf[4096];
+    ssize_t n = read(d_fd_from, buf, sizeof(buf));
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0)
     {
-      break;
+      d_from_buffer.clear();
+      res = "[EOF]";
+      return true;
     }
+    d_from_buffer.append(buf, n);
   }
-  std::string res;
-  for (auto& line : lines)
+
+  res = d_from_buffer.substr(0, pos + 1);
+  d_from_buffer.erase(0, pos + 1);
+  if (!echo) return true;
+  std::stringstream ss(res);
+  std::string line;
+  while (std::getline(ss, line))
   {
-    d_out << "; " << line;
-    res += line;
+    d_out << "; " << line << std::endl;
   }
   d_out << std::flush;
-  return res;
+  return true;
 }
 
 void
@@ -874,24 +1405,37 @@ Smt2Solver::dump_smt2(std::string s, ResponseKind expected)
   if (d_online) push_to_external(s, expected);
 }
 
+void
+Smt2Solver::dump_definitions()
+{
+  for (const auto& def : d_printer.take_definitions())
+  {
+    dump_smt2(def);
+  }
+}
+
 Smt2Solver::Smt2Solver(SolverSeedGenerator& sng,
                        std::ostream& out,
-                       const std::string& solver_binary)
+                       const std::string& solver_binary,
+                       bool pipelined,
+                       Smt2Process* process)
     : Solver(sng),
       d_out(out),
       d_online(!solver_binary.empty()),
+      d_pipelined(pipelined),
       d_file_to(nullptr),
-      d_file_from(nullptr),
+      d_persistent(process),
       d_solver_call(solver_binary)
 {
+  assert(!process || d_online);
 }
 
 Smt2Solver::~Smt2Solver()
 {
-  if (d_online_pid)
+  if (d_process.get_pid())
   {
     assert(d_online);
-    waitpid(d_online_pid, nullptr, 0);
+    d_process.wait();
   }
 }
 
@@ -900,64 +1444,30 @@ Smt2Solver::new_solver()
 {
   if (d_online)
   {
-    int32_t fd_to[2], fd_from[2];
-
-    /* Open input/output pipes from and to the external online solver. */
-    MURXLA_EXIT_ERROR(pipe(fd_to) != 0) << "creating input pipe failed";
-    MURXLA_EXIT_ERROR(pipe(fd_from) != 0) << "creating output pipe failed";
-
-    d_online_pid = fork();
-
-    MURXLA_EXIT_ERROR_FORK(d_online_pid < 0, true)
-        << "forking solver process failed.";
-
-    /* Online solver process. */
-    if (d_online_pid == 0)
+    Smt2Process* process = d_persistent;
+    if (!process)
     {
-      close(fd_to[SMT2_WRITE_END]);
-      dup2(fd_to[SMT2_READ_END], STDIN_FILENO);
-
-      close(fd_from[SMT2_READ_END]);
-      /* Redirect stdout of external solver to write end. */
-      dup2(fd_from[SMT2_WRITE_END], STDOUT_FILENO);
-      /* Redirect stderr of external solver to write end. */
-      dup2(fd_from[SMT2_WRITE_END], STDERR_FILENO);
-
-      std::vector<char*> execv_args;
-      std::string arg;
-      std::stringstream ss(d_solver_call);
-      while (std::getline(ss, arg, ' '))
-      {
-        execv_args.push_back(strdup(arg.c_str()));
-      }
-      execv_args.push_back(nullptr);
-
-      execv(execv_args[0], execv_args.data());
-
-      for (char* s : execv_args)
-      {
-        free(s);
-      }
-
-      MURXLA_EXIT_ERROR_FORK(true, true)
-          << "'" << d_solver_call << "' is not executable";
+      d_process.start(d_solver_call);
+      process = &d_process;
+
+      /* Kill online solver in case the SMT2 solver process gets a SIGINT
+       * signal. This ensures that the online solver process will always be
+       * cleaned up in case it runs into a timeout. A persistent online solver
+       * is cleaned up by the main process. */
+      s_online_solver_pid = d_process.get_pid();
+      signal(SIGINT, kill_online_solver);
     }
 
-    /* Kill online solver in case the SMT2 solver process gets a SIGINT signal.
-     * This ensures that the online solver process will always be cleaned up in
-     * case it runs into a timeout. */
-    s_online_solver_pid = d_online_pid;
-    signal(SIGINT, kill_online_solver);
-
-    close(fd_to[SMT2_READ_END]);
-    close(fd_from[SMT2_WRITE_END]);
-    d_file_to   = fdopen(fd_to[SMT2_WRITE_END], "w");
-    d_file_from = fdopen(fd_from[SMT2_READ_END], "r");
+    d_file_to = fdopen(dup(process->get_fd_to()), "w");
+    d_fd_from = process->get_fd_from();
 
     MURXLA_EXIT_ERROR_FORK(d_file_to == nullptr, true)
         << "opening read channel to external solver failed";
-    MURXLA_EXIT_ERROR_FORK(d_file_from == nullptr, true)
-        << "opening write channel to external solver failed";
+
+    if (d_persistent)
+    {
+      sync_external();
+    }
   }
 
   d_initialized = true;
@@ -973,7 +1483,20 @@ Smt2Solver::new_solver()
 void
 Smt2Solver::delete_solver()
 {
-  dump_smt2("(exit)");
+  if (d_persistent)
+  {
+    /* Keep the persistent online solver alive for the next test run. */
+    d_out << "(exit)" << std::endl << std::flush;
+  }
+  else
+  {
+    dump_smt2("(exit)");
+  }
+  if (d_online)
+  {
+    fflush(d_file_to);
+    check_pending_external(true);
+  }
 }
 
 bool
@@ -994,6 +1517,12 @@ Smt2Solver::get_profile() const
   return s_profile;
 }
 
+bool
+Smt2Solver::is_thread_safe() const
+{
+  return true;
+}
+
 Term
 Smt2Solver::mk_var(Sort sort, const std::string& name)
 {
@@ -1056,18 +1585,20 @@ Smt2Solver::mk_fun(const std::string& name,
     const auto& s = checked_cast<Smt2Sort*>(t->get_sort().get());
     if (i++ > 0) smt2 << " ";
     smt2 << "(";
-    smt2 << t->get_repr();
+    smt2 << t->to_string();
     smt2 << " ";
     smt2 << s->get_repr();
     smt2 << ")";
   }
   smt2 << ") ";
 
-  const auto& t = to_smt2_term(body);
   const auto& s = checked_cast<Smt2Sort*>(body->get_sort().get());
 
-  smt2 << s->get_repr() << " " << t->get_repr() << ")";
+  smt2 << s->get_repr() << " ";
+  d_printer.print(smt2, body);
+  smt2 << ")";
 
+  dump_definitions();
   dump_smt2(smt2.str());
   std::vector<Term> smt2_args(args.begin(), args.end());
   smt2_args.push_back(body);
@@ -1644,7 +2175,7 @@ Smt2Solver::get_sort(Term term, SortKind sort_kind)
 
 #ifdef MURXLA_USE_CVC5
   /* cvc5 solver-specific operators */
-  if (kind.rfind("cvc5-", 0) == 0)
+  if (kind.str().rfind("cvc5-", 0) == 0)
   {
     if (kind == cvc5::Cvc5Term::OP_BV_REDAND
         || kind == cvc5::Cvc5Term::OP_BV_REDOR)
@@ -1820,7 +2351,7 @@ Smt2Solver::get_sort(Term term, SortKind sort_kind)
         bv_size = params[0];
         sort    = get_bv_sort_string(bv_size);
       }
-      else if (kind.rfind("OP_BV_", 0) == 0)
+      else if (kind.str().rfind("OP_BV_", 0) == 0)
       {
         // return sort of first operand for non-solver-specific bv operators
         return args[0]->get_sort();
@@ -1943,8 +2474,10 @@ void
 Smt2Solver::assert_formula(const Term& t)
 {
   std::stringstream smt2;
-  Smt2Term* smt2_term = static_cast<Smt2Term*>(t.get());
-  smt2 << "(assert " << smt2_term->get_repr() << ")";
+  smt2 << "(assert ";
+  d_printer.print(smt2, t);
+  smt2 << ")";
+  dump_definitions();
   dump_smt2(smt2.str());
 }
 
@@ -1962,11 +2495,11 @@ Smt2Solver::check_sat_assuming(const std::vector<Term>& assumptions)
   smt2 << "(check-sat-assuming ( ";
   for (size_t i = 0, n = assumptions.size(); i < n; ++i)
   {
-    Smt2Term* smt2_term = static_cast<Smt2Term*>(assumptions[i].get());
     if (i > 0) smt2 << " ";
-    smt2 << smt2_term->get_repr();
+    d_printer.print(smt2, assumptions[i]);
   }
   smt2 << "))";
+  dump_definitions();
   dump_smt2(smt2.str(), ResponseKind::SMT2_SAT);
   return d_last_result;
 }
@@ -2019,12 +2552,14 @@ void
 Smt2Solver::reset()
 {
   dump_smt2("(reset)");
+  d_printer.reset();
 }
 
 void
 Smt2Solver::reset_assertions()
 {
   dump_smt2("(reset-assertions)");
+  d_printer.reset();
 }
 
 void
@@ -2112,9 +2647,8 @@ Smt2Solver::get_value(const std::vector<Term>& terms)
   smt2 << "(get-value (";
   for (size_t i = 0, n = terms.size(); i < n; ++i)
   {
-    Smt2Term* smt2_term = static_cast<Smt2Term*>(terms[i].get());
     if (i > 0) smt2 << " ";
-    smt2 << smt2_term->get_repr();
+    d_printer.print(smt2, terms[i], false);
   }
   smt2 << "))";
   dump_smt2(smt2.str(), ResponseKind::SMT2_SEXPR);
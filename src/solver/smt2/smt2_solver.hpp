@@ -10,6 +10,8 @@
 #ifndef __MURXLA__SMT2_SOLVER_H
 #define __MURXLA__SMT2_SOLVER_H
 
+#include <deque>
+
 #include "fsm.hpp"
 #ifdef MURXLA_USE_CVC5
 #include "solver/cvc5/cvc5_solver.hpp"
@@ -114,12 +116,19 @@ class Smt2Term : public AbsTerm
   bool equals(const Term& other) const override;
   std::string to_string() const override;
 
-  const std::string& get_kind() const override;
+  const Op::Kind& get_kind() const override;
   std::vector<Term> get_children() const override;
   const std::vector<Term>& get_args() const;
   const std::vector<std::string>& get_str_args() const;
   const std::vector<uint32_t>& get_indices_uint32() const;
-  const std::string get_repr() const;
+
+  /**
+   * Get the SMT-LIB name of the given operator kind. The names are stored in
+   * a table shared by all terms, indexed by operator kind id.
+   * @param kind The operator kind.
+   * @return The SMT-LIB name, or the kind string if it has no SMT-LIB name.
+   */
+  static const std::string& get_op_kind_str(const Op::Kind& kind);
 
  private:
   /** The operator kind of this term. */
@@ -132,254 +141,157 @@ class Smt2Term : public AbsTerm
   std::vector<uint32_t> d_indices;
   /** The smt2 representation of this term. */
   std::string d_repr;
+};
 
-  std::unordered_map<std::string, std::string> d_op_kind_to_str = {
-      {Op::DISTINCT, "distinct"},
-      {Op::EQUAL, "="},
-      {Op::ITE, "ite"},
-
-      /* Boolean */
-      {Op::AND, "and"},
-      {Op::IFF, "="},
-      {Op::IMPLIES, "=>"},
-      {Op::NOT, "not"},
-      {Op::OR, "or"},
-      {Op::XOR, "xor"},
-
-      /* Arrays */
-      {Op::ARRAY_SELECT, "select"},
-      {Op::ARRAY_STORE, "store"},
-
-      /* Bags */
-      {Op::BAG_UNION_MAX, "bag.union_max"},
-      {Op::BAG_UNION_DISJOINT, "bag.union_disjoint"},
-      {Op::BAG_INTERSECTION_MIN, "bag.inter_min"},
-      {Op::BAG_DIFFERENCE_SUBTRACT, "bag.difference_subtract"},
-      {Op::BAG_DIFFERENCE_REMOVE, "bag.difference_remove"},
-      {Op::BAG_SUBBAG, "bag.subbag"},
-      {Op::BAG_COUNT, "bag.count"},
-      {Op::BAG_DUPLICATE_REMOVAL, "bag.duplicate_removal"},
-      {Op::BAG_MAKE, "bag"},
-      {Op::BAG_EMPTY, "bag.empty"},
-      {Op::BAG_CARD, "bag.card"},
-      {Op::BAG_CHOOSE, "bag.choose"},
-      {Op::BAG_IS_SINGLETON, "bag.is_singleton"},
-      {Op::BAG_FROM_SET, "bag.from_set"},
-      {Op::BAG_TO_SET, "bag.to_set"},
-      {Op::BAG_MAP, "bag.map"},
-
-      /* BV */
-      {Op::BV_EXTRACT, "extract"},
-      {Op::BV_REPEAT, "repeat"},
-      {Op::BV_ROTATE_LEFT, "rotate_left"},
-      {Op::BV_ROTATE_RIGHT, "rotate_right"},
-      {Op::BV_SIGN_EXTEND, "sign_extend"},
-      {Op::BV_ZERO_EXTEND, "zero_extend"},
-
-      {Op::BV_ADD, "bvadd"},
-      {Op::BV_AND, "bvand"},
-      {Op::BV_ASHR, "bvashr"},
-      {Op::BV_COMP, "bvcomp"},
-      {Op::BV_CONCAT, "concat"},
-      {Op::BV_LSHR, "bvlshr"},
-      {Op::BV_MULT, "bvmul"},
-      {Op::BV_NAND, "bvnand"},
-      {Op::BV_NEG, "bvneg"},
-      {Op::BV_NOR, "bvnor"},
-      {Op::BV_NOT, "bvnot"},
-      {Op::BV_OR, "bvor"},
-      {Op::BV_SDIV, "bvsdiv"},
-      {Op::BV_SGE, "bvsge"},
-      {Op::BV_SGT, "bvsgt"},
-      {Op::BV_SHL, "bvshl"},
-      {Op::BV_SLE, "bvsle"},
-      {Op::BV_SLT, "bvslt"},
-      {Op::BV_SMOD, "bvsmod"},
-      {Op::BV_SREM, "bvsrem"},
-      {Op::BV_SUB, "bvsub"},
-      {Op::BV_UDIV, "bvudiv"},
-      {Op::BV_UGE, "bvuge"},
-      {Op::BV_UGT, "bvugt"},
-      {Op::BV_ULE, "bvule"},
-      {Op::BV_ULT, "bvult"},
-      {Op::BV_UREM, "bvurem"},
-      {Op::BV_XNOR, "bvxnor"},
-      {Op::BV_XOR, "bvxor"},
-
-      /* Datatypes */
-      {Op::DT_APPLY_TESTER, "is"},
-      {Op::DT_APPLY_UPDATER, "update"},
-      {Op::DT_MATCH, "match"},
-      {Op::DT_MATCH_BIND_CASE, ""},
-      {Op::DT_MATCH_CASE, ""},
-
-      /* FP */
-      {Op::FP_TO_FP_FROM_BV, "to_fp"},
-      {Op::FP_TO_FP_FROM_SBV, "to_fp"},
-      {Op::FP_TO_FP_FROM_FP, "to_fp"},
-      {Op::FP_TO_FP_FROM_UBV, "to_fp_unsigned"},
-      {Op::FP_TO_FP_FROM_REAL, "to_fp"},
-      {Op::FP_TO_SBV, "fp.to_sbv"},
-      {Op::FP_TO_UBV, "fp.to_ubv"},
-
-      {Op::FP_ABS, "fp.abs"},
-      {Op::FP_ADD, "fp.add"},
-      {Op::FP_DIV, "fp.div"},
-      {Op::FP_EQ, "fp.eq"},
-      {Op::FP_FMA, "fp.fma"},
-      {Op::FP_FP, "fp"},
-      {Op::FP_IS_NORMAL, "fp.isNormal"},
-      {Op::FP_IS_SUBNORMAL, "fp.isSubnormal"},
-      {Op::FP_IS_INF, "fp.isInfinite"},
-      {Op::FP_IS_NAN, "fp.isNaN"},
-      {Op::FP_IS_NEG, "fp.isNegative"},
-      {Op::FP_IS_POS, "fp.isPositive"},
-      {Op::FP_IS_ZERO, "fp.isZero"},
-      {Op::FP_LT, "fp.lt"},
-      {Op::FP_LEQ, "fp.leq"},
-      {Op::FP_GT, "fp.gt"},
-      {Op::FP_GEQ, "fp.geq"},
-      {Op::FP_MAX, "fp.max"},
-      {Op::FP_MIN, "fp.min"},
-      {Op::FP_MUL, "fp.mul"},
-      {Op::FP_NEG, "fp.neg"},
-      {Op::FP_REM, "fp.rem"},
-      {Op::FP_RTI, "fp.roundToIntegral"},
-      {Op::FP_SQRT, "fp.sqrt"},
-      {Op::FP_SUB, "fp.sub"},
-      {Op::FP_TO_REAL, "fp.to_real"},
-
-      /* Ints */
-      {Op::INT_IS_DIV, "divisible"},
-      {Op::INT_NEG, "-"},
-      {Op::INT_SUB, "-"},
-      {Op::INT_ADD, "+"},
-      {Op::INT_MUL, "*"},
-      {Op::INT_DIV, "div"},
-      {Op::INT_MOD, "mod"},
-      {Op::INT_ABS, "abs"},
-      {Op::INT_LT, "<"},
-      {Op::INT_LTE, "<="},
-      {Op::INT_GT, ">"},
-      {Op::INT_GTE, ">="},
-
-      /* Reals */
-      {Op::REAL_NEG, "-"},
-      {Op::REAL_SUB, "-"},
-      {Op::REAL_ADD, "+"},
-      {Op::REAL_MUL, "*"},
-      {Op::REAL_DIV, "/"},
-      {Op::REAL_LT, "<"},
-      {Op::REAL_LTE, "<="},
-      {Op::REAL_GT, ">"},
-      {Op::REAL_GTE, ">="},
-      {Op::REAL_IS_INT, "is_int"},
-
-      /* Reals and Ints */
-      {Op::INT_TO_REAL, "to_real"},
-      {Op::REAL_IS_INT, "is_int"},
-      {Op::REAL_TO_INT, "to_int"},
-
-      /* Quantifiers */
-      {Op::FORALL, "forall"},
-      {Op::EXISTS, "exists"},
-
-      /* Sequences */
-      {Op::SEQ_CONCAT, "seq.++"},
-      {Op::SEQ_LENGTH, "seq.len"},
-      {Op::SEQ_EXTRACT, "seq.extract"},
-      {Op::SEQ_UPDATE, "seq.update"},
-      {Op::SEQ_AT, "seq.at"},
-      {Op::SEQ_CONTAINS, "seq.contains"},
-      {Op::SEQ_INDEXOF, "seq.indexof"},
-      {Op::SEQ_REPLACE, "seq.replace"},
-      {Op::SEQ_REPLACE_ALL, "seq.replace_all"},
-      {Op::SEQ_REV, "seq.rev"},
-      {Op::SEQ_PREFIX, "seq.prefixof"},
-      {Op::SEQ_SUFFIX, "seq.suffixof"},
-      {Op::SEQ_UNIT, "seq.unit"},
-      {Op::SEQ_NTH, "seq.nth"},
-
-      /* Sets */
-      {Op::SET_CARD, "set.card"},
-      {Op::SET_COMPLEMENT, "set.complement"},
-      {Op::SET_COMPREHENSION, "set.comprehension"},
-      {Op::SET_CHOOSE, "set.choose"},
-      {Op::SET_INTERSECTION, "set.inter"},
-      {Op::SET_INSERT, "set.insert"},
-      {Op::SET_IS_SINGLETON, "set.is_singleton"},
-      {Op::SET_UNION, "set.union"},
-      {Op::SET_MEMBER, "set.member"},
-      {Op::SET_MINUS, "set.minus"},
-      {Op::SET_SINGLETON, "set.singleton"},
-      {Op::SET_SUBSET, "set.subset"},
-      /* Strings */
-      {Op::STR_CONCAT, "str.++"},
-      {Op::STR_LEN, "str.len"},
-      {Op::STR_LT, "str.<"},
-      {Op::STR_TO_RE, "str.to_re"},
-      {Op::STR_IN_RE, "str.in_re"},
-      {Op::STR_LE, "str.<="},
-      {Op::STR_AT, "str.at"},
-      {Op::STR_SUBSTR, "str.substr"},
-      {Op::STR_PREFIXOF, "str.prefixof"},
-      {Op::STR_SUFFIXOF, "str.suffixof"},
-      {Op::STR_CONTAINS, "str.contains"},
-      {Op::STR_INDEXOF, "str.indexof"},
-      {Op::STR_REPLACE, "str.replace"},
-      {Op::STR_REPLACE_ALL, "str.replace_all"},
-      {Op::STR_REPLACE_RE, "str.replace_re"},
-      {Op::STR_REPLACE_RE_ALL, "str.replace_re_all"},
-      {Op::STR_IS_DIGIT, "str.is_digit"},
-      {Op::STR_TO_CODE, "str.to_code"},
-      {Op::STR_FROM_CODE, "str.from_code"},
-      {Op::STR_TO_INT, "str.to_int"},
-      {Op::STR_FROM_INT, "str.from_int"},
-      {Op::RE_ALL, "re.all"},
-      {Op::RE_ALLCHAR, "re.allchar"},
-      {Op::RE_CONCAT, "re.++"},
-      {Op::RE_COMP, "re.comp"},
-      {Op::RE_DIFF, "re.diff"},
-      {Op::RE_INTER, "re.inter"},
-      {Op::RE_LOOP, "re.loop"},
-      {Op::RE_NONE, "re.none"},
-      {Op::RE_OPT, "re.opt"},
-      {Op::RE_PLUS, "re.+"},
-      {Op::RE_POW, "re.^"},
-      {Op::RE_RANGE, "re.range"},
-      {Op::RE_STAR, "re.*"},
-      {Op::RE_UNION, "re.union"},
-      /* Transcendentals */
-      {Op::TRANS_PI, "real.pi"},
-      {Op::TRANS_SINE, "sin"},
-      {Op::TRANS_COSINE, "cos"},
-      {Op::TRANS_TANGENT, "tan"},
-      {Op::TRANS_COTANGENT, "cot"},
-      {Op::TRANS_SECANT, "sec"},
-      {Op::TRANS_COSECANT, "csc"},
-      {Op::TRANS_ARCSINE, "arcsin"},
-      {Op::TRANS_ARCCOSINE, "arccos"},
-      {Op::TRANS_ARCTANGENT, "arctan"},
-      {Op::TRANS_ARCCOSECANT, "arccsc"},
-      {Op::TRANS_ARCSECANT, "arcsec"},
-      {Op::TRANS_ARCCOTANGENT, "arccot"},
-      {Op::TRANS_SQRT, "sqrt"},
-      /* UF */
-      {Op::UF_APPLY, ""},
-#ifdef MURXLA_USE_CVC5
-      /* cvc5-specific operator kinds */
-      {cvc5::Cvc5Term::OP_BV_REDAND, "bvredand"},
-      {cvc5::Cvc5Term::OP_BV_REDOR, "bvredor"},
-      {cvc5::Cvc5Term::OP_INT_TO_BV, "int2bv"},
-      {cvc5::Cvc5Term::OP_BV_TO_NAT, "bv2nat"},
-      {cvc5::Cvc5Term::OP_INT_IAND, "iand"},
-      {cvc5::Cvc5Term::OP_INT_POW2, "int.pow2"},
-      {cvc5::Cvc5Term::OP_STRING_UPDATE, "str.update"},
-      {cvc5::Cvc5Term::OP_STRING_TOLOWER, "str.tolower"},
-      {cvc5::Cvc5Term::OP_STRING_TOUPPER, "str.toupper"},
-      {cvc5::Cvc5Term::OP_STRING_REV, "str.rev"},
-#endif
+/* -------------------------------------------------------------------------- */
+/* Smt2Printer                                                                */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * The persistent printing context of the SMT2 solver.
+ *
+ * Non-leaf subterms that occur more than once in a printed term, or that have
+ * already been printed by an earlier command, are printed only once. Such
+ * subterms are bound to a fresh name via a define-fun command if they contain
+ * no variables, and referred to by this name from then on. Shared subterms
+ * that contain variables are bound via let within the printed term.
+ */
+class Smt2Printer
+{
+ public:
+  /**
+   * Print given term.
+   *
+   * The define-fun commands for subterms that are newly bound by this call
+   * are added to the pending definitions, which must be dumped before the
+   * command that contains the term (see take_definitions()).
+   *
+   * Commands that require the solver to be in sat mode (e.g., get-value)
+   * must not be preceded by definitions, since a define-fun leaves sat mode.
+   * Terms of such commands are printed with define = false, which binds
+   * shared subterms via let instead (names bound by earlier definitions are
+   * still used).
+   *
+   * @param out    The output stream.
+   * @param term   The term to print.
+   * @param define True to bind shared subterms without variables via
+   *               define-fun, false to bind all shared subterms via let.
+   */
+  void print(std::ostream& out, const Term& term, bool define = true);
+  /**
+   * Get and clear the pending define-fun commands.
+   * @return The pending define-fun commands, in the order they must be dumped.
+   */
+  std::vector<std::string> take_definitions();
+  /** Forget all names bound via define-fun, e.g., after a reset. */
+  void reset();
+
+ private:
+  /** The persistent information about a printed (sub)term. */
+  struct Info
+  {
+    /** The term, to keep it (and thus its address) alive. */
+    Term d_term;
+    /** The name bound to this term via define-fun, if any. */
+    std::string d_name;
+    /** True if this term has been printed in full (not as a name). */
+    bool d_printed = false;
+    /** 1 if this term contains variables, 0 if not, -1 if unknown. */
+    int8_t d_has_vars = -1;
   };
+
+  /** An element of the stack of pending output of print_inline(). */
+  struct Task
+  {
+    /** The term to print, nullptr if d_text is to be printed. */
+    const Term* d_term;
+    /** The text to print if d_term is nullptr. */
+    std::string d_text;
+  };
+
+  /** @return True if given term is printed via its representation string. */
+  static bool is_leaf(const Smt2Term* term);
+  /** @return True if given term contains variables. */
+  bool has_vars(const Term& term);
+  /**
+   * Print given term, using the names of subterms that are bound via
+   * define-fun or let.
+   */
+  void print_inline(std::ostream& out, const Term& term);
+  /**
+   * Add the output of given non-leaf term to the stack of pending output,
+   * with tasks for its arguments.
+   */
+  void push_tasks(const Smt2Term* term);
+
+  /** The information about printed (sub)terms. */
+  std::unordered_map<const Smt2Term*, Info> d_info;
+  /** The pending define-fun commands. */
+  std::vector<std::string> d_definitions;
+  /** The number of names bound via define-fun so far. */
+  uint64_t d_n_definitions = 0;
+
+  /** The names bound via let in the term currently printed. */
+  std::unordered_map<const Smt2Term*, std::string> d_lets;
+  /** The number of references to subterms in the term currently printed. */
+  std::unordered_map<const Smt2Term*, uint32_t> d_refs;
+  /** The visited subterms of the term currently printed. */
+  std::unordered_set<const Smt2Term*> d_visited;
+  /** The stack of pending output of print_inline(). */
+  std::vector<Task> d_tasks;
+  /** Buffer for the tasks of a single term, see push_tasks(). */
+  std::vector<Task> d_term_tasks;
+};
+
+/* -------------------------------------------------------------------------- */
+/* Smt2Process                                                                */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * The process of an external online solver, connected via pipes to its stdin
+ * and stdout/stderr.
+ *
+ * A persistent process is started by the main process and reused by all test
+ * runs of a worker, which reset it at the beginning of each run (see
+ * Smt2Solver::new_solver()).
+ */
+class Smt2Process
+{
+ public:
+  /**
+   * Start the process.
+   * @param solver_call The solver binary and its arguments, separated by
+   *                    spaces.
+   */
+  void start(const std::string& solver_call);
+  /** Kill the process, wait for it to terminate and close the pipes. */
+  void stop();
+  /** Wait for the process to terminate and close the pipes. */
+  void wait();
+  /**
+   * Determine if the process is running. Closes the pipes if the process
+   * terminated.
+   * @return True if the process is running.
+   */
+  bool is_running();
+
+  /** @return The process id, 0 if the process was not started. */
+  pid_t get_pid() const { return d_pid; }
+  /** @return The write end of the pipe to stdin of the process. */
+  int32_t get_fd_to() const { return d_fd_to; }
+  /** @return The read end of the pipe from stdout/stderr of the process. */
+  int32_t get_fd_from() const { return d_fd_from; }
+
+ private:
+  /** Close the pipes. */
+  void close_fds();
+
+  static constexpr int32_t SMT2_READ_END  = 0;
+  static constexpr int32_t SMT2_WRITE_END = 1;
+
+  pid_t d_pid       = 0;
+  int32_t d_fd_to   = -1;
+  int32_t d_fd_from = -1;
 };
 
 /* -------------------------------------------------------------------------- */
@@ -389,9 +301,23 @@ class Smt2Term : public AbsTerm
 class Smt2Solver : public Solver
 {
  public:
+  /**
+   * Constructor.
+   * @param sng           The solver seed generator.
+   * @param out           The output stream to print SMT-LIB 2 to.
+   * @param solver_binary The solver binary to pipe the SMT-LIB 2 output to
+   *                      (online mode), empty if none.
+   * @param pipelined     True to not wait for the 'success' responses of the
+   *                      online solver before sending the next command, see
+   *                      push_to_external().
+   * @param process       The persistent online solver process to use instead
+   *                      of starting a new process, nullptr if none.
+   */
   Smt2Solver(SolverSeedGenerator& sng,
              std::ostream& out,
-             const std::string& solver_binary);
+             const std::string& solver_binary,
+             bool pipelined       = false,
+             Smt2Process* process = nullptr);
   ~Smt2Solver() override;
 
   void new_solver() override;
@@ -399,6 +325,7 @@ class Smt2Solver : public Solver
   bool is_initialized() const override;
   const std::string get_name() const override;
   const std::string get_profile() const override;
+  bool is_thread_safe() const override;
 
   Term mk_var(Sort sort, const std::string& name) override;
   Term mk_const(Sort sort, const std::string& name) override;
@@ -485,14 +412,56 @@ class Smt2Solver : public Solver
     SMT2_SEXPR,
   };
 
+  /**
+   * Send command to the online solver and check its response.
+   *
+   * In pipelined mode, commands that only expect a 'success' response are
+   * queued without waiting for the response. Queued responses are checked
+   * whenever they are available, and all of them before sending a command
+   * that expects any other response.
+   */
   void push_to_external(std::string s, ResponseKind expected);
-  std::string get_from_external() const;
+  /**
+   * Read the next response of the online solver.
+   *
+   * Either reads one line or an s-expression if the first character of the
+   * response is '('. Returns "[EOF]" if the solver closed its output.
+   *
+   * @param res   The response, if a complete response is available.
+   * @param block True to block until a complete response is available.
+   * @param echo  True to echo the response as comment to the SMT2 output.
+   * @return True if a complete response was read.
+   */
+  bool get_from_external(std::string& res, bool block, bool echo = true);
+  /**
+   * Check the 'success' responses of queued commands, in order.
+   * @param block True to block until all queued commands are checked, false
+   *              to only check the responses that are already available.
+   */
+  void check_pending_external(bool block);
+  /**
+   * Check that the given response of the online solver to the given
+   * command is 'success'.
+   */
+  void check_success_external(const std::string& res, const std::string& cmd);
+  /**
+   * Reset the persistent online solver and discard all of its output that
+   * was not consumed by previous test runs.
+   */
+  void sync_external();
   void dump_smt2(std::string s,
                  ResponseKind expected = ResponseKind::SMT2_SUCCESS);
+  /** Dump the pending define-fun commands of the printer. */
+  void dump_definitions();
   std::ostream& d_out = std::cout;
   bool d_online       = false;
+  bool d_pipelined    = false;
   FILE* d_file_to     = nullptr;
-  FILE* d_file_from   = nullptr;
+  int32_t d_fd_from   = -1;
+  /** The responses of the online solver read but not yet consumed. */
+  std::string d_from_buffer;
+  /** The commands whose 'success' response has not yet been checked. */
+  std::deque<std::string> d_pending;
 
   bool d_initialized               = false;
   bool d_incremental               = false;
@@ -505,12 +474,21 @@ class Smt2Solver : public Solver
   uint64_t d_define_sort_param_cnt = 0;
   Solver::Result d_last_result     = Solver::Result::UNKNOWN;
 
-  static constexpr int32_t SMT2_READ_END  = 0;
-  static constexpr int32_t SMT2_WRITE_END = 1;
+  /**
+   * The maximum number of queued commands in pipelined mode. Bounded to
+   * ensure that the online solver never blocks on writing responses that we
+   * do not read.
+   */
+  static constexpr size_t SMT2_MAX_PENDING = 256;
 
-  pid_t d_online_pid = 0;
+  /** The online solver process, if not persistent. */
+  Smt2Process d_process;
+  /** The persistent online solver process, nullptr if none. */
+  Smt2Process* d_persistent = nullptr;
   std::string d_solver_call;
   std::unordered_map<std::string, std::string> d_sort_fun_map;
+  /** The printing context for terms. */
+  Smt2Printer d_printer;
 };
 
 /* -------------------------------------------------------------------------- */
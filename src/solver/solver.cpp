@@ -25,7 +25,8 @@ namespace murxla {
 void
 AbsSort::set_id(uint64_t id)
 {
-  d_id = id;
+  d_id         = id;
+  d_hash_valid = false;
 }
 
 uint64_t
@@ -34,6 +35,17 @@ AbsSort::get_id() const
   return d_id;
 }
 
+size_t
+AbsSort::get_hash() const
+{
+  if (!d_hash_valid)
+  {
+    d_hash       = hash();
+    d_hash_valid = true;
+  }
+  return d_hash;
+}
+
 void
 AbsSort::set_kind(SortKind sort_kind)
 {
@@ -635,7 +647,8 @@ AbsTerm::get_children() const
 void
 AbsTerm::set_id(uint64_t id)
 {
-  d_id = id;
+  d_id         = id;
+  d_hash_valid = false;
 }
 
 uint64_t
@@ -644,6 +657,17 @@ AbsTerm::get_id() const
   return d_id;
 }
 
+size_t
+AbsTerm::get_hash() const
+{
+  if (!d_hash_valid)
+  {
+    d_hash       = hash();
+    d_hash_valid = true;
+  }
+  return d_hash;
+}
+
 void
 AbsTerm::set_sort(Sort sort)
 {
@@ -797,6 +821,8 @@ operator<<(std::ostream& out, const std::vector<Term>& vector)
 
 Solver::Solver(SolverSeedGenerator& sng) : d_rng(sng.seed())
 {
+  /* Solver wrappers pick random strings, e.g., for FP values. */
+  d_rng.set_compat_sampling(sng.is_compat_sampling());
   for (const auto& it : d_special_values)
   {
     if (!it.second.empty())
@@ -940,13 +966,13 @@ namespace std {
 size_t
 hash<murxla::Sort>::operator()(const murxla::Sort& s) const
 {
-  return s->hash();
+  return s->get_hash();
 };
 
 size_t
 hash<murxla::Term>::operator()(const murxla::Term& t) const
 {
-  return t->hash();
+  return t->get_hash();
 };
 
 }  // namespace std
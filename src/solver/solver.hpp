@@ -386,6 +386,17 @@ class AbsSort
    */
   uint64_t get_id() const;
 
+  /**
+   * Get the hash value of this sort.
+   *
+   * This caches the result of hash() on first use, which avoids calling into
+   * the solver on every lookup in hash-based containers. The cache is reset
+   * when the id of this sort is set, since hash() may depend on it.
+   *
+   * @return  The hash value of this sort.
+   */
+  size_t get_hash() const;
+
   /**
    * Get the kind of this sort.
    * @return The kind of this sort.
@@ -491,6 +502,12 @@ class AbsSort
   DatatypeConstructorMap d_dt_ctors;
   /** True if this is an instantiated parametric datatype sort. */
   bool d_dt_is_instantiated = false;
+
+ private:
+  /** The cached hash value of this sort, valid if d_hash_valid is true. */
+  mutable size_t d_hash = 0;
+  /** True if d_hash is valid. */
+  mutable bool d_hash_valid = false;
 };
 
 /**
@@ -1094,6 +1111,17 @@ class AbsTerm
    */
   uint64_t get_id() const;
 
+  /**
+   * Get the hash value of this term.
+   *
+   * This caches the result of hash() on first use, which avoids calling into
+   * the solver on every lookup in hash-based containers. The cache is reset
+   * when the id of this term is set, since hash() may depend on it.
+   *
+   * @return  The hash value of this term.
+   */
+  size_t get_hash() const;
+
   /**
    * Get the sort of this term.
    * @return  The sort of this term.
@@ -1129,6 +1157,10 @@ class AbsTerm
    * SPECIAL_VALUE_NONE if this term is not a value or no special value.
    */
   SpecialValueKind d_value_kind = SPECIAL_VALUE_NONE;
+  /** The cached hash value of this term, valid if d_hash_valid is true. */
+  mutable size_t d_hash = 0;
+  /** True if d_hash is valid. */
+  mutable bool d_hash_valid = false;
 };
 
 /** The Murxla-internal representation of a term. */
@@ -1885,6 +1917,17 @@ class Solver
     return {};
   }
 
+  /**
+   * Determine if the wrapped solver can be called from a thread other than
+   * the thread that created it, while other solver instances are called
+   * concurrently. This is required for concurrent cross-checking.
+   *
+   * False by default.
+   *
+   * @return  True if the wrapped solver is thread-safe.
+   */
+  virtual bool is_thread_safe() const { return false; }
+
   /** @} */
 
   /* NOT to be overriden, murxla level.                                     */
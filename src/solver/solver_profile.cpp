@@ -110,8 +110,32 @@ SolverProfile::merge(const std::string& json_str1, const std::string& json_str2)
   return j1.dump();
 }
 
-TheoryVector
+const TheoryVector&
 SolverProfile::get_supported_theories() const
+{
+  return get_data().d_supported_theories;
+}
+
+const std::unordered_map<Theory, std::vector<Theory>>&
+SolverProfile::get_unsupported_theory_combinations() const
+{
+  return get_data().d_unsupported_theory_combinations;
+}
+
+const OpKindSet&
+SolverProfile::get_unsupported_op_kinds() const
+{
+  return get_data().d_unsupported_op_kinds;
+}
+
+const SolverProfile::OpKindSortKindMap&
+SolverProfile::get_unsupported_op_sort_kinds() const
+{
+  return get_data().d_unsupported_op_sort_kinds;
+}
+
+TheoryVector
+SolverProfile::parse_supported_theories() const
 {
   TheorySet solver_theories;
   for (const std::string& t : get_array({KEY_THEORIES, "include"}, true))
@@ -125,7 +149,7 @@ SolverProfile::get_supported_theories() const
 }
 
 std::unordered_map<Theory, std::vector<Theory>>
-SolverProfile::get_unsupported_theory_combinations() const
+SolverProfile::parse_unsupported_theory_combinations() const
 {
   std::unordered_map<Theory, std::vector<Theory>> unsupported;
 
@@ -158,7 +182,7 @@ SolverProfile::get_unsupported_theory_combinations() const
 }
 
 OpKindSet
-SolverProfile::get_unsupported_op_kinds() const
+SolverProfile::parse_unsupported_op_kinds() const
 {
   OpKindSet unsupported;
   if (has_key(KEY_OPERATORS))
@@ -171,7 +195,7 @@ SolverProfile::get_unsupported_op_kinds() const
 }
 
 SolverProfile::OpKindSortKindMap
-SolverProfile::get_unsupported_op_sort_kinds() const
+SolverProfile::parse_unsupported_op_sort_kinds() const
 {
   auto it = d_json.find(KEY_OPERATORS);
   if (it == d_json.end())
@@ -203,105 +227,116 @@ SolverProfile::get_unsupported_op_sort_kinds() const
   return unsupported;
 }
 
-SortKindSet
+const SortKindSet&
 SolverProfile::get_unsupported_sort_kinds() const
 {
-  return get_sort_kinds({KEY_SORTS, "exclude"});
+  return get_data().d_unsupported_sort_kinds;
 }
 
-SortKindSet
+const SortKindSet&
 SolverProfile::get_unsupported_var_sort_kinds() const
 {
-  return get_sort_kinds({KEY_SORTS, "var", "exclude"});
+  return get_data().d_unsupported_var_sort_kinds;
 }
 
-SortKindSet
+const SortKindSet&
 SolverProfile::get_unsupported_array_index_sort_kinds() const
 {
-  return get_sort_kinds({KEY_SORTS, "array-index", "exclude"});
+  return get_data().d_unsupported_array_index_sort_kinds;
 }
 
-SortKindSet
+const SortKindSet&
 SolverProfile::get_unsupported_array_element_sort_kinds() const
 {
-  return get_sort_kinds({KEY_SORTS, "array-element", "exclude"});
+  return get_data().d_unsupported_array_element_sort_kinds;
 }
 
-SortKindSet
+const SortKindSet&
 SolverProfile::get_unsupported_bag_element_sort_kinds() const
 {
-  return get_sort_kinds({KEY_SORTS, "bag-element", "exclude"});
+  return get_data().d_unsupported_bag_element_sort_kinds;
 }
 
-SortKindSet
+const SortKindSet&
 SolverProfile::get_unsupported_dt_match_sort_kinds() const
 {
-  return get_sort_kinds({KEY_SORTS, "datatype-match", "exclude"});
+  return get_data().d_unsupported_dt_match_sort_kinds;
 }
 
-SortKindSet
+const SortKindSet&
 SolverProfile::get_unsupported_dt_sel_codomain_sort_kinds() const
 {
-  return get_sort_kinds({KEY_SORTS, "datatype-selector-codomain", "exclude"});
+  return get_data().d_unsupported_dt_sel_codomain_sort_kinds;
 }
 
-SortKindSet
+const SortKindSet&
 SolverProfile::get_unsupported_fun_codomain_sort_kinds() const
 {
-  return get_sort_kinds({KEY_SORTS, "fun-codomain", "exclude"});
+  return get_data().d_unsupported_fun_codomain_sort_kinds;
 }
 
-SortKindSet
+const SortKindSet&
 SolverProfile::get_unsupported_fun_domain_sort_kinds() const
 {
-  return get_sort_kinds({KEY_SORTS, "fun-domain", "exclude"});
+  return get_data().d_unsupported_fun_domain_sort_kinds;
 }
 
-SortKindSet
+const SortKindSet&
 SolverProfile::get_unsupported_fun_sort_codomain_sort_kinds() const
 {
-  return get_sort_kinds({KEY_SORTS, "fun-sort-codomain", "exclude"});
+  return get_data().d_unsupported_fun_sort_codomain_sort_kinds;
 }
 
-SortKindSet
+const SortKindSet&
 SolverProfile::get_unsupported_fun_sort_domain_sort_kinds() const
 {
-  return get_sort_kinds({KEY_SORTS, "fun-sort-domain", "exclude"});
+  return get_data().d_unsupported_fun_sort_domain_sort_kinds;
 }
 
-SortKindSet
+const SortKindSet&
 SolverProfile::get_unsupported_get_value_sort_kinds() const
 {
-  return get_sort_kinds({KEY_SORTS, "get-value", "exclude"});
+  return get_data().d_unsupported_get_value_sort_kinds;
 }
 
-SortKindSet
+const SortKindSet&
 SolverProfile::get_unsupported_seq_element_sort_kinds() const
 {
-  return get_sort_kinds({KEY_SORTS, "seq-element", "exclude"});
+  return get_data().d_unsupported_seq_element_sort_kinds;
 }
 
-SortKindSet
+const SortKindSet&
 SolverProfile::get_unsupported_set_element_sort_kinds() const
 {
-  return get_sort_kinds({KEY_SORTS, "set-element", "exclude"});
+  return get_data().d_unsupported_set_element_sort_kinds;
 }
 
-SortKindSet
+const SortKindSet&
 SolverProfile::get_unsupported_sort_param_sort_kinds() const
 {
-  return get_sort_kinds({KEY_SORTS, "sort-param", "exclude"});
+  return get_data().d_unsupported_sort_param_sort_kinds;
 }
 
-std::vector<std::string>
+const std::vector<std::string>&
 SolverProfile::get_excluded_errors() const
+{
+  return get_data().d_excluded_errors;
+}
+
+const std::vector<std::string>&
+SolverProfile::get_error_filters() const
+{
+  return get_data().d_error_filters;
+}
+
+std::vector<std::string>
+SolverProfile::parse_errors(const std::string& key) const
 {
   std::vector<std::string> errors;
-  // Load excluded errors
   auto it = d_json.find(KEY_ERRORS);
   if (it != d_json.end())
   {
-    auto itt = it->find("exclude");
+    auto itt = it->find(key);
     if (itt != it->end() && itt->is_array())
     {
       for (const auto& err : *itt)
@@ -313,24 +348,50 @@ SolverProfile::get_excluded_errors() const
   return errors;
 }
 
-std::vector<std::string>
-SolverProfile::get_error_filters() const
+const SolverProfile::Data&
+SolverProfile::get_data() const
 {
-  std::vector<std::string> filters;
-  // Load error filters
-  auto it = d_json.find(KEY_ERRORS);
-  if (it != d_json.end())
+  if (!d_data)
   {
-    auto itt = it->find("filter");
-    if (itt != it->end() && itt->is_array())
-    {
-      for (const auto& err : *itt)
-      {
-        filters.emplace_back(err.get<std::string>());
-      }
-    }
+    d_data.reset(new Data());
+    d_data->d_supported_theories = parse_supported_theories();
+    d_data->d_unsupported_theory_combinations =
+        parse_unsupported_theory_combinations();
+    d_data->d_unsupported_op_kinds      = parse_unsupported_op_kinds();
+    d_data->d_unsupported_op_sort_kinds = parse_unsupported_op_sort_kinds();
+    d_data->d_unsupported_sort_kinds = get_sort_kinds({KEY_SORTS, "exclude"});
+    d_data->d_unsupported_var_sort_kinds =
+        get_sort_kinds({KEY_SORTS, "var", "exclude"});
+    d_data->d_unsupported_array_index_sort_kinds =
+        get_sort_kinds({KEY_SORTS, "array-index", "exclude"});
+    d_data->d_unsupported_array_element_sort_kinds =
+        get_sort_kinds({KEY_SORTS, "array-element", "exclude"});
+    d_data->d_unsupported_bag_element_sort_kinds =
+        get_sort_kinds({KEY_SORTS, "bag-element", "exclude"});
+    d_data->d_unsupported_dt_match_sort_kinds =
+        get_sort_kinds({KEY_SORTS, "datatype-match", "exclude"});
+    d_data->d_unsupported_dt_sel_codomain_sort_kinds =
+        get_sort_kinds({KEY_SORTS, "datatype-selector-codomain", "exclude"});
+    d_data->d_unsupported_fun_codomain_sort_kinds =
+        get_sort_kinds({KEY_SORTS, "fun-codomain", "exclude"});
+    d_data->d_unsupported_fun_domain_sort_kinds =
+        get_sort_kinds({KEY_SORTS, "fun-domain", "exclude"});
+    d_data->d_unsupported_fun_sort_codomain_sort_kinds =
+        get_sort_kinds({KEY_SORTS, "fun-sort-codomain", "exclude"});
+    d_data->d_unsupported_fun_sort_domain_sort_kinds =
+        get_sort_kinds({KEY_SORTS, "fun-sort-domain", "exclude"});
+    d_data->d_unsupported_get_value_sort_kinds =
+        get_sort_kinds({KEY_SORTS, "get-value", "exclude"});
+    d_data->d_unsupported_seq_element_sort_kinds =
+        get_sort_kinds({KEY_SORTS, "seq-element", "exclude"});
+    d_data->d_unsupported_set_element_sort_kinds =
+        get_sort_kinds({KEY_SORTS, "set-element", "exclude"});
+    d_data->d_unsupported_sort_param_sort_kinds =
+        get_sort_kinds({KEY_SORTS, "sort-param", "exclude"});
+    d_data->d_excluded_errors = parse_errors("exclude");
+    d_data->d_error_filters   = parse_errors("filter");
   }
-  return filters;
+  return *d_data;
 }
 
 void
@@ -10,6 +10,7 @@
 #ifndef __MURXLA__SOLVER_PROFILE_H
 #define __MURXLA__SOLVER_PROFILE_H
 
+#include <memory>
 #include <nlohmann/json.hpp>
 #include <string>
 #include <unordered_set>
@@ -34,7 +35,7 @@ class SolverProfile
    * Get the set of supported theories of the wrapped solver.
    * @return  A vector with the set of supported theories.
    */
-  TheoryVector get_supported_theories() const;
+  const TheoryVector& get_supported_theories() const;
 
   /** Get list of unsupported theory combinations. */
   /**
@@ -44,14 +45,14 @@ class SolverProfile
    *
    * @return  A map of theories to a list of unsupported theory combinations.
    */
-  std::unordered_map<Theory, std::vector<Theory>>
+  const std::unordered_map<Theory, std::vector<Theory>>&
   get_unsupported_theory_combinations() const;
 
   /**
    * Get the set of unsupported operator kinds (see Op::Kind).
    * @return  A vector with the set of unsupported operator kinds.
    */
-  OpKindSet get_unsupported_op_kinds() const;
+  const OpKindSet& get_unsupported_op_kinds() const;
 
   /**
    * Get operator sort restrictions.
@@ -65,13 +66,13 @@ class SolverProfile
    * @return  A map from operator kind (Op::Kind) to a set of excluded sort
    *          kinds (murxla::SortKind).
    */
-  OpKindSortKindMap get_unsupported_op_sort_kinds() const;
+  const OpKindSortKindMap& get_unsupported_op_sort_kinds() const;
 
   /**
    * Get the set of unsupported sort kinds (see murxla::SortKind).
    * @return  A vector with the set of unsupported sort kinds.
    */
-  SortKindSet get_unsupported_sort_kinds() const;
+  const SortKindSet& get_unsupported_sort_kinds() const;
 
   /**
    * Get the set of sort kinds that are unsupported for quantified variables.
@@ -83,7 +84,7 @@ class SolverProfile
    * @return  A set of sort kinds (murxla::SortKind) that are unsupported for
    *          quantified variables.
    */
-  SortKindSet get_unsupported_var_sort_kinds() const;
+  const SortKindSet& get_unsupported_var_sort_kinds() const;
 
   /**
    * Get the set of sort kinds that are unsupported as index sort of array
@@ -92,7 +93,7 @@ class SolverProfile
    * @return  A set of sort kinds (murxla::SortKind) that are unsupported
    *          as array index sort.
    */
-  SortKindSet get_unsupported_array_index_sort_kinds() const;
+  const SortKindSet& get_unsupported_array_index_sort_kinds() const;
 
   /**
    * Get the set of sort kinds that are unsupported as element sort of
@@ -101,7 +102,7 @@ class SolverProfile
    * @return  A set of sort kinds (murxla::SortKind) that are unsupported
    *          as array element sort.
    */
-  SortKindSet get_unsupported_array_element_sort_kinds() const;
+  const SortKindSet& get_unsupported_array_element_sort_kinds() const;
 
   /**
    * Get the set of sort kinds that are unsupported as element sort of
@@ -110,7 +111,7 @@ class SolverProfile
    * @return  A set of sort kinds (murxla::SortKind) that are unsupported
    *          as bag element sort.
    */
-  SortKindSet get_unsupported_bag_element_sort_kinds() const;
+  const SortKindSet& get_unsupported_bag_element_sort_kinds() const;
 
   /**
    * Get the set of sort kinds that are unsupported as sort of match terms
@@ -119,7 +120,7 @@ class SolverProfile
    * @return  A set of sort kinds (murxla::SortKind) that are unsupported
    *          for match terms of operator Op::DT_MATCH.
    */
-  SortKindSet get_unsupported_dt_match_sort_kinds() const;
+  const SortKindSet& get_unsupported_dt_match_sort_kinds() const;
 
   /**
    * Get the set of sort kinds that are unsupported as datatype
@@ -128,7 +129,7 @@ class SolverProfile
    * @return  A set of sort kinds (murxla::SortKind) that are unsupported
    *          for datatype selector codomain sorts.
    */
-  SortKindSet get_unsupported_dt_sel_codomain_sort_kinds() const;
+  const SortKindSet& get_unsupported_dt_sel_codomain_sort_kinds() const;
 
   /**
    * Get set of unsupported codomain sort kinds for functions (see mk_fun()).
@@ -136,7 +137,7 @@ class SolverProfile
    * @return  A set of sort kinds (murxla::SortKind) that are unsupported
    *          as codomain sorts for function terms.
    */
-  SortKindSet get_unsupported_fun_codomain_sort_kinds() const;
+  const SortKindSet& get_unsupported_fun_codomain_sort_kinds() const;
 
   /**
    * Get set of unsupported domain sort kinds for functions (see mk_fun()).
@@ -144,7 +145,7 @@ class SolverProfile
    * @return  A set of sort kinds (murxla::SortKind) that are unsupported
    *          as domain sorts for function terms.
    */
-  SortKindSet get_unsupported_fun_domain_sort_kinds() const;
+  const SortKindSet& get_unsupported_fun_domain_sort_kinds() const;
 
   /**
    * Get set of unsupported codomain sort kinds for function sorts
@@ -153,7 +154,7 @@ class SolverProfile
    * @return  A set of sort kinds (murxla::SortKind) that are unsupported
    *          as codomain sort for function sorts.
    */
-  SortKindSet get_unsupported_fun_sort_codomain_sort_kinds() const;
+  const SortKindSet& get_unsupported_fun_sort_codomain_sort_kinds() const;
 
   /**
    * Get set of unsupported domain sort kinds for function sorts
@@ -162,7 +163,7 @@ class SolverProfile
    * @return  A set of sort kinds (murxla::SortKind) that are unsupported
    *          as domain sorts for function sorts.
    */
-  SortKindSet get_unsupported_fun_sort_domain_sort_kinds() const;
+  const SortKindSet& get_unsupported_fun_sort_domain_sort_kinds() const;
 
   /**
    * Get the set of sort kinds that are unsupported for get-value
@@ -171,7 +172,7 @@ class SolverProfile
    * @return  A set of sort kinds (murxla::SortKind) that are unsupported
    *          when querying the value of a term.
    */
-  SortKindSet get_unsupported_get_value_sort_kinds() const;
+  const SortKindSet& get_unsupported_get_value_sort_kinds() const;
 
   /**
    * Get the set of sort kinds that are unsupported as element sort of
@@ -180,7 +181,7 @@ class SolverProfile
    * @return  A set of sort kinds (murxla::SortKind) that are unsupported
    *          as sequence element sort.
    */
-  SortKindSet get_unsupported_seq_element_sort_kinds() const;
+  const SortKindSet& get_unsupported_seq_element_sort_kinds() const;
 
   /**
    * Get the set of sort kinds that are unsupported as element sort for
@@ -189,7 +190,7 @@ class SolverProfile
    * @return  A set of sort kinds (murxla::SortKind) that are unsupported
    *          as set element sort.
    */
-  SortKindSet get_unsupported_set_element_sort_kinds() const;
+  const SortKindSet& get_unsupported_set_element_sort_kinds() const;
 
   /**
    * Get the set of sort kinds that are unsupported as sort parameters
@@ -198,15 +199,48 @@ class SolverProfile
    * @return  A set of sort kinds (murxla::SortKind) that are unsupported for
    *          sort parameters.
    */
-  SortKindSet get_unsupported_sort_param_sort_kinds() const;
+  const SortKindSet& get_unsupported_sort_param_sort_kinds() const;
 
   /** Get list of errors to be filtered out (ignored).*/
-  std::vector<std::string> get_excluded_errors() const;
+  const std::vector<std::string>& get_excluded_errors() const;
 
   /** Get list of error filters.*/
-  std::vector<std::string> get_error_filters() const;
+  const std::vector<std::string>& get_error_filters() const;
 
  private:
+  /**
+   * The data of the solver profile, parsed from the JSON profile.
+   *
+   * This is parsed once on first access and cached. The solver profile is
+   * loaded by the main process, which forks the test runs, so all test runs
+   * share the parsed data and don't have to query the JSON profile again.
+   */
+  struct Data
+  {
+    TheoryVector d_supported_theories;
+    std::unordered_map<Theory, std::vector<Theory>>
+        d_unsupported_theory_combinations;
+    OpKindSet d_unsupported_op_kinds;
+    OpKindSortKindMap d_unsupported_op_sort_kinds;
+    SortKindSet d_unsupported_sort_kinds;
+    SortKindSet d_unsupported_var_sort_kinds;
+    SortKindSet d_unsupported_array_index_sort_kinds;
+    SortKindSet d_unsupported_array_element_sort_kinds;
+    SortKindSet d_unsupported_bag_element_sort_kinds;
+    SortKindSet d_unsupported_dt_match_sort_kinds;
+    SortKindSet d_unsupported_dt_sel_codomain_sort_kinds;
+    SortKindSet d_unsupported_fun_codomain_sort_kinds;
+    SortKindSet d_unsupported_fun_domain_sort_kinds;
+    SortKindSet d_unsupported_fun_sort_codomain_sort_kinds;
+    SortKindSet d_unsupported_fun_sort_domain_sort_kinds;
+    SortKindSet d_unsupported_get_value_sort_kinds;
+    SortKindSet d_unsupported_seq_element_sort_kinds;
+    SortKindSet d_unsupported_set_element_sort_kinds;
+    SortKindSet d_unsupported_sort_param_sort_kinds;
+    std::vector<std::string> d_excluded_errors;
+    std::vector<std::string> d_error_filters;
+  };
+
   static inline const std::string KEY_THEORIES = "theories";
   static inline const std::string KEY_THEORY_COMBINATIONS =
       "exclude-combinations";
@@ -223,6 +257,16 @@ class SolverProfile
 
   void parse();
 
+  /** Get the parsed profile data, parses the profile on first access. */
+  const Data& get_data() const;
+
+  TheoryVector parse_supported_theories() const;
+  std::unordered_map<Theory, std::vector<Theory>>
+  parse_unsupported_theory_combinations() const;
+  OpKindSet parse_unsupported_op_kinds() const;
+  OpKindSortKindMap parse_unsupported_op_sort_kinds() const;
+  std::vector<std::string> parse_errors(const std::string& key) const;
+
   bool has_key(const std::string& key) const;
 
   Theory to_theory(const std::string& str) const;
@@ -239,6 +283,9 @@ class SolverProfile
 
   std::unordered_map<std::string, Theory> d_str_to_theory;
   std::unordered_map<std::string, SortKind> d_str_to_sort_kind;
+
+  /** The cached profile data, nullptr if not parsed yet. */
+  mutable std::unique_ptr<Data> d_data;
 };
 
 }  // namespace murxla
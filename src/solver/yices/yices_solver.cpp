@@ -921,7 +921,7 @@ YicesSolver::mk_sort(SortKind kind, const std::vector<Sort>& sorts)
 //////
 
 Term
-YicesSolver::mk_term(const std::string& kind,
+YicesSolver::mk_term(const Op::Kind& kind,
                      const std::vector<Term>& args,
                      const std::vector<uint32_t>& indices)
 {
@@ -18,6 +18,7 @@
 #include "except.hpp"
 #include "solver/solver_profile.hpp"
 #include "statistics.hpp"
+#include "trace_buffer.hpp"
 
 namespace murxla {
 
@@ -68,6 +69,7 @@ SolverManager::initialize(bool smtlib_compliant)
   {
     d_solver->configure_opmgr(d_opmgr.get());
   }
+  d_op_index_ops.clear();
   reset_op_cache();
   d_initialized = true;
 }
@@ -93,9 +95,149 @@ SolverManager::clear()
 void
 SolverManager::reset_op_cache()
 {
-  const auto& kinds = d_opmgr->get_op_kinds();
-  d_available_op_kinds.insert(kinds.begin(), kinds.end());
-  d_enabled_op_kinds.clear();
+  if (d_rng.is_compat_sampling())
+  {
+    const auto& kinds = d_opmgr->get_op_kinds();
+    d_available_op_kinds.insert(kinds.begin(), kinds.end());
+    d_enabled_op_kinds.clear();
+  }
+  d_op_index_reset = true;
+}
+
+void
+SolverManager::update_op_index(SortKind sort_kind)
+{
+  assert(sort_kind != SORT_ANY);
+  SortKindMask mask = 1u << sort_kind;
+  /* Intermediate terms are not added to the term database. */
+  if (!(d_op_index_sort_kinds & mask) && d_term_db.has_term(sort_kind))
+  {
+    d_op_index_sort_kinds |= mask;
+    d_op_index_new_sort_kinds |= mask;
+  }
+}
+
+void
+SolverManager::update_op_index()
+{
+  if (d_op_index_reset)
+  {
+    const auto& kinds = d_opmgr->get_op_kinds();
+    if (d_op_index_ops.size() != kinds.size())
+    {
+      d_op_index_ops.assign(kinds.size(), nullptr);
+      d_op_index_args.assign(kinds.size(), {});
+      for (const auto& [kind, op] : kinds)
+      {
+        assert(op.d_id < kinds.size());
+        d_op_index_ops[op.d_id] = &op;
+        size_t n_args = op.d_arity < 0 ? 1 : op.d_arity;
+        for (size_t i = 0; i < n_args; ++i)
+        {
+          SortKindMask mask = 0;
+          for (SortKind sort_kind : op.get_arg_sort_kind(i))
+          {
+            assert(sort_kind != SORT_ANY);
+            mask |= 1u << sort_kind;
+          }
+          d_op_index_args[op.d_id].push_back(mask);
+        }
+      }
+    }
+
+    d_op_index_enabled.assign(d_op_index_ops.size(), false);
+    for (auto& ids : d_op_index_waiting) ids.clear();
+    for (auto& theory_ops : d_op_index_theory_ops)
+    {
+      for (auto& ops : theory_ops) ops.clear();
+    }
+    for (auto& theories : d_op_index_theories) theories.clear();
+    d_op_index_quant.clear();
+
+    d_op_index_sort_kinds = 0;
+    for (uint32_t i = 0; i < static_cast<uint32_t>(SORT_ANY); ++i)
+    {
+      if (d_term_db.has_term(static_cast<SortKind>(i)))
+      {
+        d_op_index_sort_kinds |= 1u << i;
+      }
+    }
+
+    for (const Op* op : d_op_index_ops)
+    {
+      if (op->d_kind == Op::FORALL || op->d_kind == Op::EXISTS
+          || op->d_kind == Op::SET_COMPREHENSION)
+      {
+        d_op_index_quant.push_back(op);
+      }
+      else if (op_index_has_terms(op))
+      {
+        enable_op_index_op(op);
+      }
+      else
+      {
+        for (SortKindMask mask : d_op_index_args[op->d_id])
+        {
+          if (mask & d_op_index_sort_kinds) continue;
+          for (uint32_t i = 0; i < static_cast<uint32_t>(SORT_ANY); ++i)
+          {
+            if (mask & (1u << i)) d_op_index_waiting[i].push_back(op->d_id);
+          }
+        }
+      }
+    }
+    d_op_index_new_sort_kinds = 0;
+    d_op_index_reset          = false;
+  }
+  else if (d_op_index_new_sort_kinds)
+  {
+    for (uint32_t i = 0; i < static_cast<uint32_t>(SORT_ANY); ++i)
+    {
+      if (!(d_op_index_new_sort_kinds & (1u << i))) continue;
+      for (uint64_t id : d_op_index_waiting[i])
+      {
+        if (!d_op_index_enabled[id] && op_index_has_terms(d_op_index_ops[id]))
+        {
+          enable_op_index_op(d_op_index_ops[id]);
+        }
+      }
+      /* Operators that still wait wait for other sort kinds, too. */
+      d_op_index_waiting[i].clear();
+    }
+    d_op_index_new_sort_kinds = 0;
+  }
+}
+
+void
+SolverManager::enable_op_index_op(const Op* op)
+{
+  assert(!d_op_index_enabled[op->d_id]);
+  d_op_index_enabled[op->d_id] = true;
+
+  auto add = [this, op](SortKind sort_kind) {
+    auto& ops = d_op_index_theory_ops[op->d_theory][sort_kind];
+    if (ops.empty() && op->d_theory != THEORY_BOOL
+        && op->d_theory != THEORY_ALL)
+    {
+      d_op_index_theories[sort_kind].push_back(op->d_theory);
+    }
+    ops.push_back(op);
+  };
+  for (SortKind sort_kind : op->d_sort_kinds)
+  {
+    add(sort_kind);
+  }
+  add(SORT_ANY);
+}
+
+bool
+SolverManager::op_index_has_terms(const Op* op) const
+{
+  for (SortKindMask mask : d_op_index_args[op->d_id])
+  {
+    if (!(mask & d_op_index_sort_kinds)) return false;
+  }
+  return true;
 }
 
 /* -------------------------------------------------------------------------- */
@@ -129,6 +271,13 @@ SolverManager::get_trace()
   return d_trace;
 }
 
+void
+SolverManager::flush_trace()
+{
+  d_trace.flush();
+  TraceBuffer::flush_all();
+}
+
 /* -------------------------------------------------------------------------- */
 
 const TheorySet&
@@ -183,8 +332,9 @@ SolverManager::add_value(Term& term,
 {
   assert(term.get());
 
-  add_input(term, sort, sort_kind);
-  term->set_leaf_kind(AbsTerm::LeafKind::VALUE);
+  d_stats.inputs += 1;
+  d_term_db.add_value(term, sort, sort_kind);
+  update_op_index(sort_kind);
   term->set_special_value_kind(value_kind);
 }
 
@@ -202,6 +352,7 @@ SolverManager::add_input(Term& term, Sort& sort, SortKind sort_kind)
 
   d_stats.inputs += 1;
   d_term_db.add_input(term, sort, sort_kind);
+  update_op_index(sort_kind);
 }
 
 void
@@ -211,6 +362,7 @@ SolverManager::add_var(Term& term, Sort& sort, SortKind sort_kind)
 
   d_stats.vars += 1;
   d_term_db.add_var(term, sort, sort_kind);
+  update_op_index(sort_kind);
   term->set_leaf_kind(AbsTerm::LeafKind::VARIABLE);
 }
 
@@ -221,6 +373,7 @@ SolverManager::add_const(Term& term, Sort& sort, SortKind sort_kind)
 
   d_stats.vars += 1;
   d_term_db.add_input(term, sort, sort_kind);
+  update_op_index(sort_kind);
   term->set_leaf_kind(AbsTerm::LeafKind::CONSTANT);
 }
 
@@ -291,6 +444,7 @@ SolverManager::add_term(Term& term,
     }
   }
   d_term_db.add_term(term, lookup, sort_kind, args);
+  update_op_index(sort_kind);
   assert(lookup->get_id());
   assert(lookup->get_kind() != SORT_ANY);
   assert(!lookup->is_dt() || !lookup->get_dt_ctor_names().empty());
@@ -378,7 +532,7 @@ SolverManager::pick_sort_kind(bool with_terms)
   {
     return d_term_db.pick_sort_kind();
   }
-  return d_rng.pick_from_map<std::unordered_map<SortKind, SortSet>, SortKind>(
+  return d_rng.pick_from_map<decltype(d_sort_kind_to_sorts), SortKind>(
       d_sort_kind_to_sorts);
 }
 
@@ -438,117 +592,237 @@ SolverManager::pick_sort_kind_data()
 }
 
 Op::Kind
-SolverManager::pick_op_kind(bool with_terms, SortKind sort_kind)
+SolverManager::pick_op_kind_compat(SortKind sort_kind)
 {
-  if (with_terms)
+  std::unordered_map<Theory, OpKindSet> kinds(d_enabled_op_kinds);
+  std::vector<Op::Kind> remove;
+  for (const auto& [kind, op] : d_available_op_kinds)
   {
-    std::unordered_map<Theory, OpKindSet> kinds(d_enabled_op_kinds);
-    std::vector<Op::Kind> remove;
-    for (const auto& [kind, op] : d_available_op_kinds)
+    /* Quantifiers can only be created if we already have variables and
+     * Boolean terms in the current scope. */
+    if ((op.d_kind == Op::FORALL || op.d_kind == Op::EXISTS
+         || op.d_kind == Op::SET_COMPREHENSION)
+        && (!d_term_db.has_var() || !d_term_db.has_quant_body()
+            || (d_term_db.get_num_terms(d_term_db.max_level())
+                < MURXLA_MIN_N_QUANT_TERMS)))
     {
-      /* Quantifiers can only be created if we already have variables and
-       * Boolean terms in the current scope. */
-      if ((op.d_kind == Op::FORALL || op.d_kind == Op::EXISTS
-           || op.d_kind == Op::SET_COMPREHENSION)
-          && (!d_term_db.has_var() || !d_term_db.has_quant_body()
-              || (d_term_db.get_num_terms(d_term_db.max_level())
-                  < MURXLA_MIN_N_QUANT_TERMS)))
-      {
-        continue;
-      }
+      continue;
+    }
 
-      bool has_terms = true;
+    bool has_terms = true;
 
-      /* Check if we already have terms that can be used with this operator. */
-      if (op.d_arity < 0)
+    /* Check if we already have terms that can be used with this operator. */
+    if (op.d_arity < 0)
+    {
+      has_terms = has_term(op.get_arg_sort_kind(0));
+    }
+    else
+    {
+      for (int32_t i = 0; i < op.d_arity; ++i)
       {
-        has_terms = has_term(op.get_arg_sort_kind(0));
+        if (!has_term(op.get_arg_sort_kind(i)))
+        {
+          has_terms = false;
+          break;
+        }
       }
-      else
+    }
+    if (has_terms)
+    {
+      /* In general if a term was added to the term db it will always be
+       * available. However, for quantifiers, terms get "consumed" and
+       * therefore we always have to check whether we can create a quantified
+       * term and therefore the FORALL and EXISTS kinds can't be cached. */
+      if (op.d_kind != Op::FORALL && op.d_kind != Op::EXISTS)
+      {
+        d_enabled_op_kinds[op.d_theory].insert(op.d_kind);
+        remove.push_back(op.d_kind);
+      }
+      kinds[op.d_theory].insert(op.d_kind);
+    }
+  }
+
+  /* Remove the enabled kinds from d_available_op_kinds since these kinds now
+   * can be constructed with terms in the db. */
+  for (const auto& k : remove)
+  {
+    d_available_op_kinds.erase(k);
+  }
+
+  /* Filter operator kinds based on sort kind. */
+  if (sort_kind != SORT_ANY)
+  {
+    const auto& enabled_ops = d_opmgr->get_op_kinds();
+    for (const auto& [kind, op] : enabled_ops)
+    {
+      if (op.d_sort_kinds.find(sort_kind) == op.d_sort_kinds.end())
       {
-        for (int32_t i = 0; i < op.d_arity; ++i)
+        const auto it = kinds.find(op.d_theory);
+        if (it != kinds.end())
         {
-          if (!has_term(op.get_arg_sort_kind(i)))
+          it->second.erase(kind);
+          if (it->second.empty())
           {
-            has_terms = false;
-            break;
+            kinds.erase(op.d_theory);
           }
         }
       }
-      if (has_terms)
+    }
+  }
+
+  if (kinds.size() > 0)
+  {
+    /* First pick theory and then operator kind (avoids bias against theories
+     * with many operators). However, we pick THEORY_BOOL and THEORY_ALL with
+     * lower probability (10% each) to generate more theory terms. */
+
+    bool have_bool  = kinds.find(THEORY_BOOL) != kinds.end();
+    bool have_all   = kinds.find(THEORY_ALL) != kinds.end();
+    size_t min_size = have_all ? 1 : 0;
+    uint32_t prob   = have_all ? 900 : 1000;
+    if (have_bool)
+    {
+      min_size += 1;
+      prob -= 100;
+    }
+
+    Theory theory = THEORY_ALL;
+    if (kinds.size() > min_size && d_rng.pick_with_prob(prob))
+    {
+      do
       {
-        /* In general if a term was added to the term db it will always be
-         * available. However, for quantifiers, terms get "consumed" and
-         * therefore we always have to check whether we can create a quantified
-         * term and therefore the FORALL and EXISTS kinds can't be cached. */
-        if (op.d_kind != Op::FORALL && op.d_kind != Op::EXISTS)
-        {
-          d_enabled_op_kinds[op.d_theory].insert(op.d_kind);
-          remove.push_back(op.d_kind);
-        }
-        kinds[op.d_theory].insert(op.d_kind);
-      }
+        theory = d_rng.pick_from_map<decltype(kinds), Theory>(kinds);
+      } while (theory == THEORY_ALL || theory == THEORY_BOOL);
     }
+    else if (have_bool && d_rng.flip_coin())
+    {
+      theory = THEORY_BOOL;
+    }
+
+    auto& op_kinds  = kinds[theory];
+    return d_rng.pick_from_set<decltype(op_kinds), Op::Kind>(op_kinds);
+  }
+
+  /* We cannot create any operation with the current set of terms. */
+  return Op::UNDEFINED;
+}
 
-    /* Remove the enabled kinds from d_available_op_kinds since these kinds now
-     * can be constructed with terms in the db. */
-    for (const auto& k : remove)
+Op::Kind
+SolverManager::pick_op_kind(bool with_terms, SortKind sort_kind)
+{
+  if (with_terms)
+  {
+    if (d_rng.is_compat_sampling())
     {
-      d_available_op_kinds.erase(k);
+      return pick_op_kind_compat(sort_kind);
     }
 
-    /* Filter operator kinds based on sort kind. */
-    if (sort_kind != SORT_ANY)
+    update_op_index();
+
+    /* Quantifiers can only be created if we already have variables and
+     * Boolean terms in the current scope. */
+    d_op_index_quant_ops.clear();
+    d_op_index_quant_theories.clear();
+    if (!d_op_index_quant.empty() && d_term_db.has_var()
+        && d_term_db.has_quant_body()
+        && (d_term_db.get_num_terms(d_term_db.max_level())
+            >= MURXLA_MIN_N_QUANT_TERMS))
     {
-      const auto& enabled_ops = d_opmgr->get_op_kinds();
-      for (const auto& [kind, op] : enabled_ops)
+      for (auto it = d_op_index_quant.begin(); it != d_op_index_quant.end();)
       {
-        if (op.d_sort_kinds.find(sort_kind) == op.d_sort_kinds.end())
+        const Op* op = *it;
+        if (!op_index_has_terms(op))
+        {
+          ++it;
+        }
+        /* In general if a term was added to the term db it will always be
+         * available. However, for quantifiers, terms get "consumed" and
+         * therefore we always have to check whether we can create a quantified
+         * term and therefore the FORALL and EXISTS kinds can't be cached. */
+        else if (op->d_kind != Op::FORALL && op->d_kind != Op::EXISTS)
+        {
+          enable_op_index_op(op);
+          it = d_op_index_quant.erase(it);
+        }
+        else
         {
-          const auto it = kinds.find(op.d_theory);
-          if (it != kinds.end())
+          if (sort_kind == SORT_ANY
+              || op->d_sort_kinds.find(sort_kind) != op->d_sort_kinds.end())
           {
-            it->second.erase(kind);
-            if (it->second.empty())
-            {
-              kinds.erase(op.d_theory);
-            }
+            d_op_index_quant_ops.push_back(op);
           }
+          ++it;
+        }
+      }
+      for (const Op* op : d_op_index_quant_ops)
+      {
+        Theory theory = op->d_theory;
+        if (theory != THEORY_BOOL && theory != THEORY_ALL
+            && d_op_index_theory_ops[theory][sort_kind].empty()
+            && std::find(d_op_index_quant_theories.begin(),
+                         d_op_index_quant_theories.end(),
+                         theory)
+                   == d_op_index_quant_theories.end())
+        {
+          d_op_index_quant_theories.push_back(theory);
         }
       }
     }
 
-    if (kinds.size() > 0)
+    auto num_ops = [this, sort_kind](Theory theory) {
+      size_t res = d_op_index_theory_ops[theory][sort_kind].size();
+      for (const Op* op : d_op_index_quant_ops)
+      {
+        if (op->d_theory == theory) ++res;
+      }
+      return res;
+    };
+
+    const auto& theories = d_op_index_theories[sort_kind];
+    size_t n_theories = theories.size() + d_op_index_quant_theories.size();
+    bool have_bool    = num_ops(THEORY_BOOL) > 0;
+    bool have_all     = num_ops(THEORY_ALL) > 0;
+
+    if (n_theories > 0 || have_bool || have_all)
     {
       /* First pick theory and then operator kind (avoids bias against theories
        * with many operators). However, we pick THEORY_BOOL and THEORY_ALL with
        * lower probability (10% each) to generate more theory terms. */
 
-      bool have_bool  = kinds.find(THEORY_BOOL) != kinds.end();
-      bool have_all   = kinds.find(THEORY_ALL) != kinds.end();
-      size_t min_size = have_all ? 1 : 0;
-      uint32_t prob   = have_all ? 900 : 1000;
+      uint32_t prob = have_all ? 900 : 1000;
       if (have_bool)
       {
-        min_size += 1;
         prob -= 100;
       }
 
       Theory theory = THEORY_ALL;
-      if (kinds.size() > min_size && d_rng.pick_with_prob(prob))
+      if (n_theories > 0 && d_rng.pick_with_prob(prob))
       {
-        do
-        {
-          theory = d_rng.pick_from_map<decltype(kinds), Theory>(kinds);
-        } while (theory == THEORY_ALL || theory == THEORY_BOOL);
+        size_t idx = d_rng.pick<size_t>(0, n_theories - 1);
+        theory     = idx < theories.size()
+                         ? theories[idx]
+                         : d_op_index_quant_theories[idx - theories.size()];
       }
-      else if (have_bool && d_rng.flip_coin())
+      else if (have_bool && (!have_all || d_rng.flip_coin()))
       {
         theory = THEORY_BOOL;
       }
 
-      auto& op_kinds  = kinds[theory];
-      return d_rng.pick_from_set<decltype(op_kinds), Op::Kind>(op_kinds);
+      const auto& ops = d_op_index_theory_ops[theory][sort_kind];
+      size_t idx      = d_rng.pick<size_t>(0, num_ops(theory) - 1);
+      if (idx < ops.size())
+      {
+        return ops[idx]->d_kind;
+      }
+      idx -= ops.size();
+      for (const Op* op : d_op_index_quant_ops)
+      {
+        if (op->d_theory == theory && idx-- == 0)
+        {
+          return op->d_kind;
+        }
+      }
+      assert(false);
     }
 
     /* We cannot create any operation with the current set of terms. */
@@ -585,7 +859,7 @@ SolverManager::pick_theory(bool with_terms)
 {
   if (with_terms)
   {
-    TheorySet theories;
+    IndexedSet<Theory> theories;
     for (uint32_t i = 0; i < static_cast<uint32_t>(SORT_ANY); ++i)
     {
       SortKind sort_kind = static_cast<SortKind>(i);
@@ -770,7 +1044,7 @@ SolverManager::report_result(Solver::Result res)
   d_sat_result = res;
   d_sat_called = true;
   ++d_n_sat_calls;
-  ++d_mbt_stats->d_results[res];
+  ++d_mbt_stats->shard().d_results[res];
 }
 
 std::unordered_map<std::string, std::string>
@@ -1124,7 +1398,7 @@ Sort
 SolverManager::pick_sort_bv(uint32_t bw, bool with_terms)
 {
   assert(has_sort_bv(bw, with_terms));
-  const SortSet sorts = with_terms ? d_term_db.get_sorts() : d_sorts;
+  const SortSet& sorts = with_terms ? d_term_db.get_sorts() : d_sorts;
   for (const auto& sort : sorts)
   {
     if (sort->is_bv() && sort->get_bv_size() == bw)
@@ -1143,7 +1417,7 @@ SolverManager::pick_sort_bv_max(uint32_t bw_max, bool with_terms)
   assert(has_sort_bv_max(bw_max, with_terms));
   std::vector<Sort> bv_sorts;
 
-  const SortSet sorts = with_terms ? d_term_db.get_sorts() : d_sorts;
+  const SortSet& sorts = with_terms ? d_term_db.get_sorts() : d_sorts;
   for (const auto& sort : sorts)
   {
     if (sort->is_bv() && sort->get_bv_size() <= bw_max)
@@ -1314,7 +1588,7 @@ SolverManager::has_sort_bv(uint32_t bw, bool with_terms) const
 bool
 SolverManager::has_sort_bv_max(uint32_t bw_max, bool with_terms) const
 {
-  const SortSet sorts = with_terms ? d_term_db.get_sorts() : d_sorts;
+  const SortSet& sorts = with_terms ? d_term_db.get_sorts() : d_sorts;
   for (const auto& sort : sorts)
   {
     if (sort->is_bv() && sort->get_bv_size() <= bw_max)
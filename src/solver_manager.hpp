@@ -10,12 +10,14 @@
 #ifndef __MURXLA__SOLVER_MANAGER_H
 #define __MURXLA__SOLVER_MANAGER_H
 
+#include <array>
 #include <cassert>
 #include <iostream>
 #include <memory>
 #include <unordered_map>
 #include <unordered_set>
 
+#include "indexed_set.hpp"
 #include "solver/solver.hpp"
 #include "solver/solver_profile.hpp"
 #include "solver_option.hpp"
@@ -38,7 +40,7 @@ class SolverManager
   friend class DD;
 
  public:
-  using SortSet = std::unordered_set<Sort>;
+  using SortSet = IndexedSet<Sort>;
 
   /* Statistics. */
   struct Stats
@@ -98,6 +100,12 @@ class SolverManager
    * @return A reference to the trace stream.
    */
   std::ostream& get_trace();
+  /**
+   * Flush the trace stream, including trace output that is buffered in
+   * memory (see --buffer-trace). Called before solver calls that may run
+   * into a time limit.
+   */
+  void flush_trace();
 
   /**
    * Mark given option as already configured.
@@ -898,6 +906,40 @@ class SolverManager
    */
   void reset_op_cache();
 
+  /**
+   * Pick operator kind with terms via the caches d_enabled_op_kinds and
+   * d_available_op_kinds, the implementation of pick_op_kind() prior to the
+   * operator kind index. Used in compatibility mode for weighted picks to
+   * reproduce runs of earlier versions.
+   * @param sort_kind The sort kind of terms of the operator kind to select.
+   * @return The operator kind, or Op::UNDEFINED if no operator applies.
+   */
+  Op::Kind pick_op_kind_compat(SortKind sort_kind);
+
+  /**
+   * Notify the operator kind index that a term of the given sort kind was
+   * added to the term database.
+   * @param sort_kind The sort kind of the added term.
+   */
+  void update_op_index(SortKind sort_kind);
+  /**
+   * Bring the operator kind index up to date: rebuild it after a reset of the
+   * op caches, and enable the operators that became applicable due to sort
+   * kinds that gained terms since the last update.
+   */
+  void update_op_index();
+  /**
+   * Add operator to the lists of enabled operators of the index.
+   * @param op The operator.
+   */
+  void enable_op_index_op(const Op* op);
+  /**
+   * Determine if there are terms for all arguments of the given operator,
+   * according to the index.
+   * @param op The operator.
+   */
+  bool op_index_has_terms(const Op* op) const;
+
   /**
    * Pick any of the enabled theories.
    * @param with_terms True to only pick theories with already created terms.
@@ -1043,16 +1085,16 @@ class SolverManager
   SortSet d_sorts_dt_non_well_founded;
 
   /** Map sort kind -> sorts. */
-  std::unordered_map<SortKind, SortSet> d_sort_kind_to_sorts;
+  IndexedMap<SortKind, SortSet> d_sort_kind_to_sorts;
 
   /** The set of already assumed formulas. */
-  std::unordered_set<Term> d_assumptions;
+  IndexedSet<Term> d_assumptions;
 
   /** Term database */
   TermDb d_term_db;
 
   /** Set of currently created string values with length 1. */
-  std::unordered_set<Term> d_string_char_values;
+  IndexedSet<Term> d_string_char_values;
 
   /** Map untraced ids to corresponding Terms. */
   std::unordered_map<uint64_t, Term> d_untraced_terms;
@@ -1072,6 +1114,52 @@ class SolverManager
    */
   OpKindMap d_available_op_kinds;
 
+  /* Index of operator kinds used by pick_op_kind(), maintained incrementally.
+   *
+   * Operators are enabled as soon as terms exist for all their arguments, and
+   * stay enabled until the op caches are reset (see reset_op_cache()). The
+   * sort kinds of the arguments of an operator are stored as bit masks, and
+   * operators that are not enabled yet are only reconsidered when a sort kind
+   * they depend on gains terms. Sort kinds only lose terms when variables are
+   * removed, which resets the op caches. */
+
+  /** A bit mask of sort kinds, bit i represents SortKind i. */
+  using SortKindMask = uint32_t;
+  static_assert(SORT_ANY < 32, "SortKindMask too small");
+  /** True if the index must be rebuilt. */
+  bool d_op_index_reset = true;
+  /** The sort kinds with terms in the term database. */
+  SortKindMask d_op_index_sort_kinds = 0;
+  /** The sort kinds that gained terms since the last update of the index. */
+  SortKindMask d_op_index_new_sort_kinds = 0;
+  /** Maps operator id to operator. */
+  std::vector<const Op*> d_op_index_ops;
+  /** Maps operator id to the sort kinds of its arguments, one per argument. */
+  std::vector<std::vector<SortKindMask>> d_op_index_args;
+  /** Maps operator id to true if the operator is enabled. */
+  std::vector<bool> d_op_index_enabled;
+  /** Maps sort kind to the ids of the operators that wait for its terms. */
+  std::array<std::vector<uint64_t>, SORT_ANY> d_op_index_waiting;
+  /**
+   * Quantifier operators (and SET_COMPREHENSION), which additionally require
+   * variables and quantifier bodies in the current scope, and are therefore
+   * checked on every pick until enabled. FORALL and EXISTS consume variables
+   * and are never enabled.
+   */
+  std::vector<const Op*> d_op_index_quant;
+  /** Maps theory and sort kind of terms to enabled operators. */
+  std::array<std::array<std::vector<const Op*>, SORT_ANY + 1>, THEORY_ALL + 1>
+      d_op_index_theory_ops;
+  /**
+   * Maps sort kind of terms to the theories other than THEORY_BOOL and
+   * THEORY_ALL with enabled operators.
+   */
+  std::array<std::vector<Theory>, SORT_ANY + 1> d_op_index_theories;
+  /** The quantifier operators that apply in the current pick. */
+  std::vector<const Op*> d_op_index_quant_ops;
+  /** The theories of d_op_index_quant_ops not in d_op_index_theories. */
+  std::vector<Theory> d_op_index_quant_theories;
+
   /** Is this solver manager already initialized? */
   bool d_initialized = false;
 
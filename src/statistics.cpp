@@ -9,15 +9,200 @@
  */
 #include "statistics.hpp"
 
+#include <cassert>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <memory>
+#include <sstream>
+#include <vector>
+
+#include "except.hpp"
 #include "op.hpp"
 #include "solver/solver.hpp"
 
 namespace murxla {
 namespace statistics {
 
+namespace {
+
+/** Get the current time of the monotonic clock in seconds. */
+double
+get_time()
+{
+  return std::chrono::duration<double>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+/** Print given time in seconds in a human readable unit. */
+std::string
+time_to_string(double seconds)
+{
+  std::stringstream ss;
+  ss << std::fixed << std::setprecision(2);
+  if (seconds >= 1)
+  {
+    ss << seconds << "s";
+  }
+  else if (seconds >= 1e-3)
+  {
+    ss << seconds * 1e3 << "ms";
+  }
+  else
+  {
+    ss << seconds * 1e6 << "us";
+  }
+  return ss.str();
+}
+
+/**
+ * Print latency histograms, sorted by total time in descending order.
+ * @param title      The title of the section.
+ * @param histograms The histograms and their names.
+ * @param tick_time  The time of one timer tick in seconds.
+ */
+void
+print_times(const std::string& title,
+            std::vector<std::pair<const char*, const Histogram*>> histograms,
+            double tick_time)
+{
+  auto ticks_to_string = [tick_time](uint64_t ticks) {
+    return time_to_string(static_cast<double>(ticks) * tick_time);
+  };
+  std::sort(histograms.begin(), histograms.end(), [](auto& a, auto& b) {
+    return a.second->d_ticks > b.second->d_ticks;
+  });
+  uint64_t sum = 0;
+  std::cout << title << " (calls, total, mean, p50 <=, p99 <=):" << std::endl;
+  for (const auto& [name, h] : histograms)
+  {
+    if (h->d_count == 0) continue;
+    std::cout << "  " << name << ": " << h->d_count << ", "
+              << ticks_to_string(h->d_ticks) << ", "
+              << ticks_to_string(h->d_ticks / h->d_count) << ", "
+              << ticks_to_string(h->get_percentile(50)) << ", "
+              << ticks_to_string(h->get_percentile(99)) << std::endl;
+    sum += h->d_ticks;
+  }
+  std::cout << "  Total: " << ticks_to_string(sum) << std::endl;
+}
+
+}  // namespace
+
+/* -------------------------------------------------------------------------- */
+
+void
+Histogram::merge(const Histogram& other)
+{
+  d_count += other.d_count;
+  d_ticks += other.d_ticks;
+  for (uint32_t i = 0; i < MURXLA_STATS_N_BUCKETS; ++i)
+  {
+    d_buckets[i] += other.d_buckets[i];
+  }
+}
+
+uint64_t
+Histogram::get_percentile(uint32_t percentile) const
+{
+  uint64_t n = 0;
+  for (uint32_t i = 0; i < MURXLA_STATS_N_BUCKETS; ++i)
+  {
+    n += d_buckets[i];
+    if (n > 0 && n * 100 >= percentile * d_count)
+    {
+      return uint64_t(1) << (i + 1);
+    }
+  }
+  return uint64_t(1) << MURXLA_STATS_N_BUCKETS;
+}
+
+/* -------------------------------------------------------------------------- */
+
+void
+Shard::merge(const Shard& other)
+{
+  for (uint32_t i = 0; i < 3; ++i)
+  {
+    d_results[i] += other.d_results[i];
+  }
+  for (uint32_t i = 0; i < MURXLA_MAX_N_OPS; ++i)
+  {
+    d_ops[i] += other.d_ops[i];
+    d_ops_ok[i] += other.d_ops_ok[i];
+    d_op_times[i].merge(other.d_op_times[i]);
+  }
+  for (uint32_t i = 0; i < SORT_ANY; ++i)
+  {
+    d_sorts[i] += other.d_sorts[i];
+    d_sorts_ok[i] += other.d_sorts_ok[i];
+  }
+  for (uint32_t i = 0; i < MURXLA_MAX_N_STATES; ++i)
+  {
+    d_states[i] += other.d_states[i];
+  }
+  for (uint32_t i = 0; i < MURXLA_MAX_N_ACTIONS; ++i)
+  {
+    d_actions[i] += other.d_actions[i];
+    d_actions_ok[i] += other.d_actions_ok[i];
+    d_action_times[i].merge(other.d_action_times[i]);
+  }
+  d_check_sat_times.merge(other.d_check_sat_times);
+}
+
+/* -------------------------------------------------------------------------- */
+
+Statistics*
+Statistics::init(void* mem, uint32_t num_shards)
+{
+  assert(num_shards > 0);
+  std::memset(mem, 0, get_size(num_shards));
+  Statistics* res   = static_cast<Statistics*>(mem);
+  res->d_num_shards = num_shards;
+  return res;
+}
+
+std::unique_ptr<Statistics, void (*)(void*)>
+Statistics::create(uint32_t num_shards)
+{
+  void* mem = std::aligned_alloc(alignof(Statistics), get_size(num_shards));
+  MURXLA_EXIT_ERROR(mem == nullptr) << "failed to allocate statistics";
+  return {init(mem, num_shards), std::free};
+}
+
+void
+Statistics::init_timer()
+{
+  d_start_ticks = get_ticks();
+  d_start_time  = get_time();
+}
+
+uint64_t
+Statistics::get_num_results(uint32_t result) const
+{
+  assert(result < 3);
+  uint64_t res = 0;
+  const Shard* shards = get_shards();
+  for (uint32_t i = 0; i < d_num_shards; ++i)
+  {
+    res += shards[i].d_results[result];
+  }
+  return res;
+}
+
 void
 Statistics::print() const
 {
+  /* Merge the shards of all workers. */
+  std::unique_ptr<Shard> merged(new Shard());
+  const Shard* shards = get_shards();
+  for (uint32_t i = 0; i < d_num_shards; ++i)
+  {
+    merged->merge(shards[i]);
+  }
+
   std::cout << std::endl;
 
   uint64_t sum = 0, sum_ok = 0;
@@ -25,8 +210,9 @@ Statistics::print() const
   std::cout << "States:" << std::endl;
   for (uint32_t i = 0; i < MURXLA_MAX_N_STATES && d_state_kinds[i][0]; ++i)
   {
-    std::cout << "  " << d_state_kinds[i] << ": " << d_states[i] << std::endl;
-    sum += d_states[i];
+    std::cout << "  " << d_state_kinds[i] << ": " << merged->d_states[i]
+              << std::endl;
+    sum += merged->d_states[i];
   }
   std::cout << "  Total: " << sum << std::endl;
 
@@ -34,10 +220,10 @@ Statistics::print() const
   std::cout << "Actions:" << std::endl;
   for (uint32_t i = 0; i < MURXLA_MAX_N_ACTIONS && d_action_kinds[i][0]; ++i)
   {
-    std::cout << "  " << d_action_kinds[i] << ": " << d_actions[i] << " ("
-              << d_actions_ok[i] << ")" << std::endl;
-    sum += d_actions[i];
-    sum_ok += d_actions_ok[i];
+    std::cout << "  " << d_action_kinds[i] << ": " << merged->d_actions[i]
+              << " (" << merged->d_actions_ok[i] << ")" << std::endl;
+    sum += merged->d_actions[i];
+    sum_ok += merged->d_actions_ok[i];
   }
   std::cout << "  Total: " << sum << " (" << sum_ok << ")" << std::endl;
 
@@ -45,9 +231,9 @@ Statistics::print() const
   std::cout << "Results:" << std::endl;
   for (uint32_t i = 0; i < 3; ++i)
   {
-    std::cout << "  " << static_cast<Solver::Result>(i) << ": " << d_results[i]
-              << std::endl;
-    sum += d_results[i];
+    std::cout << "  " << static_cast<Solver::Result>(i) << ": "
+              << merged->d_results[i] << std::endl;
+    sum += merged->d_results[i];
   }
   std::cout << "  Total: " << sum << std::endl;
 
@@ -55,10 +241,10 @@ Statistics::print() const
   std::cout << "Ops:" << std::endl;
   for (uint32_t i = 0; i < MURXLA_MAX_N_OPS && d_op_kinds[i][0]; ++i)
   {
-    std::cout << "  " << d_op_kinds[i] << ": " << d_ops[i] << " ("
-              << d_ops_ok[i] << ")" << std::endl;
-    sum += d_ops[i];
-    sum_ok += d_ops_ok[i];
+    std::cout << "  " << d_op_kinds[i] << ": " << merged->d_ops[i] << " ("
+              << merged->d_ops_ok[i] << ")" << std::endl;
+    sum += merged->d_ops[i];
+    sum_ok += merged->d_ops_ok[i];
   }
   std::cout << "  Total: " << sum << " (" << sum_ok << ")" << std::endl;
 
@@ -66,12 +252,40 @@ Statistics::print() const
   std::cout << "Sorts:" << std::endl;
   for (uint32_t i = 0; i < SORT_ANY; ++i)
   {
-    std::cout << "  " << static_cast<SortKind>(i) << ": " << d_sorts[i] << " ("
-              << d_sorts_ok[i] << ")" << std::endl;
-    sum += d_sorts[i];
-    sum_ok += d_sorts_ok[i];
+    std::cout << "  " << static_cast<SortKind>(i) << ": "
+              << merged->d_sorts[i] << " (" << merged->d_sorts_ok[i] << ")"
+              << std::endl;
+    sum += merged->d_sorts[i];
+    sum_ok += merged->d_sorts_ok[i];
   }
   std::cout << "  Total: " << sum << " (" << sum_ok << ")" << std::endl;
+
+  /* Calibrate the timer against the monotonic clock. */
+  double tick_time = 1e-9;
+  uint64_t ticks   = get_ticks() - d_start_ticks;
+  double time      = get_time() - d_start_time;
+  if (ticks > 0 && time > 0)
+  {
+    tick_time = time / static_cast<double>(ticks);
+  }
+
+  std::vector<std::pair<const char*, const Histogram*>> times;
+  for (uint32_t i = 0; i < MURXLA_MAX_N_ACTIONS && d_action_kinds[i][0]; ++i)
+  {
+    times.emplace_back(d_action_kinds[i], &merged->d_action_times[i]);
+  }
+  print_times("Action times", times, tick_time);
+
+  times.clear();
+  for (uint32_t i = 0; i < MURXLA_MAX_N_OPS && d_op_kinds[i][0]; ++i)
+  {
+    times.emplace_back(d_op_kinds[i], &merged->d_op_times[i]);
+  }
+  print_times("Op times", times, tick_time);
+
+  print_times("Check-sat times",
+              {{"check-sat", &merged->d_check_sat_times}},
+              tick_time);
 }
 
 }  // namespace statistics
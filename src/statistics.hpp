@@ -10,6 +10,16 @@
 #ifndef __MURXLA__STATISTICS_H
 #define __MURXLA__STATISTICS_H
 
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <chrono>
+#endif
+
+#include <algorithm>
+#include <cassert>
+#include <memory>
+
 #include "config.hpp"
 #include "op.hpp"
 
@@ -18,26 +28,180 @@ namespace murxla {
 namespace statistics {
 
 /**
- * Statistics.
+ * Get the current value of the timer used for recording latencies.
  *
- * The main statistics object is located in shared memory. We thus only use
- * base types here.
+ * This is the time stamp counter if available, and the monotonic clock in
+ * nanoseconds otherwise. Ticks are converted to time when statistics are
+ * printed.
  */
-struct Statistics
+inline uint64_t
+get_ticks()
+{
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+#endif
+}
+
+/** A histogram of latencies, log-bucketed by timer ticks. */
+struct Histogram
+{
+  /** The number of recorded latencies. */
+  uint64_t d_count;
+  /** The sum of recorded latencies in ticks. */
+  uint64_t d_ticks;
+  /** The number of latencies in [2^i, 2^(i+1)) ticks for bucket i. */
+  uint64_t d_buckets[MURXLA_STATS_N_BUCKETS];
+
+  /** Record latency. */
+  void add(uint64_t ticks)
+  {
+    uint32_t bucket = ticks ? 63 - __builtin_clzll(ticks) : 0;
+    d_count += 1;
+    d_ticks += ticks;
+    d_buckets[std::min<uint32_t>(bucket, MURXLA_STATS_N_BUCKETS - 1)] += 1;
+  }
+  /** Add the recorded latencies of another histogram. */
+  void merge(const Histogram& other);
+  /**
+   * Get an upper bound of the given percentile of the recorded latencies.
+   * @param percentile The percentile in [0, 100].
+   * @return The upper bound of the bucket containing the percentile in ticks.
+   */
+  uint64_t get_percentile(uint32_t percentile) const;
+};
+
+/** Records the time between its construction and destruction. */
+class Timer
+{
+ public:
+  Timer(Histogram& histogram) : d_histogram(histogram), d_start(get_ticks())
+  {
+  }
+  ~Timer() { d_histogram.add(get_ticks() - d_start); }
+
+ private:
+  /** The histogram to record the time in. */
+  Histogram& d_histogram;
+  /** The start time in ticks. */
+  uint64_t d_start;
+};
+
+/**
+ * The statistics of one worker.
+ *
+ * Cache-line aligned to avoid false sharing between concurrent test runs.
+ */
+struct alignas(64) Shard
 {
   uint64_t d_results[3];
-  char d_op_kinds[MURXLA_MAX_N_OPS][MURXLA_MAX_KIND_LEN];
   uint64_t d_ops[MURXLA_MAX_N_OPS];
   uint64_t d_ops_ok[MURXLA_MAX_N_OPS];
   uint64_t d_sorts[SORT_ANY];
   uint64_t d_sorts_ok[SORT_ANY];
-  char d_state_kinds[MURXLA_MAX_N_STATES][MURXLA_MAX_KIND_LEN];
   uint64_t d_states[MURXLA_MAX_N_STATES];
-  char d_action_kinds[MURXLA_MAX_N_ACTIONS][MURXLA_MAX_KIND_LEN];
   uint64_t d_actions[MURXLA_MAX_N_ACTIONS];
   uint64_t d_actions_ok[MURXLA_MAX_N_ACTIONS];
+  /** The latencies of the solver calls creating terms, per operator. */
+  Histogram d_op_times[MURXLA_MAX_N_OPS];
+  /** The latencies of actions. */
+  Histogram d_action_times[MURXLA_MAX_N_ACTIONS];
+  /** The latencies of the solver calls of check-sat actions. */
+  Histogram d_check_sat_times;
+
+  /** Add the statistics of another shard. */
+  void merge(const Shard& other);
+};
+
+/**
+ * Statistics.
+ *
+ * The main statistics object is located in shared memory. We thus only use
+ * base types here.
+ *
+ * Counters and latencies are recorded in the shard of the current worker,
+ * which is only written by the process executing the worker's current test
+ * run, and hence updated without synchronization. The number of shards is
+ * determined at initialization, the shards are located in memory directly
+ * after the Statistics object (see get_size()).
+ */
+struct alignas(64) Statistics
+{
+  char d_op_kinds[MURXLA_MAX_N_OPS][MURXLA_MAX_KIND_LEN];
+  char d_state_kinds[MURXLA_MAX_N_STATES][MURXLA_MAX_KIND_LEN];
+  char d_action_kinds[MURXLA_MAX_N_ACTIONS][MURXLA_MAX_KIND_LEN];
+  /** The timer value at initialization, for converting ticks to time. */
+  uint64_t d_start_ticks;
+  /** The time of the monotonic clock in seconds at initialization. */
+  double d_start_time;
+  /** The number of shards. */
+  uint32_t d_num_shards;
+
+  /**
+   * Get the size of statistics with the given number of shards.
+   * @param num_shards The number of shards.
+   * @return The size in bytes.
+   */
+  static size_t get_size(uint32_t num_shards)
+  {
+    return sizeof(Statistics) + num_shards * sizeof(Shard);
+  }
+  /**
+   * Initialize statistics in the given memory.
+   * @param mem The memory, of get_size(num_shards) bytes, aligned to 64
+   *            bytes.
+   * @param num_shards The number of shards, at least the number of workers.
+   * @return The statistics.
+   */
+  static Statistics* init(void* mem, uint32_t num_shards);
+  /**
+   * Create statistics on the heap, for statistics that are not shared
+   * between processes.
+   * @param num_shards The number of shards.
+   * @return The statistics.
+   */
+  static std::unique_ptr<Statistics, void (*)(void*)> create(
+      uint32_t num_shards = 1);
+
+  /**
+   * Set the shard to record statistics in for the current process.
+   * @param worker The worker executing the test runs of this process.
+   */
+  static void set_shard(uint32_t worker) { s_shard = worker; }
+  /**
+   * Get the shard to record statistics in for the current process.
+   * Statistics with a single shard are not shared between workers and always
+   * record in that shard.
+   */
+  Shard& shard()
+  {
+    uint32_t idx = d_num_shards == 1 ? 0 : s_shard;
+    assert(idx < d_num_shards);
+    return get_shards()[idx];
+  }
 
+  /** Initialize the timer. */
+  void init_timer();
+  /**
+   * Get the number of check-sat calls with the given result over all shards.
+   * @param result The result, a Solver::Result.
+   */
+  uint64_t get_num_results(uint32_t result) const;
   void print() const;
+
+ private:
+  /** @return The shards, located directly after this object. */
+  Shard* get_shards() { return reinterpret_cast<Shard*>(this + 1); }
+  const Shard* get_shards() const
+  {
+    return reinterpret_cast<const Shard*>(this + 1);
+  }
+
+  /** The shard of the current process. */
+  inline static uint32_t s_shard = 0;
 };
 
 }  // namespace statistics
@@ -19,7 +19,78 @@ namespace murxla {
 
 const static size_t MURXLA_PICK_MAX_WEIGHT = std::numeric_limits<size_t>::max();
 
-TermRefs::TermRefs(size_t level)
+ScopedTerms::ScopedTerms(size_t level) : d_terms(level) {}
+
+void
+ScopedTerms::add(const Term& t, size_t level)
+{
+  assert(level < d_terms.size());
+  assert(t->get_id());
+
+  if (d_ids.insert(t->get_id()).second)
+  {
+    d_terms[level].push_back(t);
+  }
+}
+
+bool
+ScopedTerms::contains(const Term& t) const
+{
+  return d_ids.find(t->get_id()) != d_ids.end();
+}
+
+Term
+ScopedTerms::pick(RNGenerator& rng) const
+{
+  assert(!empty());
+
+  /* Same draw as RNGenerator::pick_from_set(). */
+  size_t idx = rng.pick<uint32_t>() % d_ids.size();
+  for (const auto& terms : d_terms)
+  {
+    if (idx < terms.size())
+    {
+      return terms[idx];
+    }
+    idx -= terms.size();
+  }
+  assert(false);
+  return nullptr;
+}
+
+size_t
+ScopedTerms::size() const
+{
+  return d_ids.size();
+}
+
+bool
+ScopedTerms::empty() const
+{
+  return d_ids.empty();
+}
+
+void
+ScopedTerms::push()
+{
+  d_terms.emplace_back();
+}
+
+void
+ScopedTerms::pop()
+{
+  assert(!d_terms.empty());
+
+  for (const auto& t : d_terms.back())
+  {
+    d_ids.erase(t->get_id());
+  }
+  d_terms.pop_back();
+}
+
+/* -------------------------------------------------------------------------- */
+
+TermRefs::TermRefs(size_t level) : d_values(level)
 {
   for (size_t i = 0; i < level; ++i)
   {
@@ -46,6 +117,18 @@ TermRefs::add(const Term& t, size_t level)
      * soon as term is picked once. This ensures that new terms are picked with
      * a very high probability. */
     d_weights.insert(d_weights.begin() + end, MURXLA_PICK_MAX_WEIGHT);
+
+    /* Terms are usually added at the top level, which only requires to append
+     * to the samplers. Inserting in between requires to rebuild them. */
+    if (d_samplers_valid && end + 1 == d_terms.size())
+    {
+      d_sampler.push_back(0);
+      d_fresh.push_back(1);
+    }
+    else
+    {
+      d_samplers_valid = false;
+    }
   }
 }
 
@@ -79,11 +162,33 @@ TermRefs::pick(RNGenerator& rng, size_t level)
     {
       d_weights[i] = d_refs_sum - d_refs[i] + 1;
     }
+    d_samplers_valid = false;
   }
 
   size_t idx;
+  if (!rng.is_compat_sampling())
+  {
+    size_t begin = level == MAX_LEVEL ? 0 : get_level_begin(level);
+    size_t end   = level == MAX_LEVEL ? d_terms.size() : get_level_end(level);
+    assert(end - begin > 0);
+    if (!d_samplers_valid)
+    {
+      build_samplers();
+    }
+    /* Fresh terms have maximum weight, i.e., if there are any fresh terms in
+     * the range, one of them is picked with a very high probability. We pick
+     * uniformly among them in this case. */
+    if (d_fresh.sum(end) > d_fresh.sum(begin))
+    {
+      idx = rng.pick_weighted(d_fresh, begin, end);
+    }
+    else
+    {
+      idx = rng.pick_weighted(d_sampler, begin, end);
+    }
+  }
   /* No specifc level requested, pick from any level. */
-  if (level == MAX_LEVEL)
+  else if (level == MAX_LEVEL)
   {
     idx = rng.pick_weighted(d_weights);
   }
@@ -108,6 +213,11 @@ TermRefs::pick(RNGenerator& rng, size_t level)
   if (d_weights[idx] == MURXLA_PICK_MAX_WEIGHT)
   {
     d_weights[idx] = d_refs_sum - d_refs[idx] + 1;
+    if (d_samplers_valid)
+    {
+      d_sampler.set(idx, d_weights[idx]);
+      d_fresh.set(idx, 0);
+    }
   }
 
   return t;
@@ -123,6 +233,7 @@ void
 TermRefs::push()
 {
   d_levels.push_back(0);
+  d_values.push();
 }
 
 void
@@ -143,11 +254,17 @@ TermRefs::pop()
   d_terms.erase(d_terms.begin() + begin, d_terms.end());
   d_refs.erase(d_refs.begin() + begin, d_refs.end());
   d_weights.erase(d_weights.begin() + begin, d_weights.end());
+  if (d_samplers_valid)
+  {
+    d_sampler.shrink(begin);
+    d_fresh.shrink(begin);
+  }
   assert(d_idx.size() == d_terms.size());
   assert(d_terms.size() == d_refs.size());
   assert(d_refs.size() == d_weights.size());
 
   d_levels.pop_back();
+  d_values.pop();
   // TODO: restore d_refs_sum
 }
 
@@ -184,9 +301,44 @@ TermRefs::get_level_end(size_t level)
   return offset;
 }
 
+void
+TermRefs::add_value(const Term& t, size_t level)
+{
+  assert(contains(t));
+  d_values.add(t, level);
+}
+
+bool
+TermRefs::has_value() const
+{
+  return !d_values.empty();
+}
+
+Term
+TermRefs::pick_value(RNGenerator& rng) const
+{
+  return d_values.pick(rng);
+}
+
+void
+TermRefs::build_samplers()
+{
+  std::vector<uint64_t> weights(d_weights.size()), fresh(d_weights.size());
+  for (size_t i = 0, n = d_weights.size(); i < n; ++i)
+  {
+    bool is_fresh = d_weights[i] == MURXLA_PICK_MAX_WEIGHT;
+    weights[i]    = is_fresh ? 0 : d_weights[i];
+    fresh[i]      = is_fresh ? 1 : 0;
+  }
+  d_sampler.assign(weights.begin(), weights.end());
+  d_fresh.assign(fresh.begin(), fresh.end());
+  d_samplers_valid = true;
+}
+
 /* -------------------------------------------------------------------------- */
 
-TermDb::TermDb(SolverManager& smgr, RNGenerator& rng) : d_smgr(smgr), d_rng(rng)
+TermDb::TermDb(SolverManager& smgr, RNGenerator& rng)
+    : d_smgr(smgr), d_rng(rng), d_values(1)
 {
   d_vars.emplace_back();
 }
@@ -199,8 +351,10 @@ TermDb::clear()
   d_terms_intermediate.clear();
   d_term_sorts.clear();
   d_funs.clear();
+  d_funs_by_sig.clear();
   d_vars.clear();
   d_term_levels.clear();
+  d_values = ScopedTerms(0);
 }
 
 void
@@ -208,6 +362,7 @@ TermDb::reset()
 {
   clear();
   d_vars.emplace_back();
+  d_values.push();
 }
 
 size_t
@@ -297,6 +452,10 @@ TermDb::add_term(Term& term,
       term->set_id(d_terms.size() + d_terms_intermediate.size() + 1);
       set_levels(term, levels);
       trefs.add(term, level);
+      if (term->is_value())
+      {
+        d_values.add(term, level);
+      }
 
       d_terms.emplace(term->get_id(), term);
       d_term_sorts.insert(sort);
@@ -304,8 +463,12 @@ TermDb::add_term(Term& term,
       if (sort_kind == SORT_FUN)
       {
         // last sort in get_sorts() is codomain sort
-        size_t arity = term->get_sort()->get_sorts().size() - 1;
+        const auto& sorts = term->get_sort()->get_sorts();
+        size_t arity      = sorts.size() - 1;
         d_funs[arity].insert(term);
+        Signature sig = get_signature({sorts.begin(), sorts.begin() + arity});
+        auto fit      = d_funs_by_sig.try_emplace(sig, d_vars.size()).first;
+        fit->second.add(term, level);
       }
     }
     else
@@ -325,6 +488,24 @@ TermDb::add_input(Term& input, Sort& sort, SortKind sort_kind)
   add_term(input, sort, sort_kind);
 }
 
+void
+TermDb::add_value(Term& value, Sort& sort, SortKind sort_kind)
+{
+  assert(value.get());
+  add_term(value, sort, sort_kind);
+  value->set_leaf_kind(AbsTerm::LeafKind::VALUE);
+
+  /* Index value (value may be an already existing, not yet indexed term). */
+  auto it = d_term_db.find(sort_kind);
+  if (it == d_term_db.end()) return;
+  auto iit = it->second.find(value->get_sort());
+  if (iit == it->second.end() || !iit->second.contains(value)) return;
+  const std::vector<uint64_t>& levels = get_levels(value);
+  size_t level                        = levels.empty() ? 0 : levels.back();
+  iit->second.add_value(value, level);
+  d_values.add(value, level);
+}
+
 void
 TermDb::add_var(Term& var, Sort& sort, SortKind sort_kind)
 {
@@ -370,7 +551,7 @@ TermDb::get_term(uint64_t id) const
   return nullptr;
 }
 
-const TermDb::SortSet
+const TermDb::SortSet&
 TermDb::get_sorts() const
 {
   return d_term_sorts;
@@ -379,20 +560,7 @@ TermDb::get_sorts() const
 bool
 TermDb::has_value() const
 {
-  for (const auto& p : d_term_db)
-  {
-    for (const auto& pp : p.second)
-    {
-      for (const auto& t : pp.second)
-      {
-        if (t->is_value())
-        {
-          return true;
-        }
-      }
-    }
-  }
-  return false;
+  return !d_values.empty();
 }
 
 bool
@@ -404,14 +572,7 @@ TermDb::has_value(Sort sort) const
     SortKind s_kind = sort->get_kind();
     assert(d_term_db.find(s_kind) != d_term_db.end());
     assert(d_term_db.at(s_kind).find(sort) != d_term_db.at(s_kind).end());
-    const TermRefs& terms = d_term_db.at(s_kind).at(sort);
-    for (const auto& t : terms)
-    {
-      if (t->get_leaf_kind() == AbsTerm::LeafKind::VALUE)
-      {
-        return true;
-      }
-    }
+    return d_term_db.at(s_kind).at(sort).has_value();
   }
   return false;
 }
@@ -514,6 +675,12 @@ TermDb::has_term() const
 bool
 TermDb::has_fun(const std::vector<Sort>& domain_sorts) const
 {
+  if (!d_rng.is_compat_sampling())
+  {
+    return d_funs_by_sig.find(get_signature(domain_sorts))
+           != d_funs_by_sig.end();
+  }
+
   size_t arity = domain_sorts.size();
   if (d_funs.find(arity) == d_funs.end()) return false;
   for (const auto& t : d_funs.at(arity))
@@ -566,6 +733,12 @@ Term
 TermDb::pick_value() const
 {
   assert(has_value());
+  if (!d_rng.is_compat_sampling())
+  {
+    return d_values.pick(d_rng);
+  }
+
+  /* Compatibility mode: pick from values in iteration order of d_term_db. */
   std::vector<Term> values;
   for (const auto& p : d_term_db)
   {
@@ -590,11 +763,17 @@ TermDb::pick_value(Sort sort) const
   assert(has_value(sort));
   assert(d_smgr.has_sort(sort));
 
-  std::vector<Term> values;
   SortKind s_kind = sort->get_kind();
   assert(d_term_db.find(s_kind) != d_term_db.end());
   assert(d_term_db.at(s_kind).find(sort) != d_term_db.at(s_kind).end());
   const TermRefs& terms = d_term_db.at(s_kind).at(sort);
+  if (!d_rng.is_compat_sampling())
+  {
+    return terms.pick_value(d_rng);
+  }
+
+  /* Compatibility mode: pick from values in iteration order of terms. */
+  std::vector<Term> values;
   for (auto& t : terms)
   {
     if (t->get_leaf_kind() == AbsTerm::LeafKind::VALUE)
@@ -648,6 +827,29 @@ TermDb::set_levels(const Term term, const std::vector<uint64_t>& levels)
   d_term_levels.emplace(term->get_id(), levels);
 }
 
+TermDb::Signature
+TermDb::get_signature(const std::vector<Sort>& domain_sorts)
+{
+  Signature res;
+  res.reserve(domain_sorts.size());
+  for (const auto& s : domain_sorts)
+  {
+    res.push_back(s->get_id());
+  }
+  return res;
+}
+
+size_t
+TermDb::SignatureHash::operator()(const Signature& sig) const
+{
+  size_t res = sig.size();
+  for (uint64_t id : sig)
+  {
+    res ^= std::hash<uint64_t>{}(id) + 0x9e3779b9 + (res << 6) + (res >> 2);
+  }
+  return res;
+}
+
 const std::vector<uint64_t>&
 TermDb::get_levels(const Term term) const
 {
@@ -732,6 +934,12 @@ Term
 TermDb::pick_fun(const std::vector<Sort>& domain_sorts)
 {
   assert(has_fun(domain_sorts));
+  if (!d_rng.is_compat_sampling())
+  {
+    return d_funs_by_sig.at(get_signature(domain_sorts)).pick(d_rng);
+  }
+
+  /* Compatibility mode: pick from matches in iteration order of d_funs. */
   size_t arity = domain_sorts.size();
   std::vector<Term> funs;
   for (const auto& t : d_funs.at(arity))
@@ -888,6 +1096,11 @@ void
 TermDb::push(Term& var)
 {
   d_vars.push_back(var);
+  d_values.push();
+  for (auto& p : d_funs_by_sig)
+  {
+    p.second.push();
+  }
 
   for (auto& p : d_term_db)
   {
@@ -908,33 +1121,53 @@ TermDb::pop(const Term& var)
   assert(d_vars[level] == var);
 
   d_vars.pop_back();
+  d_values.pop();
+
+  /* Pop current level from function index and remove empty signatures. */
+  for (auto it = d_funs_by_sig.begin(); it != d_funs_by_sig.end();)
+  {
+    it->second.pop();
+    if (it->second.empty())
+    {
+      it = d_funs_by_sig.erase(it);
+    }
+    else
+    {
+      ++it;
+    }
+  }
 
   /* Pop current level from d_term_db and cleanup. */
   for (auto it = d_term_db.begin(); it != d_term_db.end();)
   {
-    auto& skind = it->first;
     auto& skmap = it->second;
-    ++it;
 
     for (auto iit = skmap.begin(); iit != skmap.end();)
     {
-      auto& tref       = iit->second;
-      const auto& sort = iit->first;
-      ++iit;
+      auto& tref = iit->second;
 
       tref.pop();
 
-      /* Remove sorts without terms. */
+      /* Remove sorts without terms. Erasing from indexed maps moves other
+       * entries, only the returned iterator is valid. */
       if (tref.size() == 0)
       {
-        skmap.erase(sort);
+        iit = skmap.erase(iit);
+      }
+      else
+      {
+        ++iit;
       }
     }
 
     /* Remove sort kinds without terms. */
     if (skmap.empty())
     {
-      d_term_db.erase(skind);
+      it = d_term_db.erase(it);
+    }
+    else
+    {
+      ++it;
     }
   }
 
@@ -13,6 +13,7 @@
 #include <cstddef>
 #include <iterator>
 
+#include "indexed_set.hpp"
 #include "solver/solver.hpp"
 
 namespace murxla {
@@ -20,6 +21,38 @@ namespace murxla {
 class SolverManager;
 class RNGenerator;
 
+/**
+ * This class maintains a set of terms by scope level, for constant-time
+ * membership checks and uniform picking without scanning all stored terms.
+ * Used to index values and functions. Terms are identified by their id, i.e.,
+ * they must have been added to the term database.
+ */
+class ScopedTerms
+{
+ public:
+  ScopedTerms(size_t level);
+
+  /** Add term at given scope level (if not already added). */
+  void add(const Term& t, size_t level);
+  /** Check if term was already added. */
+  bool contains(const Term& t) const;
+  /** Pick random term (uniformly). */
+  Term pick(RNGenerator& rng) const;
+  /** Return number of stored terms. */
+  size_t size() const;
+  /** Return true if no terms are stored. */
+  bool empty() const;
+
+  void push();
+  void pop();
+
+ private:
+  /** The ids of the stored terms. */
+  std::unordered_set<uint64_t> d_ids;
+  /** Maps level to terms added at this level. */
+  std::vector<std::vector<Term>> d_terms;
+};
+
 /**
  * This class manages term references and random picking of terms based on
  * the number of references where terms with higher reference counts have lower
@@ -89,9 +122,21 @@ class TermRefs
 
   size_t get_num_terms(size_t level) const;
 
+  /**
+   * Mark stored term at given scope level as value.
+   * Values are additionally indexed for has_value() and pick_value().
+   */
+  void add_value(const Term& t, size_t level);
+  /** Return true if any stored term was marked as value. */
+  bool has_value() const;
+  /** Pick random value (uniformly). */
+  Term pick_value(RNGenerator& rng) const;
+
  private:
   size_t get_level_begin(size_t level);
   size_t get_level_end(size_t level);
+  /** Rebuild d_sampler and d_fresh from d_weights. */
+  void build_samplers();
 
   /** Map term to term index. */
   std::unordered_map<Term, size_t> d_idx;
@@ -103,16 +148,28 @@ class TermRefs
   std::vector<size_t> d_weights;
   /** Sum of all references d_refs, used to compute weights in pick(). */
   size_t d_refs_sum = 0;
+  /**
+   * Sampler over the pick weights of all terms that were picked before (fresh
+   * terms have weight 0), used by pick() if compatibility mode for weighted
+   * picks is disabled.
+   */
+  WeightedSampler d_sampler;
+  /** Sampler with weight 1 for fresh terms and 0 for all other terms. */
+  WeightedSampler d_fresh;
+  /** True if d_sampler and d_fresh are in sync with d_weights. */
+  bool d_samplers_valid = true;
 
   /* Maps level to number of corresponding terms. */
   std::vector<size_t> d_levels;
+  /** The values (terms with leaf kind VALUE) of d_terms. */
+  ScopedTerms d_values;
 };
 
 class TermDb
 {
  public:
-  using SortMap     = std::unordered_map<Sort, TermRefs>;
-  using SortSet     = std::unordered_set<Sort>;
+  using SortMap     = IndexedMap<Sort, TermRefs>;
+  using SortSet     = IndexedSet<Sort>;
   using SortKindSet = std::unordered_set<SortKind>;
   using SortTermMap = std::unordered_map<SortKind, SortMap>;
 
@@ -157,6 +214,13 @@ class TermDb
    */
   void add_input(Term& input, Sort& sort, SortKind sort_kind);
 
+  /**
+   * Add value to database.
+   * This is a specialization for values on top of add_term, sets the leaf
+   * kind of the value to VALUE.
+   */
+  void add_value(Term& value, Sort& sort, SortKind sort_kind);
+
   /**
    * Add variable to database.
    * This is a specialization for variables on top of add_term.
@@ -170,7 +234,7 @@ class TermDb
   Term get_term(uint64_t id) const;
 
   /** Returns all term sorts currently in the database. */
-  const SortSet get_sorts() const;
+  const SortSet& get_sorts() const;
 
   /** Return true if term database has a value. */
   bool has_value() const;
@@ -335,6 +399,14 @@ class TermDb
   size_t get_num_terms(SortKind sort_kind, size_t level) const;
 
  private:
+  /** The signature of a function, the ids of its domain sorts. */
+  using Signature = std::vector<uint64_t>;
+  /** Hash function for function signatures. */
+  struct SignatureHash
+  {
+    size_t operator()(const Signature& sig) const;
+  };
+
   /** Intermediate op kinds. */
   inline static std::unordered_set<Op::Kind> d_intermediate_op_kinds{
       Op::DT_MATCH_BIND_CASE, Op::DT_MATCH_CASE};
@@ -351,6 +423,9 @@ class TermDb
   /** Get unique scope levels for a given term. */
   const std::vector<uint64_t>& get_levels(const Term term) const;
 
+  /** Get the signature of functions with given domain sorts. */
+  static Signature get_signature(const std::vector<Sort>& domain_sorts);
+
   SolverManager& d_smgr;
 
   RNGenerator& d_rng;
@@ -379,8 +454,13 @@ class TermDb
    */
   std::unordered_map<uint64_t, Term> d_terms_intermediate;
 
-  /** Maps function term arity to function terms. */
+  /**
+   * Maps function term arity to function terms.
+   * Only used by has_fun() and pick_fun() in compatibility mode.
+   */
   std::unordered_map<size_t, std::unordered_set<Term>> d_funs;
+  /** Maps function signature to function terms. */
+  std::unordered_map<Signature, ScopedTerms, SignatureHash> d_funs_by_sig;
 
   /** Maps scope level to variable that opened the scope. */
   std::vector<Term> d_vars;
@@ -390,6 +470,12 @@ class TermDb
 
   /** Sorts currently used in d_term_db. */
   SortSet d_term_sorts;
+
+  /**
+   * The values (terms for which is_value() holds) of d_term_db. Values of a
+   * given sort are indexed in the corresponding TermRefs.
+   */
+  ScopedTerms d_values;
 };
 
 }  // namespace murxla
@@ -0,0 +1,191 @@
+/***
+ * Murxla: A Model-Based API Fuzzer for SMT solvers.
+ *
+ * This file is part of Murxla.
+ *
+ * Copyright (C) 2019-2022 by the authors listed in the AUTHORS file.
+ *
+ * See LICENSE for more information on using this software.
+ */
+#include "trace_buffer.hpp"
+
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+
+#include <cassert>
+#include <cerrno>
+#include <cstdlib>
+
+#include "config.hpp"
+
+namespace murxla {
+
+/* -------------------------------------------------------------------------- */
+
+namespace {
+
+/** The maximum number of trace buffers that may exist at the same time. */
+constexpr size_t MAX_TRACE_BUFFERS = 4;
+
+/** The currently existing trace buffers. */
+TraceBuffer* s_buffers[MAX_TRACE_BUFFERS];
+/** The number of currently existing trace buffers. */
+volatile sig_atomic_t s_num_buffers = 0;
+/** True if flush_all() is registered to be called at exit. */
+bool s_atexit_registered = false;
+
+/**
+ * The signals for which the trace buffers are written: fatal signals, and
+ * SIGTERM, which is sent to solver processes that time out before they are
+ * killed.
+ */
+constexpr int s_signals[] = {SIGABRT, SIGBUS, SIGFPE, SIGILL, SIGSEGV, SIGTERM};
+constexpr size_t NUM_SIGNALS = sizeof(s_signals) / sizeof(s_signals[0]);
+/** The signal actions that were installed before. */
+struct sigaction s_prev_actions[NUM_SIGNALS];
+
+void
+restore_signal_handlers()
+{
+  for (size_t i = 0; i < NUM_SIGNALS; ++i)
+  {
+    sigaction(s_signals[i], &s_prev_actions[i], nullptr);
+  }
+}
+
+/**
+ * Write all trace buffers and hand the signal over to the previously
+ * installed signal action.
+ */
+extern "C" void
+handle_signal(int sig, siginfo_t* info, void* context)
+{
+  (void) context;
+  int saved_errno = errno;
+  TraceBuffer::flush_all();
+  restore_signal_handlers();
+  errno = saved_errno;
+  /* Faults detected by the kernel (e.g., a segmentation fault) reoccur when
+   * returning from the handler, signals that were sent (e.g., by abort()) are
+   * raised again and delivered when returning from the handler. */
+  if (info->si_code <= 0)
+  {
+    raise(sig);
+  }
+}
+
+void
+install_signal_handlers()
+{
+  struct sigaction action;
+  action.sa_sigaction = handle_signal;
+  action.sa_flags     = SA_SIGINFO;
+  sigemptyset(&action.sa_mask);
+  for (size_t i = 0; i < NUM_SIGNALS; ++i)
+  {
+    sigaction(s_signals[i], &action, &s_prev_actions[i]);
+  }
+}
+
+extern "C" void
+flush_all_at_exit()
+{
+  TraceBuffer::flush_all();
+}
+
+}  // namespace
+
+/* -------------------------------------------------------------------------- */
+
+TraceBuffer::TraceBuffer(const std::string& file_name)
+    : d_buffer(MURXLA_TRACE_BUFFER_SIZE)
+{
+  d_fd =
+      open(file_name.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+  setp(d_buffer.data(), d_buffer.data() + d_buffer.size());
+
+  assert(static_cast<size_t>(s_num_buffers) < MAX_TRACE_BUFFERS);
+  if (s_num_buffers == 0)
+  {
+    install_signal_handlers();
+  }
+  if (!s_atexit_registered)
+  {
+    std::atexit(flush_all_at_exit);
+    s_atexit_registered = true;
+  }
+  s_buffers[s_num_buffers] = this;
+  s_num_buffers            = s_num_buffers + 1;
+}
+
+TraceBuffer::~TraceBuffer()
+{
+  for (sig_atomic_t i = 0; i < s_num_buffers; ++i)
+  {
+    if (s_buffers[i] == this)
+    {
+      s_buffers[i]  = s_buffers[s_num_buffers - 1];
+      s_num_buffers = s_num_buffers - 1;
+      break;
+    }
+  }
+  if (s_num_buffers == 0)
+  {
+    restore_signal_handlers();
+  }
+
+  write_buffer();
+  if (d_fd >= 0)
+  {
+    close(d_fd);
+  }
+}
+
+bool
+TraceBuffer::write_buffer()
+{
+  const char* data = pbase();
+  size_t size      = pptr() - pbase();
+  while (size > 0 && d_fd >= 0)
+  {
+    ssize_t n = write(d_fd, data, size);
+    if (n < 0)
+    {
+      if (errno == EINTR) continue;
+      return false;
+    }
+    data += n;
+    size -= n;
+  }
+  setp(d_buffer.data(), d_buffer.data() + d_buffer.size());
+  return d_fd >= 0;
+}
+
+void
+TraceBuffer::flush_all()
+{
+  for (sig_atomic_t i = 0; i < s_num_buffers; ++i)
+  {
+    s_buffers[i]->write_buffer();
+  }
+}
+
+TraceBuffer::int_type
+TraceBuffer::overflow(int_type c)
+{
+  if (!write_buffer())
+  {
+    return traits_type::eof();
+  }
+  if (!traits_type::eq_int_type(c, traits_type::eof()))
+  {
+    *pptr() = traits_type::to_char_type(c);
+    pbump(1);
+  }
+  return traits_type::not_eof(c);
+}
+
+/* -------------------------------------------------------------------------- */
+
+}  // namespace murxla
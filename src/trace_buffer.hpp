@@ -0,0 +1,72 @@
+/***
+ * Murxla: A Model-Based API Fuzzer for SMT solvers.
+ *
+ * This file is part of Murxla.
+ *
+ * Copyright (C) 2019-2022 by the authors listed in the AUTHORS file.
+ *
+ * See LICENSE for more information on using this software.
+ */
+#ifndef __MURXLA__TRACE_BUFFER_H
+#define __MURXLA__TRACE_BUFFER_H
+
+#include <streambuf>
+#include <string>
+#include <vector>
+
+namespace murxla {
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Stream buffer for buffered trace output (--buffer-trace).
+ *
+ * Output is collected in a large user-space buffer and only written to the
+ * output file when the buffer is full, or at explicit flush points via
+ * flush_all() (e.g., before check-sat calls, since these may run into a time
+ * limit). Flushing the stream (as done after every traced statement) does not
+ * write the buffer.
+ *
+ * While trace buffers exist, handlers for fatal signals and SIGTERM are
+ * installed that write all trace buffers before the signal is handled as
+ * before, and the buffers are written at exit(). This keeps traces that
+ * trigger a crash or time out complete.
+ */
+class TraceBuffer : public std::streambuf
+{
+ public:
+  /**
+   * Constructor.
+   * @param file_name The name of the output file, created or truncated.
+   */
+  TraceBuffer(const std::string& file_name);
+  /** Destructor. Writes the buffer and closes the output file. */
+  ~TraceBuffer();
+
+  /** @return True if the output file was successfully opened. */
+  bool is_open() const { return d_fd >= 0; }
+
+  /**
+   * Write the buffered output to the output file. Async-signal-safe.
+   * @return False if writing failed.
+   */
+  bool write_buffer();
+
+  /** Write the buffers of all trace buffers. Async-signal-safe. */
+  static void flush_all();
+
+ protected:
+  int_type overflow(int_type c) override;
+
+ private:
+  /** The file descriptor of the output file. */
+  int d_fd;
+  /** The buffer. */
+  std::vector<char> d_buffer;
+};
+
+/* -------------------------------------------------------------------------- */
+
+}  // namespace murxla
+
+#endif
@@ -19,7 +19,6 @@
 #include <iomanip>
 #include <limits>
 #include <sstream>
-#include <unordered_map>
 
 #include "except.hpp"
 
@@ -27,128 +26,206 @@ namespace murxla {
 
 /* -------------------------------------------------------------------------- */
 
-static std::unordered_map<std::string, std::string> s_hex_lookup = {
-    {"0", "0"},    {"00", "0"},   {"000", "0"},  {"0000", "0"},
-    {"1", "1"},    {"01", "1"},   {"001", "1"},  {"0001", "1"},
-    {"10", "2"},   {"010", "2"},  {"0010", "2"},
-    {"11", "3"},   {"011", "3"},  {"0011", "3"},
-    {"100", "4"},  {"0100", "4"},
-    {"101", "5"},  {"0101", "5"},
-    {"110", "6"},  {"0110", "6"},
-    {"111", "7"},  {"0111", "7"},
-    {"1000", "8"}, {"1001", "9"}, {"1010", "a"}, {"1011", "b"},
-    {"1100", "c"}, {"1101", "d"}, {"1110", "e"}, {"1111", "f"}};
+namespace {
 
-/* -------------------------------------------------------------------------- */
+/** The number of decimal digits per word in decimal conversions. */
+constexpr size_t DEC_DIGITS_PER_WORD = 19;
+/** 10^DEC_DIGITS_PER_WORD, the largest power of 10 that fits into a word. */
+constexpr uint64_t DEC_WORD_BASE = 10000000000000000000ull;
 
-namespace {
-/** Strip leading zeros of given string. */
-std::string
-strip_zeros(std::string s)
+/** Convert a hexadecimal digit to its value. */
+uint32_t
+hex_digit_value(char ch)
 {
-  s.erase(s.begin(), std::find_if(s.begin(), s.end(), [](unsigned char ch) {
-            return ch != '0';
-          }));
-  return s;
+  if ('0' <= ch && ch <= '9') return ch - '0';
+  if ('a' <= ch && ch <= 'f') return ch - 'a' + 10;
+  assert('A' <= ch && ch <= 'F');
+  return ch - 'A' + 10;
 }
 
-/** Add two binary numbers given as strings. */
-std::string
-add_unbounded_bin_str(std::string a, std::string b)
-{
-  a = strip_zeros(a);
-  b = strip_zeros(b);
+}  // namespace
 
-  if (a.empty()) return b;
-  if (b.empty()) return a;
+/* -------------------------------------------------------------------------- */
 
-  size_t asize = a.size();
-  size_t bsize = b.size();
-  size_t rsize = (asize < bsize) ? bsize + 1 : asize + 1;
-  std::string res(rsize, '0');
+BigUInt::BigUInt(uint64_t value)
+{
+  if (value) d_words.push_back(value);
+}
 
-  char c = '0';
-  for (uint32_t i = 0; i < rsize; ++i)
+BigUInt
+BigUInt::from_bin_str(const std::string& str)
+{
+  BigUInt res;
+  size_t n = str.size();
+  res.d_words.assign((n + 63) / 64, 0);
+  for (size_t i = 0; i < n; ++i)
   {
-    char x             = i < asize ? a[asize - i - 1] : '0';
-    char y             = i < bsize ? b[bsize - i - 1] : '0';
-    char s             = x ^ y ^ c;
-    c                  = (x & y) | (x & c) | (y & c);
-    res[rsize - i - 1] = s;
+    if (str[n - 1 - i] == '1')
+    {
+      res.d_words[i / 64] |= uint64_t(1) << (i % 64);
+    }
   }
-  return strip_zeros(res);
+  res.normalize();
+  return res;
 }
 
-/** Multiply two binary numbers given as strings. */
-std::string
-mult_unbounded_bin_str(std::string a, std::string b)
+BigUInt
+BigUInt::from_dec_str(const std::string& str)
 {
-  a = strip_zeros(a);
-
-  if (a.empty()) return a;
-
-  if (a[0] == '1' && !a[1]) return b;
-
-  b = strip_zeros(b);
-
-  if (b.empty()) return b;
-
-  if (b[0] == '1' && !b[1]) return a;
+  BigUInt res;
+  size_t n = str.size();
+  /* Consume the digits in chunks of DEC_DIGITS_PER_WORD digits, the first
+   * chunk holds the remaining digits. */
+  size_t len = n % DEC_DIGITS_PER_WORD;
+  if (len == 0) len = DEC_DIGITS_PER_WORD;
+  for (size_t i = 0; i < n; i += len, len = DEC_DIGITS_PER_WORD)
+  {
+    uint64_t chunk = 0, base = 1;
+    for (size_t j = i; j < i + len; ++j)
+    {
+      assert('0' <= str[j] && str[j] <= '9');
+      chunk = chunk * 10 + (str[j] - '0');
+      base *= 10;
+    }
+    res.mul_add(base, chunk);
+  }
+  return res;
+}
 
-  size_t asize = a.size();
-  size_t bsize = b.size();
-  size_t rsize = asize + bsize;
+BigUInt
+BigUInt::from_hex_str(const std::string& str)
+{
+  BigUInt res;
+  size_t n = str.size();
+  res.d_words.assign((n + 15) / 16, 0);
+  for (size_t i = 0; i < n; ++i)
+  {
+    res.d_words[i / 16] |= uint64_t(hex_digit_value(str[n - 1 - i]))
+                           << (4 * (i % 16));
+  }
+  res.normalize();
+  return res;
+}
 
-  std::string res(rsize, '0');
-  for (size_t i = 0, n = a.size(); i < n; ++i) res[bsize + i] = a[i];
+std::string
+BigUInt::to_bin_str() const
+{
+  if (is_zero()) return "0";
+  size_t n = bit_length();
+  std::string res(n, '0');
+  for (size_t i = 0; i < n; ++i)
+  {
+    if ((d_words[i / 64] >> (i % 64)) & 1) res[n - 1 - i] = '1';
+  }
+  return res;
+}
 
-  for (size_t i = 0; i < asize; ++i)
+std::string
+BigUInt::to_dec_str() const
+{
+  if (is_zero()) return "0";
+  BigUInt val = *this;
+  std::vector<uint64_t> chunks;
+  while (!val.is_zero())
   {
-    char m = res[rsize - 1];
-    char c = '0';
+    chunks.push_back(val.div(DEC_WORD_BASE));
+  }
+  std::string res = std::to_string(chunks.back());
+  for (size_t i = chunks.size() - 1; i > 0; --i)
+  {
+    std::string chunk = std::to_string(chunks[i - 1]);
+    res.append(DEC_DIGITS_PER_WORD - chunk.size(), '0');
+    res.append(chunk);
+  }
+  return res;
+}
 
-    if (m == '1')
-    {
-      for (size_t j = bsize; j > 0; --j)
-      {
-        char x     = b[j - 1];
-        char y     = res[j - 1];
-        char s     = x ^ y ^ c;
-        c          = (x & y) | (x & c) | (y & c);
-        res[j - 1] = s;
-      }
-    }
-    std::string subres = res.substr(0, rsize - 1);
-    res.replace(res.begin() + 1, res.end(), subres.begin(), subres.end());
-    res[0] = c;
+std::string
+BigUInt::to_hex_str() const
+{
+  if (is_zero()) return "0";
+  static const char* digits = "0123456789abcdef";
+  size_t n                  = (bit_length() + 3) / 4;
+  std::string res(n, '0');
+  for (size_t i = 0; i < n; ++i)
+  {
+    res[n - 1 - i] = digits[(d_words[i / 16] >> (4 * (i % 16))) & 0xf];
   }
+  return res;
+}
 
+size_t
+BigUInt::bit_length() const
+{
+  if (is_zero()) return 0;
+  uint64_t top = d_words.back();
+  size_t res   = 64 * (d_words.size() - 1);
+  while (top)
+  {
+    res += 1;
+    top >>= 1;
+  }
   return res;
 }
 
-/** Convert a digit to its binary representation; */
-const char*
-digit2bin(char ch)
+BigUInt&
+BigUInt::mul_add(uint64_t mul, uint64_t add)
 {
-  assert('0' <= ch);
-  assert(ch <= '9');
+  unsigned __int128 carry = add;
+  for (uint64_t& word : d_words)
+  {
+    carry += static_cast<unsigned __int128>(word) * mul;
+    word = static_cast<uint64_t>(carry);
+    carry >>= 64;
+  }
+  if (carry) d_words.push_back(static_cast<uint64_t>(carry));
+  normalize();
+  return *this;
+}
 
-  const char* table[10] = {
-      "",
-      "1",
-      "10",
-      "11",
-      "100",
-      "101",
-      "110",
-      "111",
-      "1000",
-      "1001",
-  };
+uint64_t
+BigUInt::div(uint64_t div)
+{
+  assert(div);
+  unsigned __int128 rem = 0;
+  for (size_t i = d_words.size(); i > 0; --i)
+  {
+    rem            = (rem << 64) | d_words[i - 1];
+    d_words[i - 1] = static_cast<uint64_t>(rem / div);
+    rem %= div;
+  }
+  normalize();
+  return static_cast<uint64_t>(rem);
+}
 
-  return table[ch - '0'];
+BigUInt&
+BigUInt::negate(size_t n)
+{
+  assert(bit_length() <= n);
+  /* ~this + 1 in n bits, the carry into bit n only remains if this is 0. */
+  d_words.resize(n / 64 + 1, 0);
+  for (uint64_t& word : d_words) word = ~word;
+  if (n % 64)
+  {
+    d_words[n / 64] &= (uint64_t(1) << (n % 64)) - 1;
+  }
+  else
+  {
+    d_words[n / 64] = 0;
+  }
+  for (uint64_t& word : d_words)
+  {
+    if (++word != 0) break;
+  }
+  normalize();
+  return *this;
+}
+
+void
+BigUInt::normalize()
+{
+  while (!d_words.empty() && d_words.back() == 0) d_words.pop_back();
 }
-}  // namespace
 
 /* -------------------------------------------------------------------------- */
 
@@ -169,84 +246,45 @@ uint32_to_value_in_range(uint32_t val, uint32_t from, uint32_t to)
 std::string
 str_bin_to_hex(const std::string& str_bin)
 {
-  std::stringstream ss;
-  std::vector<std::string> stack;
-  for (size_t i = 0, n = str_bin.size(); i < n; i += 4)
+  /* One digit per group of 4 bits, starting from the least significant bit,
+   * i.e., leading zeros are preserved. */
+  static const char* digits = "0123456789abcdef";
+  size_t n                  = str_bin.size();
+  std::string res((n + 3) / 4, '0');
+  for (size_t i = 0; i < n; ++i)
   {
-    size_t len = n - i >= 4 ? 4 : n - i;
-    std::string chunk(len, 0);
-    for (uint32_t j = 0; j <= len; ++j) chunk[len - j] = str_bin[n - i - j];
-    stack.push_back(s_hex_lookup.at(chunk));
+    if (str_bin[n - 1 - i] == '1')
+    {
+      char& digit = res[res.size() - 1 - i / 4];
+      digit       = digits[hex_digit_value(digit) | (1u << (i % 4))];
+    }
   }
-  for (size_t i = 0, n = stack.size(); i < n; ++i) ss << stack[n - 1 - i];
-  return ss.str();
+  return res;
 }
 
 std::string
 str_bin_to_dec(const std::string& str_bin, bool sign)
 {
-  std::string _str_bin = str_bin;
+  BigUInt val = BigUInt::from_bin_str(str_bin);
   if (sign)
   {
-    // negate
-    for (auto& c : _str_bin) c = c == '1' ? '0' : '1';           // xor
-    _str_bin = add_unbounded_bin_str(_str_bin, digit2bin('1'));  // + 1
-  }
-
-  std::string digits(_str_bin.size(), 0);
-
-  // from MSB to LSB
-  for (const auto& c : _str_bin)
-  {
-    // shift digits, with carry
-    uint32_t carry = 0;
-    for (auto& digit : digits)
-    {
-      uint32_t d = digit * 2 + carry;
-      carry      = d > 9;
-      digit      = static_cast<char>(d % 10);
-    }
-    // add new bit
-    if (c == '1') digits[0] |= 1;
-  }
-
-  // Note: digits are in reverse order, with leading zeros on the right
-  size_t pos = 0;
-  size_t n   = digits.size();
-  for (pos = 0; pos <= n; ++pos)
-  {
-    if (digits[n - pos] != 0) break;
-  }
-  std::stringstream ss;
-  if (pos > n) return "0";
-  for (size_t i = pos; i <= n; ++i)
-  {
-    ss << ((char) (digits[n - i] + '0'));
+    return '-' + val.negate(str_bin.size()).to_dec_str();
   }
-  if (sign) return '-' + ss.str();
-  return ss.str();
+  return val.to_dec_str();
 }
 
 std::string
 str_dec_to_bin(const std::string& str_dec)
 {
-  std::string res;
   bool is_neg = str_dec[0] == '-';
-  size_t i    = is_neg ? 1 : 0;
-
-  for (size_t n = str_dec.size(); i < n; ++i)
+  BigUInt val = BigUInt::from_dec_str(is_neg ? str_dec.substr(1) : str_dec);
+  assert(val.to_dec_str() == (is_neg ? str_dec.substr(1) : str_dec));
+  if (val.is_zero()) return "0";
+  if (is_neg)
   {
-    res = mult_unbounded_bin_str(res, "1010");                // * 10
-    res = add_unbounded_bin_str(res, digit2bin(str_dec[i]));  // + digit
+    val.negate(val.bit_length());
   }
-  assert(strip_zeros(res) == res);
-  assert(str_bin_to_dec(res) == (is_neg ? str_dec.substr(1) : str_dec));
-  if (res.empty()) return "0";
-  if (!is_neg) return res;
-  /* negate */
-  for (auto& c : res) c = c == '1' ? '0' : '1';      // xor
-  res = add_unbounded_bin_str(res, digit2bin('1'));  // + 1
-  return res;
+  return val.to_bin_str();
 }
 
 uint64_t
@@ -651,6 +689,81 @@ rstrip(std::string& s)
   return s;
 }
 
+namespace {
+
+uint64_t
+rotl64(uint64_t x, int r)
+{
+  return (x << r) | (x >> (64 - r));
+}
+
+uint64_t
+fmix64(uint64_t k)
+{
+  k ^= k >> 33;
+  k *= 0xff51afd7ed558ccd;
+  k ^= k >> 33;
+  k *= 0xc4ceb9fe1a85ec53;
+  k ^= k >> 33;
+  return k;
+}
+
+/** Load 'n' bytes starting at 'data' as little-endian integer. */
+uint64_t
+load64(const char* data, size_t n)
+{
+  uint64_t res = 0;
+  for (size_t i = 0; i < n; ++i)
+  {
+    uint64_t byte = static_cast<unsigned char>(data[i]);
+    res |= byte << (8 * i);
+  }
+  return res;
+}
+
+}  // namespace
+
+std::array<uint64_t, 2>
+hash128(const std::string& s)
+{
+  const uint64_t c1 = 0x87c37b91114253d5;
+  const uint64_t c2 = 0x4cf5ad432745937f;
+  const char* data  = s.data();
+  size_t len        = s.size();
+  uint64_t h1 = 0, h2 = 0;
+
+  for (size_t i = 0, n = len / 16; i < n; ++i, data += 16)
+  {
+    uint64_t k1 = load64(data, 8);
+    uint64_t k2 = load64(data + 8, 8);
+
+    h1 ^= rotl64(k1 * c1, 31) * c2;
+    h1 = (rotl64(h1, 27) + h2) * 5 + 0x52dce729;
+    h2 ^= rotl64(k2 * c2, 33) * c1;
+    h2 = (rotl64(h2, 31) + h1) * 5 + 0x38495ab5;
+  }
+
+  size_t tail = len % 16;
+  if (tail > 8)
+  {
+    h2 ^= rotl64(load64(data + 8, tail - 8) * c2, 33) * c1;
+  }
+  if (tail > 0)
+  {
+    h1 ^= rotl64(load64(data, std::min<size_t>(tail, 8)) * c1, 31) * c2;
+  }
+
+  h1 ^= len;
+  h2 ^= len;
+  h1 += h2;
+  h2 += h1;
+  h1 = fmix64(h1);
+  h2 = fmix64(h2);
+  h1 += h2;
+  h2 += h1;
+  return {h1, h2};
+}
+
 /* -------------------------------------------------------------------------- */
 
 }  // namespace murxla
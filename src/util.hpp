@@ -10,6 +10,7 @@
 #ifndef __MURXLA__UTIL_H
 #define __MURXLA__UTIL_H
 
+#include <array>
 #include <cstdint>
 #include <string>
 #include <vector>
@@ -22,6 +23,67 @@ uint32_t uint32_to_value_in_range(uint32_t val, uint32_t from, uint32_t to);
 
 /* -------------------------------------------------------------------------- */
 
+/**
+ * An arbitrary-precision unsigned integer, stored as a little-endian vector of
+ * 64-bit words (limbs).
+ *
+ * This only supports the operations required to convert values between binary,
+ * decimal and hexadecimal string representations.
+ */
+class BigUInt
+{
+ public:
+  /** Constructor, creates value zero. */
+  BigUInt() = default;
+  /** Constructor, creates given value. */
+  BigUInt(uint64_t value);
+
+  /**
+   * Create value from a binary string. Characters other than '1' are
+   * interpreted as '0'.
+   */
+  static BigUInt from_bin_str(const std::string& str);
+  /** Create value from a decimal string (digits only). */
+  static BigUInt from_dec_str(const std::string& str);
+  /** Create value from a hexadecimal string (digits only). */
+  static BigUInt from_hex_str(const std::string& str);
+
+  /** @return The binary string of this value, without leading zeros. */
+  std::string to_bin_str() const;
+  /** @return The decimal string of this value, without leading zeros. */
+  std::string to_dec_str() const;
+  /**
+   * @return The (lower case) hexadecimal string of this value, without
+   *         leading zeros.
+   */
+  std::string to_hex_str() const;
+
+  /** @return True if this value is zero. */
+  bool is_zero() const { return d_words.empty(); }
+  /** @return The number of bits required to represent this value. */
+  size_t bit_length() const;
+
+  /** Compute this * mul + add. */
+  BigUInt& mul_add(uint64_t mul, uint64_t add);
+  /**
+   * Compute this / div.
+   * @return The remainder.
+   */
+  uint64_t div(uint64_t div);
+  /**
+   * Compute 2^n - this, i.e., the two's complement of this value in n bits
+   * (2^n if this value is zero). Requires that this value fits into n bits.
+   */
+  BigUInt& negate(size_t n);
+
+ private:
+  /** Remove leading zero words. */
+  void normalize();
+
+  /** The words, least significant first, without leading zero words. */
+  std::vector<uint64_t> d_words;
+};
+
 /** Convert a binary string to a hexadecimal string. */
 std::string str_bin_to_hex(const std::string& str_bin);
 /** Convert a binary string to a decimal string. */
@@ -144,6 +206,12 @@ std::vector<std::string> split(const std::string& s, const char delim);
 /** Remove trailing whitespaces. */
 std::string& rstrip(std::string& s);
 
+/**
+ * Compute the 128-bit MurmurHash3 (x64 variant, seed 0) of string 's'.
+ * Return the two 64-bit halves of the hash value.
+ */
+std::array<uint64_t, 2> hash128(const std::string& s);
+
 /* -------------------------------------------------------------------------- */
 
 template <typename T, typename P>
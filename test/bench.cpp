@@ -0,0 +1,253 @@
+/**
+ * Micro-benchmarks.
+ *
+ * These are not part of the unit tests since their timings depend on the load
+ * of the machine. Build target 'bench' and run 'bench [<name> ...]' to run all
+ * or only the given benchmarks.
+ */
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "error_index.hpp"
+#include "ref_util.hpp"
+#include "rng.hpp"
+#include "util.hpp"
+
+using namespace murxla;
+
+namespace {
+
+/** Run given function and return its runtime in microseconds. */
+int64_t
+measure(const std::function<void()>& fun)
+{
+  auto start = std::chrono::steady_clock::now();
+  fun();
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+/** Print the runtimes of the variants of a benchmark. */
+void
+report(const std::string& what,
+       const std::vector<std::pair<std::string, int64_t>>& times)
+{
+  std::cout << what << ":";
+  for (const auto& [variant, us] : times)
+  {
+    std::cout << " " << variant << " " << us << "us";
+  }
+  std::cout << std::endl;
+}
+
+/**
+ * Pick from many weights, updating the weight of the picked index after each
+ * pick (as done by TermRefs::pick()), with std::discrete_distribution
+ * (compatibility mode) vs. WeightedSampler.
+ */
+void
+bench_pick_weighted()
+{
+  const size_t size  = 20000;
+  const size_t picks = 1000;
+
+  std::vector<uint64_t> weights(size);
+  for (size_t i = 0; i < size; ++i)
+  {
+    weights[i] = 1 + i % 100;
+  }
+
+  RNGenerator rng_dd(1);
+  std::vector<uint64_t> weights_dd = weights;
+  int64_t time_dd                  = measure([&]() {
+    for (size_t i = 0; i < picks; ++i)
+    {
+      uint64_t idx = rng_dd.pick_weighted<uint64_t>(weights_dd);
+      weights_dd[idx] += 1;
+    }
+  });
+
+  RNGenerator rng_ws(1);
+  WeightedSampler sampler;
+  int64_t time_ws = measure([&]() {
+    sampler.assign(weights.begin(), weights.end());
+    for (size_t i = 0; i < picks; ++i)
+    {
+      size_t idx = rng_ws.pick_weighted(sampler, 0, size);
+      sampler.set(idx, sampler.get(idx) + 1);
+    }
+  });
+
+  report(std::to_string(picks) + " picks from " + std::to_string(size)
+             + " weights",
+         {{"discrete_distribution", time_dd}, {"WeightedSampler", time_ws}});
+}
+
+/**
+ * Convert wide binary strings to decimal strings, with the character-based
+ * reference implementation vs. BigUInt.
+ */
+void
+bench_str_bin_to_dec()
+{
+  const size_t width = 1024;
+  const size_t count = 20;
+
+  std::mt19937_64 rng(1);
+  std::vector<std::string> values(count, std::string(width, '0'));
+  for (auto& v : values)
+  {
+    for (auto& c : v) c = rng() % 2 ? '1' : '0';
+  }
+
+  std::vector<std::string> res_ref, res;
+  int64_t time_ref = measure([&]() {
+    for (const auto& v : values) res_ref.push_back(test::ref_str_bin_to_dec(v));
+  });
+  int64_t time_big = measure([&]() {
+    for (const auto& v : values) res.push_back(str_bin_to_dec(v));
+  });
+
+  report(std::to_string(count) + " conversions of " + std::to_string(width)
+             + "-bit values",
+         {{"per-digit", time_ref}, {"BigUInt", time_big}});
+}
+
+/**
+ * Pick long decimal numerals one digit per draw (compatibility mode) vs.
+ * multiple digits per draw.
+ */
+void
+bench_pick_string()
+{
+  const uint32_t len   = 1000;
+  const size_t strings = 1000;
+
+  RNGenerator rng_compat(1);
+  rng_compat.set_compat_sampling(true);
+  size_t size         = 0;
+  int64_t time_compat = measure([&]() {
+    for (size_t i = 0; i < strings; ++i)
+    {
+      size += rng_compat.pick_dec_int_string(len).size();
+    }
+  });
+
+  RNGenerator rng_batch(1);
+  std::string buf;
+  int64_t time_batch = measure([&]() {
+    for (size_t i = 0; i < strings; ++i)
+    {
+      buf.clear();
+      rng_batch.pick_dec_int_string(len, buf);
+      size += buf.size();
+    }
+  });
+
+  report(std::to_string(size / 2) + " digits in numerals of length "
+             + std::to_string(len),
+         {{"per-digit", time_compat}, {"batched", time_batch}});
+}
+
+/**
+ * Look up new and similar errors among many known errors, with ErrorIndex vs.
+ * comparing with every known error.
+ */
+void
+bench_error_index()
+{
+  const size_t known   = 1000;
+  const size_t lookups = 200;
+
+  std::vector<std::string> words;
+  for (size_t i = 1; i <= 2000; ++i)
+  {
+    std::string word;
+    for (size_t k = i; k > 0; k /= 26)
+    {
+      word += static_cast<char>('a' + k % 26);
+    }
+    words.push_back(word);
+  }
+  std::mt19937_64 rng(1);
+  auto gen_error = [&]() {
+    std::string res = "error:";
+    for (size_t i = 0, n = 5 + rng() % 40; i < n; ++i)
+    {
+      res += " " + words[rng() % words.size()];
+    }
+    return res;
+  };
+
+  ErrorIndex index;
+  std::vector<std::string> errors;
+  for (size_t i = 0; i < known; ++i)
+  {
+    errors.push_back(gen_error());
+    index.add(errors.back());
+  }
+  /* Every other query is a known error with a different number. */
+  std::vector<std::string> queries;
+  for (size_t i = 0; i < lookups; ++i)
+  {
+    queries.push_back(i % 2 ? errors[rng() % known] + " 42" : gen_error());
+  }
+
+  size_t found        = 0;
+  int64_t time_linear = measure([&]() {
+    for (const auto& q : queries)
+    {
+      for (const auto& e : errors)
+      {
+        if (ErrorIndex::diff(q, e) <= ErrorIndex::MAX_DIFF)
+        {
+          found += 1;
+          break;
+        }
+      }
+    }
+  });
+  int64_t time_index = measure([&]() {
+    for (const auto& q : queries) found += index.find(q) != nullptr;
+  });
+
+  report(std::to_string(lookups) + " lookups among " + std::to_string(known)
+             + " errors (" + std::to_string(found / 2) + " found)",
+         {{"linear", time_linear}, {"ErrorIndex", time_index}});
+}
+
+/** The benchmarks by name. */
+const std::vector<std::pair<const char*, void (*)()>> s_benchmarks = {
+    {"pick_weighted", bench_pick_weighted},
+    {"str_bin_to_dec", bench_str_bin_to_dec},
+    {"pick_string", bench_pick_string},
+    {"error_index", bench_error_index},
+};
+
+}  // namespace
+
+int
+main(int argc, char* argv[])
+{
+  for (const auto& [name, bench] : s_benchmarks)
+  {
+    bool run = argc == 1;
+    for (int i = 1; i < argc && !run; ++i)
+    {
+      run = std::strcmp(argv[i], name) == 0;
+    }
+    if (run)
+    {
+      std::cout << "[" << name << "] ";
+      bench();
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,70 @@
+/**
+ * Memory benchmark for Smt2Term.
+ *
+ * Counts the heap memory allocated (via operator new) when creating SMT2
+ * terms. Not part of the unit tests since Smt2Term depends on the whole
+ * solver stack. Build target 'bench-smt2-term' and run 'bench-smt2-term [<n>]'
+ * to create <n> terms (default: 10000).
+ */
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "solver/smt2/smt2_solver.hpp"
+
+using namespace murxla;
+
+namespace {
+
+/** The number of bytes allocated via operator new so far. */
+size_t s_allocated = 0;
+
+}  // namespace
+
+void*
+operator new(size_t size)
+{
+  s_allocated += size;
+  if (void* res = std::malloc(size ? size : 1))
+  {
+    return res;
+  }
+  throw std::bad_alloc();
+}
+
+void
+operator delete(void* ptr) noexcept
+{
+  std::free(ptr);
+}
+
+void
+operator delete(void* ptr, size_t size) noexcept
+{
+  (void) size;
+  std::free(ptr);
+}
+
+int
+main(int argc, char* argv[])
+{
+  size_t n = argc > 1 ? std::stoul(argv[1]) : 10000;
+
+  std::vector<Term> terms;
+  terms.reserve(n);
+  Term a(new smt2::Smt2Term(Op::UNDEFINED, {}, {}, {}, "a"));
+
+  size_t allocated = s_allocated;
+  for (size_t i = 0; i < n; ++i)
+  {
+    terms.emplace_back(new smt2::Smt2Term(Op::AND, {}, {a, a}, {}, ""));
+  }
+  allocated = s_allocated - allocated;
+
+  std::cout << n << " terms: " << allocated / n
+            << " bytes allocated per term, sizeof(Smt2Term) "
+            << sizeof(smt2::Smt2Term) << std::endl;
+  return 0;
+}
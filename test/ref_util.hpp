@@ -0,0 +1,44 @@
+/**
+ * Reference implementations of utility functions, for checking the optimized
+ * implementations in unit tests and comparing against them in benchmarks.
+ */
+#ifndef __MURXLA__TEST__REF_UTIL_H
+#define __MURXLA__TEST__REF_UTIL_H
+
+#include <cstdint>
+#include <string>
+
+namespace murxla::test {
+
+/**
+ * Reference implementation of str_bin_to_dec() (unsigned), operating on one
+ * decimal digit per character (the implementation before BigUInt).
+ */
+inline std::string
+ref_str_bin_to_dec(const std::string& str_bin)
+{
+  std::string digits(str_bin.size(), 0);
+  for (const auto& c : str_bin)
+  {
+    uint32_t carry = 0;
+    for (auto& digit : digits)
+    {
+      uint32_t d = digit * 2 + carry;
+      carry      = d > 9;
+      digit      = static_cast<char>(d % 10);
+    }
+    if (c == '1') digits[0] |= 1;
+  }
+  while (!digits.empty() && digits.back() == 0) digits.pop_back();
+  if (digits.empty()) return "0";
+  std::string res;
+  for (auto it = digits.rbegin(); it != digits.rend(); ++it)
+  {
+    res.push_back(*it + '0');
+  }
+  return res;
+}
+
+}  // namespace murxla::test
+
+#endif
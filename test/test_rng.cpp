@@ -0,0 +1,352 @@
+#include <algorithm>
+#include <iterator>
+#include <numeric>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "indexed_set.hpp"
+#include "rng.hpp"
+
+using namespace murxla;
+
+TEST(rng, weighted_sampler)
+{
+  std::vector<uint64_t> weights = {3, 0, 1, 4, 1, 5, 9, 2, 6};
+  WeightedSampler sampler;
+  ASSERT_TRUE(sampler.empty());
+  sampler.assign(weights.begin(), weights.end());
+  ASSERT_EQ(sampler.size(), weights.size());
+
+  /* Check prefix sums and find() against a linear scan. */
+  auto check = [&]() {
+    ASSERT_EQ(sampler.size(), weights.size());
+    uint64_t sum = 0;
+    for (size_t i = 0; i < weights.size(); ++i)
+    {
+      ASSERT_EQ(sampler.get(i), weights[i]);
+      ASSERT_EQ(sampler.sum(i), sum);
+      for (uint64_t v = sum; v < sum + weights[i]; ++v)
+      {
+        ASSERT_EQ(sampler.find(v), i);
+      }
+      sum += weights[i];
+    }
+    ASSERT_EQ(sampler.sum(weights.size()), sum);
+  };
+
+  check();
+
+  sampler.set(1, 7);
+  weights[1] = 7;
+  sampler.set(6, 0);
+  weights[6] = 0;
+  check();
+
+  for (uint64_t w : {2, 0, 8, 1, 1})
+  {
+    sampler.push_back(w);
+    weights.push_back(w);
+    check();
+  }
+
+  sampler.shrink(5);
+  weights.resize(5);
+  check();
+  sampler.push_back(3);
+  weights.push_back(3);
+  check();
+
+  sampler.clear();
+  ASSERT_TRUE(sampler.empty());
+  ASSERT_EQ(sampler.sum(0), 0);
+}
+
+TEST(rng, pick_weighted_sampler)
+{
+  RNGenerator rng(42);
+  ASSERT_FALSE(rng.is_compat_sampling());
+
+  std::vector<uint64_t> weights = {1, 0, 2, 5, 0, 2};
+  WeightedSampler sampler;
+  sampler.assign(weights.begin(), weights.end());
+
+  const uint64_t n = 100000;
+  std::vector<uint64_t> counts(weights.size());
+  for (uint64_t i = 0; i < n; ++i)
+  {
+    ++counts[rng.pick_weighted(sampler, 0, weights.size())];
+  }
+  uint64_t total = std::accumulate(weights.begin(), weights.end(), uint64_t(0));
+  for (size_t i = 0; i < weights.size(); ++i)
+  {
+    double expected =
+        static_cast<double>(n * weights[i]) / static_cast<double>(total);
+    ASSERT_NEAR(static_cast<double>(counts[i]), expected, 0.02 * n);
+    if (weights[i] == 0)
+    {
+      ASSERT_EQ(counts[i], 0);
+    }
+  }
+
+  /* Picks are restricted to the given range. */
+  for (uint64_t i = 0; i < 1000; ++i)
+  {
+    size_t idx = rng.pick_weighted(sampler, 2, 5);
+    ASSERT_TRUE(idx == 2 || idx == 3);
+  }
+
+  /* Picks are reproducible. */
+  RNGenerator rng1(7), rng2(7);
+  for (uint64_t i = 0; i < 1000; ++i)
+  {
+    ASSERT_EQ(rng1.pick_weighted(sampler, 0, weights.size()),
+              rng2.pick_weighted(sampler, 0, weights.size()));
+  }
+}
+
+TEST(rng, indexed_set)
+{
+  IndexedSet<uint32_t> set;
+  std::unordered_set<uint32_t> uset;
+  ASSERT_TRUE(set.empty());
+
+  /* Check elements against std::unordered_set. Iteration is in the order of
+   * std::unordered_set in compatibility mode, else in the order of get(). */
+  auto check = [&]() {
+    ASSERT_EQ(set.size(), uset.size());
+    IndexedOrder::s_compat = true;
+    ASSERT_TRUE(std::equal(set.begin(), set.end(), uset.begin(), uset.end()));
+    IndexedOrder::s_compat = false;
+    size_t n               = 0;
+    for (uint32_t v : set)
+    {
+      ASSERT_EQ(v, set.get(n++));
+    }
+    ASSERT_EQ(n, set.size());
+    for (size_t i = 0; i < set.size(); ++i)
+    {
+      ASSERT_EQ(uset.count(set.get(i)), 1);
+      ASSERT_EQ(*set.find(set.get(i)), set.get(i));
+    }
+  };
+
+  RNGenerator rng(42);
+  for (uint32_t i = 0; i < 1000; ++i)
+  {
+    uint32_t v = rng.pick<uint32_t>(0, 200);
+    if (rng.flip_coin())
+    {
+      ASSERT_EQ(set.insert(v).second, uset.insert(v).second);
+    }
+    else
+    {
+      ASSERT_EQ(set.erase(v), uset.erase(v));
+    }
+    check();
+  }
+  ASSERT_TRUE(set.find(201) == set.end());
+
+  /* Picks in compatibility mode are the same as for std::unordered_set. */
+  RNGenerator rng1(7), rng2(7);
+  rng1.set_compat_sampling(true);
+  rng2.set_compat_sampling(true);
+  IndexedOrder::s_compat = true;
+  for (uint32_t i = 0; i < 100; ++i)
+  {
+    uint32_t v1 = rng1.pick_from_set<IndexedSet<uint32_t>, uint32_t>(set);
+    uint32_t v2 =
+        rng2.pick_from_set<std::unordered_set<uint32_t>, uint32_t>(uset);
+    ASSERT_EQ(v1, v2);
+  }
+  IndexedOrder::s_compat = false;
+  /* Uniform picks via random access. */
+  std::unordered_map<uint32_t, uint32_t> counts;
+  for (uint32_t i = 0; i < 100 * set.size(); ++i)
+  {
+    ++counts[rng.pick_from_set<IndexedSet<uint32_t>, uint32_t>(set)];
+  }
+  ASSERT_EQ(counts.size(), set.size());
+
+  /* Erasing while iterating visits every element once, in both orders. */
+  for (bool compat : {false, true})
+  {
+    IndexedOrder::s_compat = compat;
+    IndexedSet<uint32_t> tmp(set.begin(), set.end());
+    std::unordered_set<uint32_t> visited;
+    for (auto it = tmp.begin(); it != tmp.end();)
+    {
+      ASSERT_TRUE(visited.insert(*it).second);
+      it = *it % 2 ? tmp.erase(it) : std::next(it);
+    }
+    ASSERT_EQ(visited.size(), set.size());
+    for (uint32_t v : tmp)
+    {
+      ASSERT_EQ(v % 2, 0);
+    }
+  }
+  IndexedOrder::s_compat = false;
+
+  set.clear();
+  ASSERT_TRUE(set.empty());
+  ASSERT_TRUE(set.begin() == set.end());
+}
+
+TEST(rng, indexed_map)
+{
+  IndexedMap<uint32_t, std::vector<uint32_t>> map;
+  std::unordered_map<uint32_t, std::vector<uint32_t>> umap;
+
+  RNGenerator rng(42);
+  for (uint32_t i = 0; i < 1000; ++i)
+  {
+    uint32_t k = rng.pick<uint32_t>(0, 200);
+    if (rng.flip_coin())
+    {
+      map[k].push_back(i);
+      umap[k].push_back(i);
+    }
+    else
+    {
+      ASSERT_EQ(map.erase(k), umap.erase(k));
+    }
+    ASSERT_EQ(map.size(), umap.size());
+    /* Iteration is in the order of std::unordered_map in compatibility mode,
+     * else in the order of get(). */
+    IndexedOrder::s_compat = true;
+    auto it                = umap.begin();
+    for (const auto& [key, value] : map)
+    {
+      ASSERT_EQ(key, it->first);
+      ASSERT_EQ(value, it->second);
+      ++it;
+    }
+    IndexedOrder::s_compat = false;
+    size_t n               = 0;
+    for (const auto& entry : map)
+    {
+      ASSERT_EQ(&entry, &map.get(n++));
+    }
+    ASSERT_EQ(n, map.size());
+  }
+
+  /* Erasing while iterating visits every entry once, in both orders. */
+  for (bool compat : {false, true})
+  {
+    IndexedOrder::s_compat = compat;
+    IndexedMap<uint32_t, std::vector<uint32_t>> tmp(map);
+    std::unordered_set<uint32_t> visited;
+    for (auto it = tmp.begin(); it != tmp.end();)
+    {
+      ASSERT_TRUE(visited.insert(it->first).second);
+      it = it->first % 2 ? tmp.erase(it) : std::next(it);
+    }
+    ASSERT_EQ(visited.size(), map.size());
+    for (const auto& entry : tmp)
+    {
+      ASSERT_EQ(entry.first % 2, 0);
+    }
+  }
+  IndexedOrder::s_compat = false;
+
+  /* References to entries are stable. */
+  ASSERT_FALSE(map.empty());
+  uint32_t key                 = map.get(0).first;
+  std::vector<uint32_t>* value = &map.at(key);
+  for (uint32_t k = 300; k < 400; ++k)
+  {
+    map.emplace(k, 1, k);
+  }
+  ASSERT_EQ(&map.at(key), value);
+  ASSERT_EQ(map.find(key)->second, *value);
+  ASSERT_TRUE(map.find(400) == map.end());
+
+  /* Copies are deep. */
+  IndexedMap<uint32_t, std::vector<uint32_t>> copy(map);
+  copy.at(key).push_back(0);
+  ASSERT_NE(copy.at(key), map.at(key));
+}
+
+TEST(rng, pick_string_char_set)
+{
+  ASSERT_EQ(CharSet("01").chars_per_draw(), 64);
+  ASSERT_EQ(CharSet("0123456789abcdef").chars_per_draw(), 16);
+  ASSERT_EQ(CharSet("0123456789").chars_per_draw(), 14);
+  ASSERT_EQ(CharSet("x").chars_per_draw(), 64);
+
+  RNGenerator rng(42);
+  CharSet chars("abcdefghij");
+  const uint32_t len = 100000;
+  std::string str    = "prefix";
+  rng.pick_string(chars, len, str);
+  ASSERT_EQ(str.size(), len + 6);
+  ASSERT_EQ(str.substr(0, 6), "prefix");
+
+  /* All characters are picked with (nearly) equal probability. */
+  std::vector<uint32_t> counts(chars.size());
+  for (size_t i = 6; i < str.size(); ++i)
+  {
+    size_t idx = chars.str().find(str[i]);
+    ASSERT_NE(idx, std::string::npos);
+    ++counts[idx];
+  }
+  for (uint32_t c : counts)
+  {
+    ASSERT_NEAR(static_cast<double>(c), len / chars.size(), 0.05 * len);
+  }
+
+  /* Numerals are well-formed. */
+  for (uint32_t i = 1; i < 50; ++i)
+  {
+    std::string dec = rng.pick_dec_int_string(i);
+    ASSERT_EQ(dec.size(), i);
+    ASSERT_NE(dec[0], '0');
+    std::string real = rng.pick_dec_real_string(i);
+    ASSERT_EQ(real.size(), i);
+    ASSERT_NE(real[0], '0');
+    std::string bin = rng.pick_bin_string(i);
+    ASSERT_EQ(bin.find_first_not_of("01"), std::string::npos);
+  }
+
+  /* Strings are reproducible. */
+  RNGenerator rng1(7), rng2(7);
+  ASSERT_EQ(rng1.pick_string(100), rng2.pick_string(100));
+  ASSERT_EQ(rng1.pick_dec_int_string(30), rng2.pick_dec_int_string(30));
+}
+
+TEST(rng, pick_string_compat)
+{
+  /* The implementation of earlier versions: one draw per character. */
+  std::vector<char> printable;
+  for (uint32_t i = 32; i < 256; ++i)
+  {
+    if (i == '|' || i == '\\' || i == 127) continue;
+    printable.push_back(static_cast<char>(i));
+  }
+  auto ref_pick_string = [&](RNGenerator& rng, uint32_t len) {
+    std::string res;
+    for (uint32_t i = 0; i < len; ++i)
+    {
+      res += printable[rng.pick<uint32_t>() % printable.size()];
+    }
+    return res;
+  };
+  auto ref_pick_dec_int_string = [](RNGenerator& rng, uint32_t len) {
+    std::string res(1, static_cast<char>('1' + rng.pick<uint32_t>() % 9));
+    for (uint32_t i = 1; i < len; ++i)
+    {
+      res += static_cast<char>('0' + rng.pick<uint32_t>() % 10);
+    }
+    return res;
+  };
+
+  RNGenerator rng(42), rng_ref(42);
+  rng.set_compat_sampling(true);
+  for (uint32_t len = 1; len < 100; ++len)
+  {
+    ASSERT_EQ(rng.pick_string(len), ref_pick_string(rng_ref, len));
+    ASSERT_EQ(rng.pick_dec_int_string(len),
+              ref_pick_dec_int_string(rng_ref, len));
+  }
+}
@@ -1,8 +1,14 @@
+#include <random>
 #include <sstream>
+#include <vector>
+
+#include "error_index.hpp"
 #include "gtest/gtest.h"
+#include "ref_util.hpp"
 #include "util.hpp"
 
 using namespace murxla;
+using namespace murxla::test;
 
 TEST(util, str_bin_to_hex)
 {
@@ -74,6 +80,110 @@ TEST(util, str_bin_to_dec)
       "18364758544493064720");
 }
 
+TEST(util, str_dec_to_bin)
+{
+  ASSERT_EQ(str_dec_to_bin("0"), "0");
+  ASSERT_EQ(str_dec_to_bin("1"), "1");
+  ASSERT_EQ(str_dec_to_bin("15"), "1111");
+  ASSERT_EQ(str_dec_to_bin("131071"), "11111111111111111");
+  ASSERT_EQ(str_dec_to_bin("18364758544493064720"),
+            "1111111011011100101110101001100001110110010101000011001000010000");
+  ASSERT_EQ(
+      str_dec_to_bin("24595658764946068821"),
+      "10101010101010101010101010101010101010101010101010101010101010101");
+
+  ASSERT_EQ(str_dec_to_bin("-1"), "1");
+  ASSERT_EQ(str_dec_to_bin("-2"), "10");
+  ASSERT_EQ(str_dec_to_bin("-3"), "1");
+  ASSERT_EQ(str_dec_to_bin("-8"), "1000");
+  ASSERT_EQ(str_dec_to_bin("-10"), "110");
+}
+
+TEST(util, big_uint)
+{
+  ASSERT_TRUE(BigUInt().is_zero());
+  ASSERT_TRUE(BigUInt(0).is_zero());
+  ASSERT_EQ(BigUInt().to_bin_str(), "0");
+  ASSERT_EQ(BigUInt().to_dec_str(), "0");
+  ASSERT_EQ(BigUInt().to_hex_str(), "0");
+  ASSERT_EQ(BigUInt().bit_length(), 0);
+  ASSERT_TRUE(BigUInt::from_bin_str("0000").is_zero());
+  ASSERT_TRUE(BigUInt::from_dec_str("000").is_zero());
+
+  BigUInt max64(UINT64_MAX);
+  ASSERT_EQ(max64.to_dec_str(), "18446744073709551615");
+  ASSERT_EQ(max64.to_hex_str(), "ffffffffffffffff");
+  ASSERT_EQ(max64.bit_length(), 64);
+  max64.mul_add(1, 1);
+  ASSERT_EQ(max64.to_dec_str(), "18446744073709551616");
+  ASSERT_EQ(max64.to_hex_str(), "10000000000000000");
+  ASSERT_EQ(max64.bit_length(), 65);
+  ASSERT_EQ(max64.div(10), 6);
+  ASSERT_EQ(max64.to_dec_str(), "1844674407370955161");
+
+  ASSERT_EQ(BigUInt(5).negate(3).to_dec_str(), "3");
+  ASSERT_EQ(BigUInt(0).negate(3).to_dec_str(), "8");
+  ASSERT_EQ(BigUInt(1).negate(130).to_bin_str(), std::string(130, '1'));
+
+  /* Round trips over values spanning several words. */
+  std::mt19937_64 rng(42);
+  for (size_t i = 0; i < 200; ++i)
+  {
+    std::string bin(1 + rng() % 300, '0');
+    for (auto& c : bin) c = rng() % 2 ? '1' : '0';
+    bin[0] = '1';
+
+    BigUInt val = BigUInt::from_bin_str(bin);
+    ASSERT_EQ(val.bit_length(), bin.size());
+    ASSERT_EQ(val.to_bin_str(), bin);
+    std::string dec = val.to_dec_str();
+    std::string hex = val.to_hex_str();
+    ASSERT_EQ(BigUInt::from_dec_str(dec).to_bin_str(), bin);
+    ASSERT_EQ(BigUInt::from_hex_str(hex).to_bin_str(), bin);
+    ASSERT_EQ(BigUInt::from_hex_str(hex).to_dec_str(), dec);
+  }
+}
+
+TEST(util, str_conversion_reference)
+{
+  std::mt19937_64 rng(7);
+  for (size_t i = 0; i < 500; ++i)
+  {
+    std::string bin(1 + rng() % 200, '0');
+    for (auto& c : bin) c = rng() % 2 ? '1' : '0';
+
+    std::string dec = ref_str_bin_to_dec(bin);
+    ASSERT_EQ(str_bin_to_dec(bin), dec);
+    ASSERT_EQ(str_dec_to_bin(dec), BigUInt::from_bin_str(bin).to_bin_str());
+
+    /* Signed: the two's complement of the value in bin.size() bits. */
+    std::string neg = bin;
+    for (auto& c : neg) c = c == '1' ? '0' : '1';
+    size_t j = neg.size();
+    for (; j > 0 && neg[j - 1] == '1'; --j) neg[j - 1] = '0';
+    if (j > 0)
+    {
+      neg[j - 1] = '1';
+    }
+    else
+    {
+      neg.insert(neg.begin(), '1');
+    }
+    ASSERT_EQ(str_bin_to_dec(bin, true), "-" + ref_str_bin_to_dec(neg));
+  }
+}
+
+TEST(util, str_bin_to_dec_wide)
+{
+  std::mt19937_64 rng(1);
+  for (size_t i = 0; i < 20; ++i)
+  {
+    std::string bin(1024, '0');
+    for (auto& c : bin) c = rng() % 2 ? '1' : '0';
+    ASSERT_EQ(str_bin_to_dec(bin), ref_str_bin_to_dec(bin));
+  }
+}
+
 TEST(util, bv_special_value_ones_uint64)
 {
   for (uint32_t i = 1; i <= 64; ++i)
@@ -301,3 +411,99 @@ TEST(util, is_bv_special_value_max_signed_str)
     for (uint32_t j = 1; i > 0 && j < n; ++j) ASSERT_EQ(s[j], '1');
   }
 }
+
+TEST(util, hash128)
+{
+  using Hash = std::array<uint64_t, 2>;
+  ASSERT_EQ(hash128(""), (Hash{0, 0}));
+  ASSERT_EQ(hash128("hello"), (Hash{0xcbd8a7b341bd9b02, 0x5b1e906a48ae1d19}));
+  ASSERT_EQ(hash128("The quick brown fox jumps over the lazy dog"),
+            (Hash{0xe34bbc7bbc071b6c, 0x7a433ca9c49a9347}));
+}
+
+TEST(util, error_index_diff)
+{
+  ASSERT_EQ(ErrorIndex::diff("a b c", "a b c"), 0);
+  /* Numbers are ignored. */
+  ASSERT_EQ(ErrorIndex::diff("line 123", "line 456"), 0);
+  ASSERT_DOUBLE_EQ(ErrorIndex::diff("file.c:12", "file.c:34"), 7.0 / 9);
+  /* Tokens are compared by position, plus the difference in tokens. */
+  ASSERT_DOUBLE_EQ(ErrorIndex::diff("a bc d", "a xy d e"), 3.0 / 8);
+  ASSERT_DOUBLE_EQ(ErrorIndex::diff("a xy d e", "a bc d"), 3.0 / 8);
+}
+
+TEST(util, error_index)
+{
+  std::vector<std::string> words = {"0x1f", "42", "7"};
+  for (size_t i = 1; i <= 200; ++i)
+  {
+    std::string word;
+    for (size_t k = i; k > 0; k /= 26)
+    {
+      word += static_cast<char>('a' + k % 26);
+    }
+    words.push_back(word);
+  }
+
+  std::mt19937_64 rng(7);
+  auto gen_error = [&]() {
+    std::string res = "error:";
+    for (size_t i = 0, n = 5 + rng() % 40; i < n; ++i)
+    {
+      res += " " + words[rng() % words.size()];
+    }
+    return res;
+  };
+
+  ErrorIndex index;
+  std::vector<std::string> errors;
+  for (size_t i = 0; i < 500; ++i)
+  {
+    std::string err = gen_error();
+    bool numbers    = false;
+    /* Similar errors: change numbers or a few tokens of a known error. */
+    if (!errors.empty() && rng() % 2)
+    {
+      auto tokens = split(errors[rng() % errors.size()], ' ');
+      numbers     = rng() % 2;
+      for (size_t j = 0, n = 1 + rng() % 2; j < n; ++j)
+      {
+        size_t idx  = rng() % tokens.size();
+        tokens[idx] = numbers ? tokens[idx] + std::to_string(rng() % 100)
+                              : words[rng() % words.size()];
+      }
+      err.clear();
+      for (const auto& t : tokens) err += (err.empty() ? "" : " ") + t;
+    }
+
+    bool similar = false;
+    for (const auto& e : errors)
+    {
+      if (ErrorIndex::diff(err, e) <= ErrorIndex::MAX_DIFF)
+      {
+        similar = true;
+        break;
+      }
+    }
+    /* Errors are found iff there is a similar indexed error. */
+    const std::string* found = index.find(err);
+    ASSERT_EQ(found != nullptr, similar);
+    if (found)
+    {
+      ASSERT_LE(ErrorIndex::diff(err, *found), ErrorIndex::MAX_DIFF);
+    }
+    else
+    {
+      index.add(err);
+      errors.push_back(err);
+    }
+  }
+  ASSERT_EQ(index.size(), errors.size());
+
+  /* Similar errors that share no tokens. */
+  std::string err = std::string(200, 'x') + " y z";
+  ASSERT_LE(ErrorIndex::diff("w", err), ErrorIndex::MAX_DIFF);
+  index.add(err);
+  ASSERT_NE(index.find("w"), nullptr);
+  ASSERT_EQ(*index.find("w"), err);
+}